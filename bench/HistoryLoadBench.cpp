@@ -0,0 +1,181 @@
+/** \file HistoryLoadBench.cpp
+ * \brief Times loading a large history.csv with the original serial loader and with the current collection.
+ * \details Writes a history.csv of the requested number of lines (10 million unless given) in the format the
+ * original version saved, then loads it four ways:
+ *  - the original loader, which parsed the file line by line into a map of PurchaseHistory vectors,
+ *  - the current PurchaseHistoryCollection, which cuts the file at "H," lines, parses the chunks on every core and
+ *    writes the histories out as segments,
+ *  - the current collection again, now starting from the segments and log,
+ *  - the current collection decoding every segment, as a query over all histories does.
+ * Run by "make bench" in a directory of its own, which it leaves holding the generated files.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include "PurchaseHistory/PurchaseHistoryCollection.h"
+#include "PurchaseHistory/TaskPool.h"
+
+constexpr auto LEGACY_FILE = "history.csv";
+constexpr long DEFAULT_LINES = 10000000;
+constexpr int MEMBERS = 5000;
+constexpr int PRODUCTS = 400;
+// Histories are spread over the last 700 days, inside the retention period so none are rolled up
+constexpr time_t SPREAD = 700 * 24 * 60 * 60;
+
+/** Gets the seconds passed since a point in time.
+ * @param start Point to measure from.
+ * @return Seconds passed.
+ */
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** Writes a history.csv of about the given number of lines. Each history has one to five orders of two lines each.
+ * @param lines Number of lines to write, not counting the three header lines.
+ * @param histories Set to the number of histories written.
+ * @return None.
+ */
+static void writeLegacyFile(long lines, long &histories) {
+	std::ofstream file(LEGACY_FILE);
+	file << "History,mID,rawtime,length\n";
+	file << "Order,quantity,totalcost,dateofpurchase\n";
+	file << "Product,pID,name,category,price,quantity,Discount\n";
+
+	const time_t start = time(NULL) - SPREAD;
+	unsigned int state = 1;
+	long written = 0;
+	histories = 0;
+	while(written < lines) {
+		state = state * 1103515245 + 12345;
+		int orders = 1 + (state >> 16) % 5;
+		long room = (lines - written - 1) / 2;
+		if(orders > room)
+			orders = room > 0 ? room : 1;
+		file << "H," << (state >> 8) % MEMBERS << "," << start + histories * (SPREAD / (lines / 7 + 1)) << "," << orders << "\n";
+		for(int o = 0; o < orders; o++) {
+			state = state * 1103515245 + 12345;
+			int product = (state >> 16) % PRODUCTS;
+			int quantity = 1 + (state >> 4) % 3;
+			file << "O," << quantity << "," << quantity * 1.25 << ",0\n";
+			file << "P,p" << product << ",Product " << product << ",Category " << product % 12 << ",1.25,10,0\n";
+		}
+		written += 1 + 2 * orders;
+		histories++;
+	}
+}
+
+/** Loads history.csv the way the original PurchaseHistoryCollection constructor did. The original kept a Discount
+ * for a nonzero rate, which no longer exists as such; the rate is carried as a promotion as the current loader
+ * does.
+ * @param historyCollection Map the histories are added to, by member.
+ * @return None.
+ */
+static void legacyLoad(std::unordered_map<int, std::vector<PurchaseHistory>> &historyCollection) {
+	std::ifstream input;
+	input.open(LEGACY_FILE);
+
+	std::string line, key;
+	// Skip first three csv lines
+	getline(input, line);
+	getline(input, line);
+	getline(input, line);
+
+	while(getline(input, line)) {
+		std::list<Order> ordList;
+
+		std::istringstream iss(line);
+		// Skip identifier
+		getline(iss, key, ',');
+		getline(iss, key, ',');
+		int memberID = std::stoi(key);
+		getline(iss, key, ',');
+		double rawtime = std::stod(key);
+		getline(iss, key, ',');
+		int orders = std::stoi(key);
+
+		for(int c = 0; c < orders; c++) {
+			// New line
+			getline(input, line);
+			std::istringstream nestIss(line);
+			// Get constructor components for Order
+			getline(nestIss, key, ',');
+			getline(nestIss, key, ',');
+			int oQty = std::stoi(key);
+			getline(nestIss, key, ',');
+			getline(nestIss, key, ',');
+
+			// New line
+			getline(input, line);
+			std::istringstream nestIss2(line);
+			// Create Product
+			Product product;
+			getline(nestIss2, key, ',');
+			getline(nestIss2, key, ',');
+			product.setID(key);
+			getline(nestIss2, key, ',');
+			product.setName(key);
+			getline(nestIss2, key, ',');
+			product.setCategory(key);
+			getline(nestIss2, key, ',');
+			product.setPrice(std::stof(key));
+			getline(nestIss2, key, ',');
+			product.setQuantity(std::stoi(key));
+			getline(nestIss2, key, ',');
+			product.setPromotion(std::stof(key));
+			// Create and push Order
+			Order order = Order(product, 0, oQty);
+			ordList.push_back(order);
+		}
+
+		// Add the completed PurchaseHistory to the map
+		PurchaseHistory ph = PurchaseHistory(ordList, memberID, rawtime);
+		historyCollection[memberID].push_back(ph);
+	}
+
+	input.close();
+}
+
+int main(int argc, char **argv) {
+	long lines = argc > 1 ? std::atol(argv[1]) : DEFAULT_LINES;
+	long histories;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	writeLegacyFile(lines, histories);
+	std::cout << "Wrote " << LEGACY_FILE << ": " << lines << " lines, " << histories << " histories, "
+			  << secondsSince(start) << " s\n";
+	std::cout << "Worker threads: " << TaskPool::workers() << "\n";
+
+	{
+		std::unordered_map<int, std::vector<PurchaseHistory>> historyCollection;
+		start = std::chrono::steady_clock::now();
+		legacyLoad(historyCollection);
+		double seconds = secondsSince(start);
+		size_t loaded = 0;
+		for(std::unordered_map<int, std::vector<PurchaseHistory>>::const_iterator i = historyCollection.begin(); i != historyCollection.end(); i++)
+			loaded += i->second.size();
+		std::cout << "Original serial loader: " << seconds << " s, " << loaded << " histories\n";
+	}
+
+	{
+		start = std::chrono::steady_clock::now();
+		PurchaseHistoryCollection histC;
+		double seconds = secondsSince(start);
+		std::cout << "Current loader, parallel parse and segment write: " << seconds << " s\n";
+	}
+
+	{
+		start = std::chrono::steady_clock::now();
+		PurchaseHistoryCollection histC;
+		double seconds = secondsSince(start);
+		std::cout << "Current startup from segments: " << seconds << " s\n";
+
+		start = std::chrono::steady_clock::now();
+		size_t loaded = histC.viewAllHistories().size();
+		seconds = secondsSince(start);
+		std::cout << "Current load of every segment: " << seconds << " s, " << loaded << " histories\n";
+	}
+
+	return 0;
+}
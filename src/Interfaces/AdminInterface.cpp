@@ -1,7 +1,7 @@
 /*!
  * \file AdminInterface.h
  * \brief Class containing the user interface for he admin menu
- * \details Class containing admin menu interface actions. Takes in user inputs and does the according actions. Can do add product, remove product, restock product, change price of product in adminProductPrompt(). Can do add discount and remove discount in the AdminDiscountPrompt().
+ * \details Class containing admin menu interface actions. Takes in user inputs and does the according actions. Can do add product, remove product, restock product, change price of product and set bulk pricing tiers in adminProductPrompt(). Can do add discount, remove discount, add, remove or view coupons, schedule, preview or cancel promotions and add or remove discount rules in the AdminDiscountPrompt().
  * \authors Justin Woo, Shahryar Iqbal
 */
 
@@ -9,6 +9,8 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <cstdio>
+#include <ctime>
 
 using namespace std;
 
@@ -19,15 +21,66 @@ constexpr auto SHOPRIGHT = "   |";
 constexpr auto PRICEDIV = "    Price: ";
 
 /**
-* Default Constructor for this AdminInterface class. Takes in the product collection and discount collection databases as parameters and sets the attributes accordingly.
+* Prompts until the user enters a local date and time in the form YYYY-MM-DD HH:MM.
+* @param prompt Text shown before reading.
+* @return The entered time.
+*/
+static time_t readDateTime(const string &prompt)
+{
+	string line;
+	while (true)
+	{
+		cout << prompt << " (YYYY-MM-DD HH:MM): " << endl;
+		getline(cin, line);
+
+		tm when = tm();
+		if (sscanf(line.c_str(), "%d-%d-%d %d:%d", &when.tm_year, &when.tm_mon, &when.tm_mday, &when.tm_hour, &when.tm_min) == 5
+			&& when.tm_mon >= 1 && when.tm_mon <= 12 && when.tm_mday >= 1 && when.tm_mday <= 31 && when.tm_hour >= 0 && when.tm_hour < 24 && when.tm_min >= 0 && when.tm_min < 60)
+		{
+			when.tm_year -= 1900;
+			when.tm_mon -= 1;
+			when.tm_isdst = -1;
+			return mktime(&when);
+		}
+		cout << "Error: You must enter a valid date and time" << endl;
+	}
+}
+
+/**
+* Prints a list of promotions with their scope, amount and window.
+* @param list Promotions to print.
+* @return None.
+*/
+static void printPromotions(const vector<Promotion> &list)
+{
+	if (list.empty())
+	{
+		cout << "No promotions" << endl;
+		return;
+	}
+
+	char start[20], end[20];
+	for (unsigned i = 0; i < list.size(); i++)
+	{
+		strftime(start, sizeof(start), "%Y-%m-%d %H:%M", localtime(&list[i].start));
+		strftime(end, sizeof(end), "%Y-%m-%d %H:%M", localtime(&list[i].end));
+		cout << std::left << std::setw(4) << list[i].id << std::setw(14) << PromotionSchedule::scopeName(list[i].scope) << std::setw(20) << list[i].target
+			 << std::setw(6) << list[i].amount * 100 << "% off  " << start << " to " << end << endl;
+	}
+}
+
+/**
+* Default Constructor for this AdminInterface class. Takes in the product collection, discount collection and coupon collection databases as parameters and sets the attributes accordingly.
 * @param productCollection product collection database.
 * @param discountCollection dicount collection database.
+* @param couponCollection coupon collection database.
 */
-AdminInterface::AdminInterface(ProductCollection &productCollection, DiscountCollection &discountCollection)
+AdminInterface::AdminInterface(ProductCollection &productCollection, DiscountCollection &discountCollection, CouponCollection &couponCollection)
 {
 
 	this->pCollection = &productCollection;
 	this->dCollection = &discountCollection;
+	this->cCollection = &couponCollection;
 };
 
 /**
@@ -63,9 +116,9 @@ void AdminInterface::ProductDisplay()
 		std::cout << SHOPLEFT << std::left << std::setw(4) << i + 1 << ".  "
 				  << "ID: " << std::left << std::setw(10) << pCollection->getProductList().at(i).getID() << std::left << std::setw(20) << pCollection->getProductList().at(i).getName() << PRICEDIV << "$" << std::left << std::setw(10) << pCollection->getProductList().at(i).getPrice()
 				  << "QTY: " << std::left << std::setw(10) << pCollection->getProductList().at(i).getQuantity() << std::left << std::setw(15) << pCollection->getProductList().at(i).getCategory();
-		if (pCollection->getProductList().at(i).getDiscount() != NULL)
+		if (pCollection->getProduct(i)->getDiscountRate() > 0)
 		{
-			std::cout << "Discount: " << std::left << std::setw(2) << pCollection->getProduct(i)->getDiscount()->getAmount() * 100 << "%" << SHOPRIGHT << std::endl;
+			std::cout << "Discount: " << std::left << std::setw(2) << pCollection->getProduct(i)->getDiscountRate() * 100 << "%" << SHOPRIGHT << std::endl;
 		}
 		else
 		{
@@ -94,11 +147,12 @@ void AdminInterface::AdminProductPrompt()
 		cout << "2: Remove Product" << endl;
 		cout << "3: Restock Product" << endl;
 		cout << "4: Change Price of Product" << endl;
+		cout << "5: Set Bulk Pricing Tier" << endl;
 		cout << "0: Exit the admin menu" << endl;
 		cin >> action;
 
 		//if incorrect input, then prompt again
-		while (cin.fail() || (action != 1 && action != 2 && action != 3 && action != 4 && action != 0))
+		while (cin.fail() || (action != 1 && action != 2 && action != 3 && action != 4 && action != 5 && action != 0))
 		{
 			cin.clear();
 			cin.ignore(1000, '\n');
@@ -108,6 +162,7 @@ void AdminInterface::AdminProductPrompt()
 			cout << "2: Remove Product" << endl;
 			cout << "3: Restock Product" << endl;
 			cout << "4: Change Price of Product" << endl;
+			cout << "5: Set Bulk Pricing Tier" << endl;
 			cout << "0: Exit the admin menu" << endl;
 			cin >> action;
 		}
@@ -194,6 +249,12 @@ void AdminInterface::AdminProductPrompt()
 
 			Product newProduct = Product(productName, category, id, price, quantity, 0);
 			this->pCollection->addProduct(newProduct);
+			int added = this->pCollection->findProduct(id);
+			if (added != -1)
+			{
+				// pick up any discount rules or promotions for the new product's category and price
+				this->dCollection->reprice(this->pCollection->getProduct(added));
+			}
 
 			cin.clear();
 			cin.ignore(1000, '\n');
@@ -359,6 +420,7 @@ void AdminInterface::AdminProductPrompt()
 					cin >> price;
 				}
 				this->pCollection->changePrice(selectedProduct, price);
+				this->dCollection->reprice(this->pCollection->getProduct(vectorIndex));
 			}
 
 			cin.clear();
@@ -382,6 +444,84 @@ void AdminInterface::AdminProductPrompt()
 				break;
 			}
 		}
+
+		// prompts for setting a bulk pricing tier of a product
+		while (action == 5)
+		{
+			int choice, minQuantity;
+			float percent;
+			ProductDisplay();
+			cout << "Enter number of product you wish to set a bulk tier for or enter 0 to exit " << endl
+				 << "";
+			cin >> choice;
+			//if input is not an integer, or is greater than the product collection size, or is negative, then prompt again
+			while (cin.fail() || choice > pCollection->size() || choice < 0)
+			{
+
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter number of displayed product" << endl;
+				cout << "Please enter number of product you wish to set a bulk tier for or enter 0 to exit: " << endl;
+				cin >> choice;
+			}
+
+			//if choice is 0 to exit
+			if (choice == 0)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				break;
+			}
+			//if input is integer and in the correct range
+			else
+			{
+				int vectorIndex = choice - 1;
+
+				Product selectedProduct = pCollection->getProductList().at(vectorIndex);
+
+				cout << "Please enter the minimum quantity the tier applies to" << endl;
+				cin >> minQuantity;
+				while (cin.fail() || minQuantity < 1)
+				{
+					cin.clear();
+					cin.ignore(1000, '\n');
+					cout << "Please enter a valid number" << endl;
+					cin >> minQuantity;
+				}
+
+				cout << "Please enter the bulk discount in percent (0 removes the tier)" << endl;
+				cin >> percent;
+				while (cin.fail() || percent < 0 || percent >= 100)
+				{
+					cin.clear();
+					cin.ignore(1000, '\n');
+					cout << "Error: You must enter a valid percentage" << endl;
+					cin >> percent;
+				}
+				this->pCollection->setBulkTier(selectedProduct, minQuantity, percent / 100);
+			}
+
+			cin.clear();
+			cin.ignore(1000, '\n');
+
+			cout << "If you want to set another bulk tier, press 5\nTo go back to the main menu input 0" << endl;
+			cin >> action;
+			if (cin.fail() || (action != 5 && action != 0))
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Invalid input. Returning to main menu" << endl;
+				action = -1;
+				break;
+			}
+
+			if (action == 0)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				break;
+			}
+		}
 	}
 }
 
@@ -396,16 +536,26 @@ void AdminInterface::AdminDiscountPrompt()
 
 	while (true)
 	{
+		// drop discounts that ran out so the product list below is current
+		dCollection->update(time(NULL));
 
 		// possible actions
 		cout << "Please select one of the following options: " << endl;
 		cout << "1: Add Discount" << endl;
 		cout << "2: Remove Discount" << endl;
+		cout << "3: Add Coupon" << endl;
+		cout << "4: Remove Coupon" << endl;
+		cout << "5: View Coupons" << endl;
+		cout << "6: Schedule Promotion" << endl;
+		cout << "7: View Promotions" << endl;
+		cout << "8: Cancel Promotion" << endl;
+		cout << "9: Add Discount Rule" << endl;
+		cout << "10: Remove Discount Rule" << endl;
 		cout << "0: Exit the admin menu" << endl;
 		cin >> action;
 
 		//if incorrect input, then prompt again
-		while (cin.fail() || (action != 1 && action != 2 && action != 0))
+		while (cin.fail() || action < 0 || action > 10)
 		{
 			cin.clear();
 			cin.ignore(1000, '\n');
@@ -413,6 +563,14 @@ void AdminInterface::AdminDiscountPrompt()
 			cout << "Please select one of the following options: " << endl;
 			cout << "1: Add Discount" << endl;
 			cout << "2: Remove Discount" << endl;
+			cout << "3: Add Coupon" << endl;
+			cout << "4: Remove Coupon" << endl;
+			cout << "5: View Coupons" << endl;
+			cout << "6: Schedule Promotion" << endl;
+			cout << "7: View Promotions" << endl;
+			cout << "8: Cancel Promotion" << endl;
+			cout << "9: Add Discount Rule" << endl;
+			cout << "10: Remove Discount Rule" << endl;
 			cout << "0: Exit the admin menu" << endl;
 			cin >> action;
 		}
@@ -466,43 +624,46 @@ void AdminInterface::AdminDiscountPrompt()
 					cout << "Please enter the discount amount in percent: " << endl;
 					cin >> amount;
 				}
-				// Prompts for adding expiration date if implemented
-				// int day, month, year;
-
-				// cout << "Enter the expiry day of the month: " << endl;
-				// cin >> day;
-				// while (cin.fail() || day < 0 || day > 31)
-				// {
-				// 	cin.clear();
-				// 	cin.ignore(1000, '\n');
-				// 	cout << "Error: You must enter a valid day" << endl;
-				// 	cout << "Please enter the expiry day: " << endl;
-				// 	cin >> day;
-				// }
-
-				// cout << "Enter the expiry month: " << endl;
-				// cin >> month;
-				// while (cin.fail() || month < 0 || month > 12)
-				// {
-				// 	cin.clear();
-				// 	cin.ignore(1000, '\n');
-				// 	cout << "Error: You must enter a valid month" << endl;
-				// 	cout << "Please enter the expiry month: " << endl;
-				// 	cin >> month;
-				// }
-
-				// cout << "Enter the expiry year: " << endl;
-				// cin >> year;
-				// while (cin.fail() || year < 0)
-				// {
-				// 	cin.clear();
-				// 	cin.ignore(1000, '\n');
-				// 	cout << "Error: You must enter a valid year" << endl;
-				// 	cout << "Please enter the expiry year: " << endl;
-				// 	cin >> year;
-				// }
-
-				dCollection->addDiscount(pCollection->getProduct(vectorIndex), amount / 100, 0, 0, 0);
+				// Prompts for the expiration date, a day of 0 means the discount does not expire
+				int day, month = 0, year = 0;
+
+				cout << "Enter the expiry day of the month, or 0 for no expiry: " << endl;
+				cin >> day;
+				while (cin.fail() || day < 0 || day > 31)
+				{
+					cin.clear();
+					cin.ignore(1000, '\n');
+					cout << "Error: You must enter a valid day" << endl;
+					cout << "Please enter the expiry day: " << endl;
+					cin >> day;
+				}
+
+				if (day != 0)
+				{
+					cout << "Enter the expiry month: " << endl;
+					cin >> month;
+					while (cin.fail() || month < 1 || month > 12)
+					{
+						cin.clear();
+						cin.ignore(1000, '\n');
+						cout << "Error: You must enter a valid month" << endl;
+						cout << "Please enter the expiry month: " << endl;
+						cin >> month;
+					}
+
+					cout << "Enter the expiry year: " << endl;
+					cin >> year;
+					while (cin.fail() || year < 1970)
+					{
+						cin.clear();
+						cin.ignore(1000, '\n');
+						cout << "Error: You must enter a valid year" << endl;
+						cout << "Please enter the expiry year: " << endl;
+						cin >> year;
+					}
+				}
+
+				dCollection->addDiscount(pCollection->getProduct(vectorIndex), amount / 100, day, month, year);
 			}
 		}
 
@@ -549,5 +710,264 @@ void AdminInterface::AdminDiscountPrompt()
 				break;
 			}
 		}
+
+		// prompts for adding a coupon
+		if (action == 3)
+		{
+			string code, category;
+			int type, maxUses;
+			float amount, minSpend;
+
+			cout << "Please enter the coupon code" << endl;
+			cin >> code;
+
+			cout << "Enter 1 for a percentage off or 2 for a flat amount off" << endl;
+			cin >> type;
+			while (cin.fail() || (type != 1 && type != 2))
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter 1 or 2" << endl;
+				cin >> type;
+			}
+
+			cout << (type == 1 ? "Enter the discount amount in percent: " : "Enter the dollar amount off: ") << endl;
+			cin >> amount;
+			while (cin.fail() || amount <= 0 || (type == 1 && amount > 100))
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter a valid amount" << endl;
+				cin >> amount;
+			}
+
+			cout << "Enter the category the coupon is limited to, or 'any' for the whole cart" << endl;
+			cin >> category;
+			if (category == "any")
+			{
+				category = "";
+			}
+
+			cout << "Enter the minimum cart subtotal, or 0 for none" << endl;
+			cin >> minSpend;
+			while (cin.fail() || minSpend < 0)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter a valid amount" << endl;
+				cin >> minSpend;
+			}
+
+			cout << "Enter the number of times the coupon may be redeemed, or 0 for unlimited" << endl;
+			cin >> maxUses;
+			while (cin.fail() || maxUses < 0)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter a valid number" << endl;
+				cin >> maxUses;
+			}
+
+			Coupon coupon = Coupon(code, type == 1 ? percentOff : flatOff, type == 1 ? amount / 100 : amount, category, minSpend, maxUses);
+			int result = cCollection->addCoupon(coupon);
+			if (result == -1)
+			{
+				cout << "A coupon with this code already exists" << endl;
+			}
+			else if (result == -2)
+			{
+				cout << "Invalid coupon amount" << endl;
+			}
+			else
+			{
+				cout << "Coupon was added successfully" << endl;
+			}
+			cin.clear();
+			cin.ignore(1000, '\n');
+		}
+
+		// prompts for removing a coupon
+		if (action == 4)
+		{
+			string code;
+			cCollection->printCoupons();
+			cout << "Please enter the code of the coupon you want to remove" << endl;
+			cin >> code;
+			if (cCollection->removeCoupon(code) == 0)
+			{
+				cout << "Coupon was removed successfully" << endl;
+			}
+			else
+			{
+				cout << "No coupon has this code" << endl;
+			}
+			cin.clear();
+			cin.ignore(1000, '\n');
+		}
+
+		// displays the current coupons
+		if (action == 5)
+		{
+			cCollection->printCoupons();
+		}
+
+		// prompts for scheduling a promotion on a product, a category or every product
+		if (action == 6)
+		{
+			int scope;
+			float amount;
+			string target;
+
+			cout << "Enter 1 for a single product, 2 for a category or 3 for every product" << endl;
+			cin >> scope;
+			while (cin.fail() || scope < 1 || scope > 3)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter 1, 2 or 3" << endl;
+				cin >> scope;
+			}
+
+			if (scope != 3)
+			{
+				cout << (scope == 1 ? "Enter the product ID" : "Enter the category name") << endl;
+				cin >> target;
+			}
+
+			cout << "Enter the discount amount in percent: " << endl;
+			cin >> amount;
+			while (cin.fail() || amount <= 0 || amount >= 100)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter a valid percentage" << endl;
+				cin >> amount;
+			}
+			cin.ignore(1000, '\n');
+
+			time_t start = readDateTime("Enter the start of the promotion");
+			time_t end = readDateTime("Enter the end of the promotion");
+			dCollection->addPromotion((PromotionScope)(scope - 1), target, amount / 100, start, end);
+		}
+
+		// lists every promotion, then the ones active at a chosen time
+		if (action == 7)
+		{
+			const map<int, Promotion> &all = dCollection->getPromotions().getPromotions();
+			vector<Promotion> list;
+			for (map<int, Promotion>::const_iterator it = all.begin(); it != all.end(); ++it)
+			{
+				list.push_back(it->second);
+			}
+			cout << "Scheduled promotions:" << endl;
+			printPromotions(list);
+
+			cin.ignore(1000, '\n');
+			time_t when = readDateTime("Enter a time to preview the promotions active then");
+			cout << "Promotions active at that time:" << endl;
+			printPromotions(dCollection->getPromotions().activeAt(when));
+		}
+
+		// prompts for cancelling a promotion
+		if (action == 8)
+		{
+			int id;
+			cout << "Enter the ID of the promotion to cancel" << endl;
+			cin >> id;
+			if (cin.fail())
+			{
+				cout << "Error: You must enter a number" << endl;
+			}
+			else
+			{
+				dCollection->removePromotion(id);
+			}
+			cin.clear();
+			cin.ignore(1000, '\n');
+		}
+
+		// prompts for adding a rule that discounts a category, a price band or products whose ID matches a pattern
+		if (action == 9)
+		{
+			int type;
+			string pattern;
+			float minPrice = 0, maxPrice = 0, amount;
+
+			cout << "Enter 1 to discount a category, 2 to discount a price band or 3 to discount product IDs matching a pattern" << endl;
+			cin >> type;
+			while (cin.fail() || type < 1 || type > 3)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter 1, 2 or 3" << endl;
+				cin >> type;
+			}
+
+			if (type == 1)
+			{
+				cout << "Enter the category name" << endl;
+				cin >> pattern;
+			}
+			else if (type == 3)
+			{
+				cout << "Enter the ID pattern, where * matches anything and ? matches one character (e.g. *_c)" << endl;
+				cin >> pattern;
+			}
+			else
+			{
+				cout << "Enter the lowest and highest price of the band" << endl;
+				cin >> minPrice >> maxPrice;
+				while (cin.fail() || minPrice < 0 || maxPrice < minPrice)
+				{
+					cin.clear();
+					cin.ignore(1000, '\n');
+					cout << "Error: You must enter two prices, lowest first" << endl;
+					cin >> minPrice >> maxPrice;
+				}
+			}
+
+			cout << "Enter the discount amount in percent: " << endl;
+			cin >> amount;
+			while (cin.fail() || amount <= 0 || amount >= 100)
+			{
+				cin.clear();
+				cin.ignore(1000, '\n');
+				cout << "Error: You must enter a valid percentage" << endl;
+				cin >> amount;
+			}
+
+			dCollection->addRule((DiscountRuleType)(type - 1), pattern, minPrice, maxPrice, amount / 100);
+			cin.clear();
+			cin.ignore(1000, '\n');
+		}
+
+		// prompts for removing a discount rule
+		if (action == 10)
+		{
+			const map<int, DiscountRule> &rules = dCollection->getRules();
+			if (rules.empty())
+			{
+				cout << "There are no discount rules" << endl;
+				continue;
+			}
+			for (map<int, DiscountRule>::const_iterator it = rules.begin(); it != rules.end(); ++it)
+			{
+				cout << it->second.describe() << endl;
+			}
+
+			int id;
+			cout << "Enter the ID of the rule to remove" << endl;
+			cin >> id;
+			if (cin.fail())
+			{
+				cout << "Error: You must enter a number" << endl;
+			}
+			else
+			{
+				dCollection->removeRule(id);
+			}
+			cin.clear();
+			cin.ignore(1000, '\n');
+		}
 	}
 }
\ No newline at end of file
@@ -4,16 +4,18 @@
 #include "../Product/Product.h"
 #include "../Product/ProductCollection.h"
 #include "../Product/DiscountCollection.h"
+#include "../ShoppingCart/CouponCollection.h"
 
 class AdminInterface
 {
 private:
 	ProductCollection* pCollection;
 	DiscountCollection* dCollection;
+	CouponCollection* cCollection;
 
 public:
 
-	AdminInterface(ProductCollection& productCollection, DiscountCollection& discountCollection);
+	AdminInterface(ProductCollection& productCollection, DiscountCollection& discountCollection, CouponCollection& couponCollection);
 	~AdminInterface();
 	void ProductDisplay();
 	void AdminProductPrompt();
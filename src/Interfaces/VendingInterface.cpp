@@ -1,7 +1,8 @@
 /*!
  * \file VendingInterface.h
  * \brief Class containing a product collection
- * \details Class containing a product collection. Used to display current products and allow user to add items to cart
+ * \details Class containing a product collection. Used to display current products and allow user to add items to cart,
+ * and to suggest products that are frequently bought together with an item added to the cart
  * \author Matthew Mombourquette
 */
 #include "VendingInterface.h"
@@ -13,6 +14,7 @@ constexpr auto SHOPTOP = "------------------------------------------------------
 constexpr auto SHOPLEFT = "| ";
 constexpr auto SHOPRIGHT = "  |";
 constexpr auto PRICEDIV = "    Price: ";
+constexpr size_t SUGGESTIONS = 3;
 
 
 
@@ -102,9 +104,9 @@ std::pair<int, int> VendingInterface::VendingDisplay()
 		std::cout << SHOPLEFT << std::right << std::setw(3) << i + 1 << ".  " << std::left << std::setw(20) << pCollection->getProductList().at(i).getName() << PRICEDIV << "$" << std::left << std::setw(10) << pCollection->getProductList().at(i).getPrice()
 				  << "QTY: " << std::left << std::setw(10) << pCollection->getProductList().at(i).getQuantity() << std::left << std::setw(15) << pCollection->getProductList().at(i).getCategory();
 
-		if (pCollection->getProductList().at(i).getDiscount() != NULL)
+		if (pCollection->getProduct(i)->getDiscountRate() > 0)
 		{
-			std::cout << "Discount: " << std::left << std::setw(2) << pCollection->getProduct(i)->getDiscount()->getAmount() * 100 << "%" << SHOPRIGHT << std::endl;
+			std::cout << "Discount: " << std::left << std::setw(2) << pCollection->getProduct(i)->getDiscountRate() * 100 << "%" << SHOPRIGHT << std::endl;
 		}
 		else
 		{
@@ -221,3 +223,34 @@ std::pair<int, int> VendingInterface::VendingDisplay()
 		}
 	}
 };
+
+/**
+* Displays the products most often bought together with a product, leaving out any that are no longer stocked.
+* @param coPurchases Counts of products bought together.
+* @param productID Unique ID of the product added to the cart.
+* @return None.
+*/
+void VendingInterface::RecommendationDisplay(const CoPurchaseMatrix &coPurchases, const std::string &productID)
+{
+	// Ask for every kept partner, some may be sold out or removed from the catalog
+	std::vector<CoPurchase> partners = coPurchases.topPartners(productID, CoPurchaseMatrix::TOP_KEPT);
+	size_t shown = 0;
+	for (size_t i = 0; i < partners.size() && shown < SUGGESTIONS; i++)
+	{
+		int index = pCollection->findProduct(partners[i].productID);
+		if (index == -1 || partners[i].productID == productID || pCollection->getProduct(index)->getQuantity() <= 0)
+		{
+			continue;
+		}
+		if (shown == 0)
+		{
+			std::cout << "Frequently bought together:" << std::endl;
+		}
+		std::cout << SHOPLEFT << std::left << std::setw(20) << pCollection->getProduct(index)->getName() << PRICEDIV << "$" << pCollection->getProduct(index)->getEffectivePrice() << std::endl;
+		shown++;
+	}
+	if (shown > 0)
+	{
+		std::cout << std::endl;
+	}
+}
@@ -4,6 +4,7 @@
 
 #include "../Product/Product.h"
 #include "../Product/ProductCollection.h"
+#include "../PurchaseHistory/CoPurchaseMatrix.h"
 
 class VendingInterface
 {
@@ -16,6 +17,7 @@ public:
 	VendingInterface(ProductCollection& productCollection);
 	~VendingInterface();
 	std::pair<int, int> VendingDisplay();
+	void RecommendationDisplay(const CoPurchaseMatrix &coPurchases, const std::string &productID);
 	
 	
 };
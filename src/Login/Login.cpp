@@ -52,6 +52,23 @@ Member *Login::checkLogin(std::string username, std::string password)
     // Directly add user to login collection (update to encrypt password)
     return loginCollection.findMember(username, password);
 }
+/**
+* Finds a member of the login system by their unique member ID
+* @param memberID unique ID of the member
+* @return NULL if no member has the ID, Member* if the member exists
+*/
+Member *Login::findMemberByID(int memberID)
+{
+    return loginCollection.findMemberByID(memberID);
+}
+/**
+* Gets the last journaled checkout whose balance changes the members already hold
+* @return Sequence number of the checkout, 0 if none
+*/
+uint64_t Login::getLastCheckout()
+{
+    return loginCollection.getLastCheckout();
+}
 /**
  * Sets the login collction attached to the login system
  * @param collection the login collection
@@ -15,6 +15,8 @@ public:
     Login(LoginCollection loginCollection);
     int createAccount(std::string username, std::string password, std::string fname, std::string lname, bool isAdmin, std::string membershipType);
     Member *checkLogin(std::string username, std::string password);
+    Member *findMemberByID(int memberID);
+    uint64_t getLastCheckout();
 
     void setLoginCollection(LoginCollection *collection);
 	LoginCollection getLoginCollection();
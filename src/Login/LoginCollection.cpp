@@ -10,6 +10,7 @@
 LoginCollection::LoginCollection()
 {
     currentHighestMemberID = 0;
+    lastCheckout = 0;
 }
 
 /** Default destructor.
@@ -133,6 +134,23 @@ Member *LoginCollection::findMember(std::string username, std::string password)
     }
 }
 
+/**
+* Finds a member by their unique member ID, without checking a password. Scans every member.
+* @param memberID unique ID of the member
+* @return NULL if no member has the ID, Member* if the member exists
+*/
+Member *LoginCollection::findMemberByID(int memberID)
+{
+    for (std::unordered_map<std::string, std::pair<std::string, Member>>::iterator it = loginCollection.begin(); it != loginCollection.end(); ++it)
+    {
+        if (it->second.second.getID() == memberID)
+        {
+            return &it->second.second;
+        }
+    }
+    return NULL;
+}
+
 /**
 * Delete a user from the database with a specific username and password
 * @param username: username of the user to be deleted
@@ -186,3 +204,11 @@ void LoginCollection::setCollection(std::unordered_map<std::string, std::pair<st
     loginCollection = map;
     currentHighestMemberID = highestID;
 }
+void LoginCollection::setLastCheckout(uint64_t checkout)
+{
+    lastCheckout = checkout;
+}
+uint64_t LoginCollection::getLastCheckout()
+{
+    return lastCheckout;
+}
@@ -29,6 +29,11 @@
     \param username The username of the member.
     \param password The password of the member.
 
+*/
+/*! \fn Member *findMemberByID(int memberID)
+    \brief Finds a member from the database by their unique member ID.
+    \param memberID The unique ID of the member.
+
 */
 /*! \fn int deleteUser(std::string username, std::string password)
     \brief Deletes a user from the database.
@@ -50,11 +55,19 @@
     \brief Updates session information
     \param highestID Current highestID in the member database.
 */
+/*! \fn void setLastCheckout(uint64_t checkout)
+    \brief Records the last journaled checkout whose balance changes the loaded members hold.
+    \param checkout Sequence number of the checkout, read from the member database.
+*/
+/*! \fn uint64_t getLastCheckout()
+    \brief Returns the last journaled checkout whose balance changes the loaded members hold.
+*/
 #ifndef LOGIN_COLLECTION_H
 #define LOGIN_COLLECTION_H
 
 #include <unordered_map>
 #include <string>
+#include <cstdint>
 #include "Member.h"
 
 class LoginCollection
@@ -62,17 +75,21 @@ class LoginCollection
 private:
     std::unordered_map<std::string, std::pair<std::string, Member>> loginCollection;
     int currentHighestMemberID;
+    uint64_t lastCheckout;
 
 public:
     LoginCollection();
     ~LoginCollection();
     int addMember(std::string username, std::string password, std::string fname, std::string lname, bool isAdmin, std::string membershipType);
     Member *findMember(std::string username, std::string password);
+    Member *findMemberByID(int memberID);
 
     int deleteUser(std::string username, std::string password);
     int changePassword(std::string username, std::string oldPassword, std::string newPassword);
 	std::unordered_map<std::string, std::pair<std::string, Member>> getMap();
 	void setCollection(std::unordered_map<std::string, std::pair<std::string, Member>>,int highestID);
+    void setLastCheckout(uint64_t checkout);
+    uint64_t getLastCheckout();
 };
 
 #endif
\ No newline at end of file
@@ -9,13 +9,18 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
 #include "Member.h"
 #include "LoginCollection.h"
 #include <iostream>
 
+// Starts the line ahead of the members that holds the last journaled checkout the file holds
+constexpr auto CHECKOUT_LINE = "Checkout=";
+
 UserDBConversion::UserDBConversion()
 {
 	highestID = -1;
+	lastCheckout = 0;
 };
 
 UserDBConversion::~UserDBConversion()
@@ -24,9 +29,10 @@ UserDBConversion::~UserDBConversion()
 
 /** Writes the LoginCollection to Output File
 * @param map of type : std::unordered_map<std::string, std::pair<std::string, Member>>
+* @param checkout Sequence number of the last journaled checkout, whose balance changes the members now hold.
 * @return None.
 */
-void UserDBConversion::LoginCollectionToFile(std::unordered_map<std::string, std::pair<std::string, Member>> &map)
+void UserDBConversion::LoginCollectionToFile(std::unordered_map<std::string, std::pair<std::string, Member>> &map, uint64_t checkout)
 {
 
 	//open output file
@@ -36,6 +42,9 @@ void UserDBConversion::LoginCollectionToFile(std::unordered_map<std::string, std
 	std::string temp;
 	//std::hash<std::string> hashed;
 
+	//the first line tells a journal replay which checkouts the balances already hold
+	userFile << encryptDecrypt(CHECKOUT_LINE + std::to_string(checkout) + " \n");
+
 	//create iterator for unordered_map
 	//std::unordered_map<std::string, std::pair<std::string, Member>>::iterator it = map.begin();
 
@@ -58,7 +67,7 @@ std::unordered_map<std::string, std::pair<std::string, Member>> UserDBConversion
 
 	std::string tPass, tUserName = "0";
 	std::string line;
-	std::ifstream file("UserDB.txt");
+	std::ifstream file("userDB.txt");
 	std::unordered_map<std::string, std::pair<std::string, Member>> map;
 
 	std::stringstream ss;
@@ -74,6 +83,11 @@ std::unordered_map<std::string, std::pair<std::string, Member>> UserDBConversion
 
 		while (getline(ss, line))
 		{
+			if (line.compare(0, std::string(CHECKOUT_LINE).size(), CHECKOUT_LINE) == 0)
+			{
+				lastCheckout = strtoull(line.c_str() + std::string(CHECKOUT_LINE).size(), NULL, 10);
+				continue;
+			}
 
 			std::string tFName, tLName, tMembershipType, tUser, tPass;
 			bool tIsAdmin = 0;
@@ -167,6 +181,14 @@ int UserDBConversion::getHighestID()
 	return highestID;
 }
 
+/** Returns the last journaled checkout whose balance changes are in the file.
+ * @return Sequence number of the checkout, 0 if none.
+ */
+uint64_t UserDBConversion::getLastCheckout()
+{
+	return lastCheckout;
+}
+
 /** Encrypts specified string for security reasons.
  * @param text String of text to be encrypted.
  * @return None.
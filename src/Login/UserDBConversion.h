@@ -1,6 +1,7 @@
 #ifndef USERDBCONVERSION_H_
 #define USERDBCONVERSION_H_
 #include <string>
+#include <cstdint>
 #include <unordered_map>
 #include "Member.h"
 
@@ -8,14 +9,17 @@ class UserDBConversion {
 
 private:
 	int highestID;
+	// Last journaled checkout whose balance changes are in the file
+	uint64_t lastCheckout;
 	std::string encryptDecrypt(std::string text);
 
 public: 
 	UserDBConversion();
 	~UserDBConversion();
-	void LoginCollectionToFile(std::unordered_map<std::string, std::pair<std::string, Member>> & map);
+	void LoginCollectionToFile(std::unordered_map<std::string, std::pair<std::string, Member>> & map, uint64_t checkout);
 	std::unordered_map<std::string, std::pair<std::string, Member>> FileToLoginCollection();
 	int getHighestID();
+	uint64_t getLastCheckout();
 
 };
 #endif
@@ -13,6 +13,8 @@
 #include "Interfaces/VendingInterface.h"
 #include "ShoppingCart/Order.h"
 #include "ShoppingCart/ShoppingCart.h"
+#include "ShoppingCart/CheckoutTransaction.h"
+#include "ShoppingCart/CheckoutJournal.h"
 #include "Interfaces/AdminInterface.h"
 #include "PurchaseHistory/PurchaseHistoryCollection.h"
 #include <climits>
@@ -45,6 +47,7 @@ int main()
 	//load collections from file
 	auto map = converter.FileToLoginCollection();
 	collection.setCollection(map, converter.getHighestID());
+	collection.setLastCheckout(converter.getLastCheckout());
 	ProductCollection Products;
 	Products = ProductCollection();
 
@@ -54,11 +57,20 @@ int main()
 	Login login(collection);
 	LoginInterface loginInterface(&login);
 	SetupInterface SetupInterface(&login);
-	AdminInterface adminInterface(Products, discounts);
+	CouponCollection coupons;
+	AdminInterface adminInterface(Products, discounts, coupons);
 	Member *currentUser;
 	AccountInterface accInterface;
-	ShoppingCart cart;
-	PurchaseHistoryCollection history = PurchaseHistoryCollection();
+	ShoppingCart cart(&coupons);
+	PurchaseHistoryCollection history;
+
+	// apply any checkouts that were committed after the databases were last saved
+	CheckoutJournal journal("checkout.log");
+	int recovered = journal.replay(Products, login, coupons, history);
+	if (recovered > 0)
+	{
+		cout << "Recovered " << recovered << " checkout(s) from the checkout journal." << endl;
+	}
 
 	int input = 0;
 	int amount, index;
@@ -148,7 +160,7 @@ int main()
 
 					if (adminCheck == "y")
 					{
-						Products.alertInterface();
+						Products.alertInterface(history.getSalesCounters());
 						menu = baseMenu = adminMenu;
 						break;
 					}
@@ -171,9 +183,16 @@ int main()
 			else if (input == 3)
 			{
 				auto test = login.getLoginCollection().getMap();
-				converter.LoginCollectionToFile(test);
-				Products.saveToDatabase();
+				// Each database records the last checkout it holds, so a crash before the journal is emptied replays none twice
+				uint64_t checkout = journal.getLastCheckout();
+				converter.LoginCollectionToFile(test, checkout);
+				Products.checkpointStock(checkout);
 				discounts.saveToDatabase();
+				coupons.checkpointRedemptions(checkout);
+				// purchase histories are already in the history log
+				history.waitForCompaction();
+				// everything in the journal is now in the databases
+				journal.truncate();
 				return 0;
 			}
 		}
@@ -184,6 +203,7 @@ int main()
 
 			while (true)
 			{
+				discounts.update(time(NULL));
 				VendingInterface SaleInterface(Products);
 				pair<int, int> result = SaleInterface.VendingDisplay();
 
@@ -198,6 +218,7 @@ int main()
 					cart.addOrder(newOrder);
 
 					cout << cart.printCart() << endl;
+					SaleInterface.RecommendationDisplay(history.getCoPurchases(), Product.getID());
 				}
 				else
 				{
@@ -303,12 +324,14 @@ int main()
 		{
 			string inputStr;
 			int input;
+			discounts.update(time(NULL));
 			cout << endl
 				 << "----------------- Shopping Cart Menu -----------------" << endl;
 			cout << "1. View Shopping Cart" << endl;
 			cout << "2. Checkout" << endl;
 			cout << "3. Remove Items from Shopping Cart" << endl;
-			cout << "4. Return to Main Menu" << endl;
+			cout << "4. Apply Coupon Code" << endl;
+			cout << "5. Return to Main Menu" << endl;
 			while (getline(cin, inputStr))
 			{
 				stringstream stream(inputStr);
@@ -332,7 +355,7 @@ int main()
 			else if (input == 2)
 			{
 
-				int check = cart.processCart(currentUser, Products, history);
+				int check = cart.processCart(currentUser, Products, history, journal);
 
 				//check if process cart failed or succeeded here.
 
@@ -344,7 +367,6 @@ int main()
 				{
 					cout << cart.createInvoice() << endl;
 					cart.clearOrders();
-					history.saveToDatabase();
 					cout << endl
 						 << "Press Enter to Continue";
 					cin.ignore();
@@ -356,6 +378,13 @@ int main()
 				break;
 			}
 			else if (input == 4)
+			{
+				string code;
+				cout << "Enter coupon code: " << endl;
+				getline(cin, code);
+				cart.addCouponCode(code);
+			}
+			else if (input == 5)
 			{
 
 				menu = baseMenu;
@@ -377,7 +406,9 @@ int main()
 			cout << "4. Add/Remove/Restock/Change Price" << endl;
 			cout << "5. Add/Remove Discount" << endl;
 			cout << "6. View Inventory Alerts" << endl;
-			cout << "7. Logout" << endl;
+			cout << "7. View Checkout Metrics" << endl;
+			cout << "8. View Sales Report" << endl;
+			cout << "9. Logout" << endl;
 
 			while (getline(cin, inputStr))
 			{
@@ -420,10 +451,22 @@ int main()
 			}
 			else if (input == 6)
 			{
-				Products.alertInterface();
+				Products.alertInterface(history.getSalesCounters());
 				break;
 			}
 			else if (input == 7)
+			{
+				cout << "----------------- Checkout Metrics -----------------" << endl;
+				cout << CheckoutTransaction::metricsReport();
+				break;
+			}
+			else if (input == 8)
+			{
+				cout << "----------------- Sales Report -----------------" << endl;
+				cout << history.getSalesCounters().report(time(NULL));
+				break;
+			}
+			else if (input == 9)
 			{
 				menu = loginMenu;
 				break;
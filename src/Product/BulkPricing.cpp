@@ -0,0 +1,148 @@
+/** \file BulkPricing.h
+ * \brief Tiered quantity pricing for a product.
+ * \details A breakpoint table mapping a minimum purchase quantity to a fractional price reduction. Breakpoints
+ * and modifiers are kept in two parallel vectors sorted by quantity, so looking up the tier for a quantity is a binary search.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include "BulkPricing.h"
+
+using namespace std;
+
+/**
+* Default constructor, creates an empty table (no bulk pricing).
+* @return None.
+*/
+BulkPricing::BulkPricing()
+{
+}
+
+/**
+ * Class destructor.
+ * @return None.
+ */
+BulkPricing::~BulkPricing()
+{
+}
+
+/**
+* Adds a tier, or replaces the modifier of an existing tier with the same breakpoint.
+* @param minQuantity Smallest quantity the tier applies to.
+* @param modifier Fraction taken off the unit price, e.g. 0.1 for 10% off.
+* @return None.
+*/
+void BulkPricing::setTier(int minQuantity, float modifier)
+{
+    vector<int>::iterator pos = lower_bound(breakpoints.begin(), breakpoints.end(), minQuantity);
+    size_t index = pos - breakpoints.begin();
+
+    if (pos != breakpoints.end() && *pos == minQuantity)
+    {
+        modifiers[index] = modifier;
+        return;
+    }
+    breakpoints.insert(pos, minQuantity);
+    modifiers.insert(modifiers.begin() + index, modifier);
+}
+
+/**
+* Removes the tier starting at a breakpoint, if there is one.
+* @param minQuantity Breakpoint of the tier to remove.
+* @return None.
+*/
+void BulkPricing::removeTier(int minQuantity)
+{
+    vector<int>::iterator pos = lower_bound(breakpoints.begin(), breakpoints.end(), minQuantity);
+    if (pos != breakpoints.end() && *pos == minQuantity)
+    {
+        modifiers.erase(modifiers.begin() + (pos - breakpoints.begin()));
+        breakpoints.erase(pos);
+    }
+}
+
+/**
+* Removes every tier.
+* @return None.
+*/
+void BulkPricing::clear()
+{
+    breakpoints.clear();
+    modifiers.clear();
+}
+
+/**
+* Finds the modifier of the highest tier whose breakpoint does not exceed the quantity.
+* @param quantity Quantity being purchased.
+* @return Fraction taken off the unit price, 0 if no tier applies.
+*/
+float BulkPricing::modifierFor(int quantity) const
+{
+    vector<int>::const_iterator pos = upper_bound(breakpoints.begin(), breakpoints.end(), quantity);
+    if (pos == breakpoints.begin())
+    {
+        return 0;
+    }
+    return modifiers[(pos - breakpoints.begin()) - 1];
+}
+
+/**
+* Gets the number of tiers.
+* @return Integer number of tiers.
+*/
+int BulkPricing::size() const
+{
+    return breakpoints.size();
+}
+
+/**
+* Checks if the table has no tiers.
+* @return True if there are no tiers, false otherwise.
+*/
+bool BulkPricing::empty() const
+{
+    return breakpoints.empty();
+}
+
+/**
+* Converts the table to its database form, "quantity:modifier" pairs separated by ';'.
+* @return String form of the table, empty if there are no tiers.
+*/
+string BulkPricing::toString() const
+{
+    ostringstream out;
+    for (size_t i = 0; i < breakpoints.size(); i++)
+    {
+        if (i > 0)
+            out << ';';
+        out << breakpoints[i] << ':' << modifiers[i];
+    }
+    return out.str();
+}
+
+/**
+* Parses the database form written by toString. Malformed pairs are skipped.
+* @param text String of "quantity:modifier" pairs separated by ';'.
+* @return The parsed table.
+*/
+BulkPricing BulkPricing::fromString(const string &text)
+{
+    BulkPricing table;
+    istringstream iss(text);
+    string pair;
+
+    while (getline(iss, pair, ';'))
+    {
+        size_t colon = pair.find(':');
+        if (colon == string::npos)
+            continue;
+        try
+        {
+            table.setTier(stoi(pair.substr(0, colon)), stof(pair.substr(colon + 1)));
+        }
+        catch (const exception &)
+        {
+        }
+    }
+    return table;
+}
@@ -0,0 +1,28 @@
+/** \file BulkPricing.h
+ */
+#ifndef BULK_PRICING_H
+#define BULK_PRICING_H
+
+#include <string>
+#include <vector>
+
+class BulkPricing
+{
+private:
+    std::vector<int> breakpoints;
+    std::vector<float> modifiers;
+
+public:
+    BulkPricing();
+    ~BulkPricing();
+    void setTier(int minQuantity, float modifier);
+    void removeTier(int minQuantity);
+    void clear();
+    float modifierFor(int quantity) const;
+    int size() const;
+    bool empty() const;
+    std::string toString() const;
+    static BulkPricing fromString(const std::string &text);
+};
+
+#endif
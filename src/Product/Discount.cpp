@@ -1,7 +1,7 @@
 /** \file Discount.h
  * \brief Class containing the discount object.
  * \details The discount object, containing information for which product the disount is for, 
- * the value of the discount, and the discount's expiry date.
+ * the value of the discount, and the discount's expiry date. A discount with no expiry date is stored with day 0.
  * \author Justin Woo
  */
 
@@ -14,24 +14,30 @@ using namespace std;
 */
 Discount::Discount()
 {
+    this->amount = 0;
+    this->endDate = tm();
 }
 
 /** 
  * Contructor with parameters for creating a discount object.
 * @param product Product to associate the discount with.
 * @param amount Value of the discount.
-* @param day Day the discount expires.
-* @param month Month the discount expires.
-* @param year Year the discount expires.
+* @param day Last day of the month the discount is valid on, or 0 if the discount never expires.
+* @param month Month the discount expires (1-12).
+* @param year Year the discount expires, e.g. 2024.
 * @return None.
 */
 Discount::Discount(string product, float amount, int day, int month, int year){
     this->productID = product;
     this->amount = amount;
     this->endDate = tm();
-    endDate.tm_mday = day;
-    endDate.tm_mon = month;
-    endDate.tm_year = year;
+    if (day > 0)
+    {
+        endDate.tm_mday = day;
+        endDate.tm_mon = month - 1;
+        endDate.tm_year = year - 1900;
+        endDate.tm_isdst = -1;
+    }
 }
 
 /**
@@ -46,7 +52,7 @@ Discount::~Discount()
 * Gets the unique product ID associated with a discount.
 * @return String of unique product ID.
 */
-string Discount::getProductID(){
+string Discount::getProductID() const{
     return productID;
 }
 
@@ -54,14 +60,54 @@ string Discount::getProductID(){
 * Gets the value of the discount
 * @return Float of discount's value.
 */
-float Discount::getAmount(){
+float Discount::getAmount() const{
     return amount;
 }
 
+/**
+* Gets the day of the month the discount expires on.
+* @return Day of the month, or 0 if the discount never expires.
+*/
+int Discount::getDay() const{
+    return endDate.tm_mday;
+}
+
+/**
+* Gets the month the discount expires in.
+* @return Month from 1 to 12, or 0 if the discount never expires.
+*/
+int Discount::getMonth() const{
+    return endDate.tm_mday > 0 ? endDate.tm_mon + 1 : 0;
+}
+
+/**
+* Gets the year the discount expires in.
+* @return Year, or 0 if the discount never expires.
+*/
+int Discount::getYear() const{
+    return endDate.tm_mday > 0 ? endDate.tm_year + 1900 : 0;
+}
+
+/**
+* Gets the time the discount stops being valid, which is midnight at the end of its expiry day (local time).
+* @return Expiry time, or 0 if the discount never expires.
+*/
+time_t Discount::getExpiry() const{
+    if (endDate.tm_mday == 0)
+    {
+        return 0;
+    }
+
+    tm end = endDate;
+    end.tm_mday++; // mktime normalizes the day after the end of a month
+    return mktime(&end);
+}
+
 /**
 * Checks by date if a discount has expired.
 * @return True if the discount is valid, false if it is expired.
 */
-bool Discount::checkDate(){
-    return false;
+bool Discount::checkDate() const{
+    time_t expiry = getExpiry();
+    return expiry == 0 || time(NULL) < expiry;
 }
\ No newline at end of file
@@ -18,9 +18,13 @@ public:
     Discount();
     Discount(std::string product, float amount, int day, int month, int year);
     ~Discount();
-    std::string getProductID();
-    float getAmount();
-    bool checkDate();
+    std::string getProductID() const;
+    float getAmount() const;
+    int getDay() const;
+    int getMonth() const;
+    int getYear() const;
+    time_t getExpiry() const;
+    bool checkDate() const;
 };
 
 #endif
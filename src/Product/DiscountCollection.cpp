@@ -1,12 +1,19 @@
 /** \file DiscountCollection.h
  * \brief Functionality for maintaining the discount database.
- * \details Class that handles the processing of the discount database.
+ * \details Class that handles the processing of the discount database. Discounts are stored in the shared
+ * DiscountPool; the collection maps each product ID to the handle of its discount. Discounts with an expiry date
+ * are also kept in a min-heap on expiry time, so finding the ones that have run out only looks at the top of the heap.
+ * Scheduled promotions are kept in a PromotionSchedule, and the active promotion of every product is refreshed only
+ * when a promotion starts or ends. Discount rules (by category, price band or ID pattern) are indexed by category,
+ * and adding or removing a rule only reprices the products it matches. Each product caches the result of all three
+ * sources, so pricing reads a single precomputed effective price.
  * \author Justin Woo
  */
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include "DiscountCollection.h"
 
 using namespace std;
@@ -17,39 +24,137 @@ using namespace std;
 */
 DiscountCollection::DiscountCollection()
 {
-    std::unordered_map<std::string, Discount> temp;
+    std::unordered_map<std::string, DiscountHandle> temp;
     this->discountCollection = temp;
+    this->pCollection = NULL;
+    this->nextPromotionChange = 0;
+    this->promotionsChanged = false;
+    this->nextRuleID = 1;
+    this->loadReport = DiscountLoadReport();
 }
 /**
-* Constructor reads from product collection to check for discounts.
+* Constructor loads the discounts, promotions and discount rules and applies them to the products in the collection.
 * @param pCollection Reference to product collection.
 * @return None.
 */
 DiscountCollection::DiscountCollection(ProductCollection *pCollection)
 {
-    std::unordered_map<std::string, Discount> temp;
+    std::unordered_map<std::string, DiscountHandle> temp;
     this->discountCollection = temp;
+    this->pCollection = pCollection;
+    this->nextPromotionChange = 0;
+    this->promotionsChanged = true;
+    this->nextRuleID = 1;
+
+    loadDiscounts();
+    promotions.loadFromDatabase();
+    loadRules();
+    for (int i = 0; i < pCollection->size(); i++)
+    {
+        pCollection->getProduct(i)->setRuleDiscount(ruleDiscountFor(*pCollection->getProduct(i)));
+    }
+    update(time(NULL));
+}
+
+/**
+* Loads discounts.csv as a hash join against the catalog's ID index. Each row is probed against the index once, and
+* rows for products not in the catalog, repeated rows for a product and rows that cannot be parsed are skipped and
+* recorded in the load report, so loading is linear in the size of both files.
+* @return None.
+*/
+void DiscountCollection::loadDiscounts()
+{
+    loadReport = DiscountLoadReport();
 
     ifstream input;
-    string fileName;
     input.open("discounts.csv");
 
     string line, key;
     getline(input, line); // Skip first line of CSV file (headings)
 
+    int lineNumber = 1;
     while (getline(input, line))
     { // Read lines of CSV file into a 'Discount' object
+        lineNumber++;
+        if (line.empty())
+        {
+            continue;
+        }
+        loadReport.rows++;
+
         istringstream iss(line);
-        getline(iss, key, ',');
-        string prodID = key;
-        getline(iss, key, ',');
-        string amount = key;
+        string prodID, amount;
+        getline(iss, prodID, ',');
+        getline(iss, amount, ',');
+
+        // Older files were saved without the expiry columns
+        int date[3] = {0, 0, 0};
+        float value;
+        try
+        {
+            value = stof(amount);
+            for (int i = 0; i < 3 && getline(iss, key, ','); i++)
+            {
+                date[i] = stoi(key);
+            }
+        }
+        catch (const std::exception &)
+        {
+            loadReport.malformedLines.push_back(lineNumber);
+            continue;
+        }
 
-        Discount discount = Discount(prodID, stof(amount), 0, 0, 0);
-        discountCollection[prodID] = discount; // Add discount to discount dictionary
-        pCollection->getProduct(pCollection->findProduct(prodID))->setDiscount(&discountCollection[prodID]); // Update the product collection to hold the discount
+        int index = pCollection->findProduct(prodID);
+        if (index == -1)
+        {
+            loadReport.orphaned.push_back(prodID);
+            continue;
+        }
+        if (discountCollection.find(prodID) != discountCollection.end())
+        {
+            loadReport.duplicates.push_back(prodID);
+            continue;
+        }
+
+        Discount discount = Discount(prodID, value, date[0], date[1], date[2]);
+        if (!discount.checkDate())
+        {
+            loadReport.expired++; // Expired while the program was not running
+            continue;
+        }
+
+        attach(pCollection->getProduct(index), discount); // Add discount to discount dictionary and the product
+        loadReport.loaded++;
     }
     input.close();
+
+    if (loadReport.orphaned.empty() && loadReport.duplicates.empty() && loadReport.malformedLines.empty())
+    {
+        return;
+    }
+
+    cout << "Warning: some rows of discounts.csv were skipped and will be dropped when discounts are saved" << endl;
+    if (!loadReport.orphaned.empty())
+    {
+        cout << "  " << loadReport.orphaned.size() << " for products not in the catalog:";
+        for (unsigned i = 0; i < loadReport.orphaned.size(); i++)
+            cout << " " << loadReport.orphaned[i];
+        cout << endl;
+    }
+    if (!loadReport.duplicates.empty())
+    {
+        cout << "  " << loadReport.duplicates.size() << " repeating a product that already has a discount:";
+        for (unsigned i = 0; i < loadReport.duplicates.size(); i++)
+            cout << " " << loadReport.duplicates[i];
+        cout << endl;
+    }
+    if (!loadReport.malformedLines.empty())
+    {
+        cout << "  " << loadReport.malformedLines.size() << " that could not be read, on line(s):";
+        for (unsigned i = 0; i < loadReport.malformedLines.size(); i++)
+            cout << " " << loadReport.malformedLines[i];
+        cout << endl;
+    }
 }
 
 /**
@@ -60,12 +165,32 @@ DiscountCollection::~DiscountCollection()
 {
 }
 
+/**
+* Stores a discount in the pool, records it for its product, points the product at it and schedules its expiry.
+* @param product Product the discount is for.
+* @param discount Discount to store.
+* @return None.
+*/
+void DiscountCollection::attach(Product *product, const Discount &discount)
+{
+    DiscountHandle handle = DiscountPool::shared().allocate(discount);
+    discountCollection[product->getID()] = handle;
+    product->setDiscount(handle);
+
+    time_t expiry = discount.getExpiry();
+    if (expiry != 0)
+    {
+        DiscountExpiry entry = {expiry, handle, product->getID()};
+        expiryQueue.push(entry);
+    }
+}
+
 /**
 * Attaches a discount and expiry date to a product.
 * @param product Product to add the discount to.
 * @param discountAmount Discount value for the product.
-* @param day Day of discount expiry.
-* @param month Month of discount expiry.
+* @param day Last day the discount is valid on, or 0 for a discount that never expires.
+* @param month Month of discount expiry (1-12).
 * @param year Year of discount expiry.
 * @return None.
 */
@@ -86,9 +211,13 @@ void DiscountCollection::addDiscount(Product *product, float discountAmount, int
     else
     {
         Discount discount = Discount(product->getID(), discountAmount, day, month, year);
-        discountCollection[product->getID()] = discount;
-        product->setDiscount(&discountCollection[product->getID()]);
+        if (!discount.checkDate())
+        {
+            cout << "The expiry date of a discount must not be in the past" << endl;
+            return;
+        }
 
+        attach(product, discount);
         cout << "Discount was added successfully" << endl;
     }
 }
@@ -100,10 +229,13 @@ void DiscountCollection::addDiscount(Product *product, float discountAmount, int
 */
 void DiscountCollection::removeDiscount(Product *product)
 {
-    if (discountCollection.find(product->getID()) != discountCollection.end())
+    std::unordered_map<std::string, DiscountHandle>::iterator it = discountCollection.find(product->getID());
+    if (it != discountCollection.end())
     {
-        product->setDiscount(NULL);
-        discountCollection.erase(product->getID());
+        // Releasing the slot also detaches the discount from any copies of the product held by carts
+        DiscountPool::shared().release(it->second);
+        product->setDiscount(DiscountHandle());
+        discountCollection.erase(it);
         cout << "Discount was removed successfully" << endl;
         return;
     }
@@ -115,7 +247,345 @@ void DiscountCollection::removeDiscount(Product *product)
 }
 
 /**
-* Saves discount information to discount database file.
+* Removes every discount whose expiry time has passed. Each expired discount's pool slot is released, which
+* detaches it from its product and from any copies of the product held by carts. Entries for discounts that
+* were already removed by hand are skipped when they reach the top of the heap.
+* @param now Current time.
+* @return Number of discounts that expired.
+*/
+int DiscountCollection::expireDiscounts(time_t now)
+{
+    int expired = 0;
+
+    while (!expiryQueue.empty() && expiryQueue.top().expiry <= now)
+    {
+        DiscountExpiry entry = expiryQueue.top();
+        expiryQueue.pop();
+
+        if (!DiscountPool::shared().isLive(entry.handle))
+        {
+            continue;
+        }
+
+        DiscountPool::shared().release(entry.handle);
+        discountCollection.erase(entry.productID);
+        expired++;
+
+        // Refresh the product's cached price, copies held by carts see the stale handle on their own
+        int index = pCollection != NULL ? pCollection->findProduct(entry.productID) : -1;
+        if (index != -1)
+        {
+            pCollection->getProduct(index)->setDiscount(DiscountHandle());
+        }
+    }
+    return expired;
+}
+
+/**
+* Schedules a promotion. The product or category it targets must exist in the catalog.
+* @param scope Whether the promotion applies to one product, one category or every product.
+* @param target Product ID or category name, ignored for the global scope.
+* @param amount Fraction taken off the price, e.g. 0.25 for 25% off.
+* @param start Time the promotion starts.
+* @param end Time the promotion ends.
+* @return ID of the new promotion, or -1 if it could not be scheduled.
+*/
+int DiscountCollection::addPromotion(PromotionScope scope, std::string target, float amount, time_t start, time_t end)
+{
+    if (scope == productScope && (pCollection == NULL || pCollection->findProduct(target) == -1))
+    {
+        cout << "There is no product with that ID" << endl;
+        return -1;
+    }
+    if (scope == categoryScope)
+    {
+        bool found = false;
+        for (int i = 0; pCollection != NULL && i < pCollection->size() && !found; i++)
+        {
+            found = pCollection->getProduct(i)->getCategory() == target;
+        }
+        if (!found)
+        {
+            cout << "There is no category with that name" << endl;
+            return -1;
+        }
+    }
+
+    int id = promotions.addPromotion(scope, target, amount, start, end);
+    if (id == -1)
+    {
+        cout << "A promotion must take off less than 100% and end after it starts" << endl;
+        return -1;
+    }
+
+    promotionsChanged = true;
+    cout << "Promotion was scheduled successfully" << endl;
+    return id;
+}
+
+/**
+* Cancels a scheduled promotion.
+* @param id ID of the promotion.
+* @return 0 on success, -1 if there is no promotion with that ID.
+*/
+int DiscountCollection::removePromotion(int id)
+{
+    if (promotions.removePromotion(id) == -1)
+    {
+        cout << "There is no promotion with that ID" << endl;
+        return -1;
+    }
+
+    promotionsChanged = true;
+    cout << "Promotion was cancelled successfully" << endl;
+    return 0;
+}
+
+/**
+* Gets the promotion schedule, e.g. to preview the promotions active at a future time.
+* @return Reference to the schedule.
+*/
+const PromotionSchedule &DiscountCollection::getPromotions() const
+{
+    return promotions;
+}
+
+/**
+* Brings discounts up to date with the current time. Expired discounts are removed, and if a promotion has started
+* or ended since the last update (or the schedule was edited) every product's active promotion is recomputed.
+* @param now Current time.
+* @return None.
+*/
+void DiscountCollection::update(time_t now)
+{
+    expireDiscounts(now);
+
+    if (pCollection == NULL || (!promotionsChanged && (nextPromotionChange == 0 || now < nextPromotionChange)))
+    {
+        return;
+    }
+
+    for (int i = 0; i < pCollection->size(); i++)
+    {
+        Product *product = pCollection->getProduct(i);
+        product->setPromotion(promotions.discountAt(*product, now));
+    }
+    nextPromotionChange = promotions.nextChange(now);
+    promotionsChanged = false;
+}
+
+/**
+* Adds a rule to the lookup structures. Category rules are bucketed by category, other rules are checked against every product.
+* @param rule Rule to index.
+* @return None.
+*/
+void DiscountCollection::indexRule(const DiscountRule &rule)
+{
+    if (rule.getType() == categoryRule)
+    {
+        categoryRules[rule.getPattern()].push_back(rule.getID());
+    }
+    else
+    {
+        otherRules.push_back(rule.getID());
+    }
+}
+
+/**
+* Finds the best discount given to a product by the rules.
+* @param product Product to check.
+* @return Largest amount of any matching rule, or 0 if none match.
+*/
+float DiscountCollection::ruleDiscountFor(const Product &product) const
+{
+    float best = 0;
+
+    std::unordered_map<std::string, std::vector<int>>::const_iterator bucket = categoryRules.find(product.getCategory());
+    if (bucket != categoryRules.end())
+    {
+        for (unsigned i = 0; i < bucket->second.size(); i++)
+        {
+            best = max(best, rules.at(bucket->second[i]).getAmount());
+        }
+    }
+    for (unsigned i = 0; i < otherRules.size(); i++)
+    {
+        const DiscountRule &rule = rules.at(otherRules[i]);
+        if (rule.getAmount() > best && rule.matches(product))
+        {
+            best = rule.getAmount();
+        }
+    }
+    return best;
+}
+
+/**
+* Adds a discount rule and reprices the products it matches.
+* @param type What the rule matches products on.
+* @param pattern Category name or ID pattern, ignored for a price band rule.
+* @param minPrice Lowest base price matched by a price band rule.
+* @param maxPrice Highest base price matched by a price band rule.
+* @param amount Fraction taken off the price of matching products.
+* @return ID of the new rule, or -1 if the rule is invalid.
+*/
+int DiscountCollection::addRule(DiscountRuleType type, std::string pattern, float minPrice, float maxPrice, float amount)
+{
+    if (amount <= 0 || amount >= 1)
+    {
+        cout << "A discount rule must take off more than 0% and less than 100%" << endl;
+        return -1;
+    }
+    if (type == priceBandRule && (minPrice < 0 || maxPrice < minPrice))
+    {
+        cout << "The price band is invalid" << endl;
+        return -1;
+    }
+    if (type != priceBandRule && pattern.empty())
+    {
+        cout << "The rule needs a category or ID pattern" << endl;
+        return -1;
+    }
+
+    DiscountRule rule = DiscountRule(nextRuleID++, type, type == priceBandRule ? "" : pattern, minPrice, maxPrice, amount);
+    rules[rule.getID()] = rule;
+    indexRule(rule);
+
+    // A new rule can only raise the rule discount of the products it matches
+    int matched = 0;
+    for (int i = 0; pCollection != NULL && i < pCollection->size(); i++)
+    {
+        Product *product = pCollection->getProduct(i);
+        if (rule.matches(*product))
+        {
+            product->setRuleDiscount(max(product->getRuleDiscount(), amount));
+            matched++;
+        }
+    }
+
+    cout << "Discount rule was added successfully, it applies to " << matched << " product(s)" << endl;
+    return rule.getID();
+}
+
+/**
+* Removes a discount rule and reprices the products it matched.
+* @param id ID of the rule.
+* @return 0 on success, -1 if there is no rule with that ID.
+*/
+int DiscountCollection::removeRule(int id)
+{
+    std::map<int, DiscountRule>::iterator it = rules.find(id);
+    if (it == rules.end())
+    {
+        cout << "There is no discount rule with that ID" << endl;
+        return -1;
+    }
+
+    DiscountRule rule = it->second;
+    std::vector<int> &bucket = rule.getType() == categoryRule ? categoryRules[rule.getPattern()] : otherRules;
+    bucket.erase(std::find(bucket.begin(), bucket.end(), id));
+    rules.erase(it);
+
+    for (int i = 0; pCollection != NULL && i < pCollection->size(); i++)
+    {
+        Product *product = pCollection->getProduct(i);
+        if (rule.matches(*product))
+        {
+            product->setRuleDiscount(ruleDiscountFor(*product));
+        }
+    }
+
+    cout << "Discount rule was removed successfully" << endl;
+    return 0;
+}
+
+/**
+* Gets the discount rules.
+* @return Map of rule ID to rule.
+*/
+const std::map<int, DiscountRule> &DiscountCollection::getRules() const
+{
+    return rules;
+}
+
+/**
+* Recomputes the rule and promotion discounts of one product. Call after a product is added or its price or category changes.
+* @param product Product to reprice.
+* @return None.
+*/
+void DiscountCollection::reprice(Product *product)
+{
+    product->setRuleDiscount(ruleDiscountFor(*product));
+    product->setPromotion(promotions.discountAt(*product, time(NULL)));
+}
+
+/**
+* Gets the outcome of loading the discount and discount rule database files.
+* @return Counts of loaded and expired rows and the orphaned, duplicate and malformed rows that were skipped.
+*/
+const DiscountLoadReport &DiscountCollection::getLoadReport() const
+{
+    return loadReport;
+}
+
+/**
+* Reads the discount rule database file. Rows that cannot be parsed, or whose type is not a DiscountRuleType, are
+* skipped and recorded in the load report.
+* @return None.
+*/
+void DiscountCollection::loadRules()
+{
+    ifstream input;
+    input.open("discountRules.csv");
+
+    string line;
+    getline(input, line); // Skip first line of CSV file (headings)
+
+    int lineNumber = 1;
+    while (getline(input, line))
+    {
+        lineNumber++;
+        if (line.empty())
+        {
+            continue;
+        }
+
+        istringstream iss(line);
+        string type, pattern, minPrice, maxPrice, amount;
+        getline(iss, type, ',');
+        getline(iss, pattern, ',');
+        getline(iss, minPrice, ',');
+        getline(iss, maxPrice, ',');
+        getline(iss, amount, ',');
+
+        int typeNumber = -1;
+        float low = 0, high = 0, value = 0;
+        try
+        {
+            typeNumber = stoi(type);
+            low = stof(minPrice);
+            high = stof(maxPrice);
+            value = stof(amount);
+        }
+        catch (const std::exception &)
+        {
+            typeNumber = -1;
+        }
+        if (typeNumber < categoryRule || typeNumber > idPatternRule)
+        {
+            cerr << "Skipping malformed discount rule: " << line << endl;
+            loadReport.malformedRuleLines.push_back(lineNumber);
+            continue;
+        }
+
+        DiscountRule rule = DiscountRule(nextRuleID++, (DiscountRuleType)typeNumber, pattern, low, high, value);
+        rules[rule.getID()] = rule;
+        indexRule(rule);
+    }
+    input.close();
+}
+
+/**
+* Saves discount information, the promotion schedule and the discount rules to their database files.
 * @return None.
 */
 void DiscountCollection::saveToDatabase()
@@ -128,13 +598,24 @@ void DiscountCollection::saveToDatabase()
     // write the productsList vector into the empty csv file
     ofstream file;
     file.open("discounts.csv");
-    file << "Product,Amount\n"; // create the column titles
+    file << "Product,Amount,Day,Month,Year\n"; // create the column titles
 
     // create a discount entry for each discount in the list
     for (auto it : discountCollection)
     {
-        file << it.first << "," << it.second.getAmount() << '\n';
+        const Discount *discount = DiscountPool::shared().resolve(it.second);
+        file << it.first << "," << discount->getAmount() << "," << discount->getDay() << "," << discount->getMonth() << "," << discount->getYear() << '\n';
     }
 
     file.close();
+    promotions.saveToDatabase();
+
+    ofstream ruleFile;
+    ruleFile.open("discountRules.csv", ofstream::out | ofstream::trunc);
+    ruleFile << "Type,Pattern,MinPrice,MaxPrice,Amount\n"; // create the column titles
+    for (std::map<int, DiscountRule>::iterator it = rules.begin(); it != rules.end(); ++it)
+    {
+        ruleFile << it->second.getType() << "," << it->second.getPattern() << "," << it->second.getMinPrice() << "," << it->second.getMaxPrice() << "," << it->second.getAmount() << '\n';
+    }
+    ruleFile.close();
 }
\ No newline at end of file
@@ -4,13 +4,58 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <map>
+#include <queue>
+#include <functional>
+#include <ctime>
 #include "Discount.h"
+#include "DiscountPool.h"
 #include "ProductCollection.h"
+#include "PromotionSchedule.h"
+#include "DiscountRule.h"
+
+/** A discount waiting to expire, ordered by expiry time. */
+struct DiscountExpiry
+{
+    time_t expiry;
+    DiscountHandle handle;
+    std::string productID;
+
+    bool operator>(const DiscountExpiry &other) const { return expiry > other.expiry; }
+};
+
+/** Outcome of loading discounts.csv and discountRules.csv. Rows listed here were skipped and are dropped on the next save. */
+struct DiscountLoadReport
+{
+    int rows;
+    int loaded;
+    int expired;
+    std::vector<std::string> orphaned;
+    std::vector<std::string> duplicates;
+    std::vector<int> malformedLines;
+    std::vector<int> malformedRuleLines;
+};
 
 class DiscountCollection
 {
 private:
-    std::unordered_map<std::string, Discount> discountCollection;
+    std::unordered_map<std::string, DiscountHandle> discountCollection;
+    std::priority_queue<DiscountExpiry, std::vector<DiscountExpiry>, std::greater<DiscountExpiry>> expiryQueue;
+    ProductCollection *pCollection;
+    PromotionSchedule promotions;
+    time_t nextPromotionChange;
+    bool promotionsChanged;
+    std::map<int, DiscountRule> rules;
+    std::unordered_map<std::string, std::vector<int>> categoryRules;
+    std::vector<int> otherRules;
+    int nextRuleID;
+    DiscountLoadReport loadReport;
+
+    void loadDiscounts();
+    void attach(Product *product, const Discount &discount);
+    void indexRule(const DiscountRule &rule);
+    float ruleDiscountFor(const Product &product) const;
+    void loadRules();
 
 public:
     DiscountCollection();
@@ -18,6 +63,16 @@ public:
     ~DiscountCollection();
     void addDiscount(Product *product, float discountAmount, int day, int month, int year);
     void removeDiscount(Product *product);
+    int expireDiscounts(time_t now);
+    int addPromotion(PromotionScope scope, std::string target, float amount, time_t start, time_t end);
+    int removePromotion(int id);
+    const PromotionSchedule &getPromotions() const;
+    void update(time_t now);
+    int addRule(DiscountRuleType type, std::string pattern, float minPrice, float maxPrice, float amount);
+    int removeRule(int id);
+    const std::map<int, DiscountRule> &getRules() const;
+    void reprice(Product *product);
+    const DiscountLoadReport &getLoadReport() const;
     void saveToDatabase();
 };
 
@@ -0,0 +1,112 @@
+/** \file DiscountPool.h
+ * \brief Slab of discount objects addressed by generation-checked handles.
+ * \details Discounts live in a flat vector of slots. A slot keeps its index for as long as it is allocated, and
+ * released slots are reused through a free list. Every slot carries a generation that is bumped on release, so a
+ * handle held by a product (or a copy of it sitting in a cart) stops resolving as soon as its discount is removed,
+ * instead of pointing at freed or reused memory. Resolving a handle is one indexed load and a compare.
+ */
+
+#include "DiscountPool.h"
+
+using namespace std;
+
+/**
+* Default constructor, creates an empty pool.
+* @return None.
+*/
+DiscountPool::DiscountPool()
+{
+}
+
+/**
+ * Class destructor.
+ * @return None.
+ */
+DiscountPool::~DiscountPool()
+{
+}
+
+/**
+* Stores a discount in a free slot, growing the pool if there is none.
+* @param discount Discount to store.
+* @return Handle to the new slot.
+*/
+DiscountHandle DiscountPool::allocate(const Discount &discount)
+{
+    unsigned int index;
+
+    if (!freeSlots.empty())
+    {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+        slots[index] = discount;
+    }
+    else
+    {
+        index = slots.size();
+        slots.push_back(discount);
+        generations.push_back(1);
+    }
+
+    return DiscountHandle(index, generations[index]);
+}
+
+/**
+* Frees the slot a handle refers to. Every handle to the slot becomes stale. Stale or null handles are ignored.
+* @param handle Handle of the discount to free.
+* @return None.
+*/
+void DiscountPool::release(DiscountHandle handle)
+{
+    if (!isLive(handle))
+    {
+        return;
+    }
+
+    generations[handle.index]++;
+    slots[handle.index] = Discount();
+    freeSlots.push_back(handle.index);
+}
+
+/**
+* Looks up the discount a handle refers to. The pointer is only valid until the next allocate() call.
+* @param handle Handle of the discount.
+* @return Pointer to the discount, or NULL if the handle is null or stale.
+*/
+const Discount *DiscountPool::resolve(DiscountHandle handle) const
+{
+    if (!isLive(handle))
+    {
+        return NULL;
+    }
+    return &slots[handle.index];
+}
+
+/**
+* Checks if a handle still refers to an allocated discount.
+* @param handle Handle to check.
+* @return True if the handle resolves, false otherwise.
+*/
+bool DiscountPool::isLive(DiscountHandle handle) const
+{
+    return handle.index < generations.size() && generations[handle.index] == handle.generation;
+}
+
+/**
+* Gets the number of allocated discounts.
+* @return Number of slots in use.
+*/
+int DiscountPool::size() const
+{
+    return slots.size() - freeSlots.size();
+}
+
+/**
+* Gets the process-wide pool that product discounts are allocated from.
+* @return Reference to the shared pool.
+*/
+DiscountPool &DiscountPool::shared()
+{
+    static DiscountPool pool;
+    return pool;
+}
@@ -0,0 +1,38 @@
+/** \file DiscountPool.h
+ */
+#ifndef DISCOUNT_POOL_H
+#define DISCOUNT_POOL_H
+
+#include <vector>
+#include "Discount.h"
+
+/** Reference to a discount slot. A handle goes stale once its slot is released, even if the slot is reused. */
+struct DiscountHandle
+{
+    unsigned int index;
+    unsigned int generation;
+
+    DiscountHandle() : index(0), generation(0) {}
+    DiscountHandle(unsigned int index, unsigned int generation) : index(index), generation(generation) {}
+    bool isNull() const { return generation == 0; }
+};
+
+class DiscountPool
+{
+private:
+    std::vector<Discount> slots;
+    std::vector<unsigned int> generations;
+    std::vector<unsigned int> freeSlots;
+
+public:
+    DiscountPool();
+    ~DiscountPool();
+    DiscountHandle allocate(const Discount &discount);
+    void release(DiscountHandle handle);
+    const Discount *resolve(DiscountHandle handle) const;
+    bool isLive(DiscountHandle handle) const;
+    int size() const;
+    static DiscountPool &shared();
+};
+
+#endif
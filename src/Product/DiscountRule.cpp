@@ -0,0 +1,188 @@
+/** \file DiscountRule.h
+ * \brief A discount that applies to every product matching a rule.
+ * \details A rule takes a fraction off every product in a category, every product whose base price falls in a band,
+ * or every product whose ID matches a wildcard pattern ('*' matches any run of characters, '?' any single character).
+ */
+
+#include <sstream>
+#include "DiscountRule.h"
+
+using namespace std;
+
+/**
+* Default constructor, creates an empty rule that matches nothing.
+* @return None.
+*/
+DiscountRule::DiscountRule()
+{
+    this->id = 0;
+    this->type = categoryRule;
+    this->minPrice = 0;
+    this->maxPrice = 0;
+    this->amount = 0;
+}
+
+/**
+* Constructor with parameters for creating a discount rule.
+* @param id Unique ID of the rule.
+* @param type What the rule matches products on.
+* @param pattern Category name for a category rule, or ID pattern for an ID pattern rule.
+* @param minPrice Lowest base price matched by a price band rule (inclusive).
+* @param maxPrice Highest base price matched by a price band rule (inclusive).
+* @param amount Fraction taken off the price of matching products.
+* @return None.
+*/
+DiscountRule::DiscountRule(int id, DiscountRuleType type, string pattern, float minPrice, float maxPrice, float amount)
+{
+    this->id = id;
+    this->type = type;
+    this->pattern = pattern;
+    this->minPrice = minPrice;
+    this->maxPrice = maxPrice;
+    this->amount = amount;
+}
+
+/**
+ * Class destructor.
+ * @return None.
+ */
+DiscountRule::~DiscountRule()
+{
+}
+
+/**
+* Gets the unique ID of the rule.
+* @return Integer ID.
+*/
+int DiscountRule::getID() const
+{
+    return id;
+}
+
+/**
+* Gets what the rule matches products on.
+* @return Type of the rule.
+*/
+DiscountRuleType DiscountRule::getType() const
+{
+    return type;
+}
+
+/**
+* Gets the category name or ID pattern of the rule.
+* @return Pattern string, empty for a price band rule.
+*/
+const string &DiscountRule::getPattern() const
+{
+    return pattern;
+}
+
+/**
+* Gets the lowest price matched by a price band rule.
+* @return Minimum base price.
+*/
+float DiscountRule::getMinPrice() const
+{
+    return minPrice;
+}
+
+/**
+* Gets the highest price matched by a price band rule.
+* @return Maximum base price.
+*/
+float DiscountRule::getMaxPrice() const
+{
+    return maxPrice;
+}
+
+/**
+* Gets the value of the rule's discount.
+* @return Fraction taken off the price.
+*/
+float DiscountRule::getAmount() const
+{
+    return amount;
+}
+
+/**
+* Checks if the rule applies to a product.
+* @param product Product to check.
+* @return True if the product matches the rule.
+*/
+bool DiscountRule::matches(const Product &product) const
+{
+    if (type == categoryRule)
+    {
+        return product.getCategory() == pattern;
+    }
+    if (type == priceBandRule)
+    {
+        return product.getPrice() >= minPrice && product.getPrice() <= maxPrice;
+    }
+    return matchesPattern(pattern.c_str(), product.getID().c_str());
+}
+
+/**
+* Gets a one line description of the rule for display.
+* @return Description string.
+*/
+string DiscountRule::describe() const
+{
+    ostringstream oss;
+    oss << id << ": " << amount * 100 << "% off ";
+    if (type == categoryRule)
+    {
+        oss << "category " << pattern;
+    }
+    else if (type == priceBandRule)
+    {
+        oss << "products priced $" << minPrice << " to $" << maxPrice;
+    }
+    else
+    {
+        oss << "product IDs matching " << pattern;
+    }
+    return oss.str();
+}
+
+/**
+* Matches text against a wildcard pattern, where '*' matches any run of characters and '?' any single character.
+* @param pattern Wildcard pattern.
+* @param text Text to match.
+* @return True if the whole text matches the pattern.
+*/
+bool DiscountRule::matchesPattern(const char *pattern, const char *text)
+{
+    const char *star = NULL;
+    const char *resume = NULL;
+
+    while (*text)
+    {
+        if (*pattern == '*')
+        {
+            star = pattern++;
+            resume = text;
+        }
+        else if (*pattern == '?' || *pattern == *text)
+        {
+            pattern++;
+            text++;
+        }
+        else if (star != NULL)
+        {
+            // Let the last '*' swallow one more character and try again
+            pattern = star + 1;
+            text = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pattern == '*')
+    {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
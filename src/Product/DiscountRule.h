@@ -0,0 +1,41 @@
+/** \file DiscountRule.h
+ */
+#ifndef DISCOUNT_RULE_H
+#define DISCOUNT_RULE_H
+
+#include <string>
+#include "Product.h"
+
+enum DiscountRuleType
+{
+    categoryRule,
+    priceBandRule,
+    idPatternRule
+};
+
+class DiscountRule
+{
+private:
+    int id;
+    DiscountRuleType type;
+    std::string pattern;
+    float minPrice;
+    float maxPrice;
+    float amount;
+
+public:
+    DiscountRule();
+    DiscountRule(int id, DiscountRuleType type, std::string pattern, float minPrice, float maxPrice, float amount);
+    ~DiscountRule();
+    int getID() const;
+    DiscountRuleType getType() const;
+    const std::string &getPattern() const;
+    float getMinPrice() const;
+    float getMaxPrice() const;
+    float getAmount() const;
+    bool matches(const Product &product) const;
+    std::string describe() const;
+    static bool matchesPattern(const char *pattern, const char *text);
+};
+
+#endif
@@ -18,9 +18,12 @@ Product::Product() {
     this->productName = "";
     this->category = "";
     this->price = 0.00;
-	this->discount = NULL;
-    this->bulkModifier = 0.00;
+	this->discount = DiscountHandle();
+	this->promotion = 0;
+	this->ruleDiscount = 0;
     this->quantity = 0;
+    this->version = 0;
+    reprice();
 }
 /**
 * Constructor with specific parameters.
@@ -30,7 +33,7 @@ Product::Product() {
 * @param price Price of the product.
 * @param discount Product discount.
 * @param quantity On-hand quantity of the product.
-* @param bulkModifier
+* @param bulkModifier Fraction taken off the unit price for any quantity. Stored as a single bulk tier starting at 1 unit.
 * @return None.
 */
 Product::Product(std::string productName, std::string category, std::string id, float price, int quantity, float bulkModifier) {
@@ -39,8 +42,13 @@ Product::Product(std::string productName, std::string category, std::string id,
 	this->id = id;
 	this->price = price;
 	this->quantity = quantity;
-	this->discount = NULL;
-	this->bulkModifier = bulkModifier;
+	this->discount = DiscountHandle();
+	this->promotion = 0;
+	this->ruleDiscount = 0;
+	if (bulkModifier > 0)
+		this->bulkPricing.setTier(1, bulkModifier);
+	this->version = 0;
+	reprice();
 }
 
 /**
@@ -59,8 +67,11 @@ Product::Product(std::string productName, std::string category, std::string id,
 	this->id = id;
 	this->price = price;
 	this->quantity = quantity;
-	this->discount = NULL;
-	this->bulkModifier = 0;
+	this->discount = DiscountHandle();
+	this->promotion = 0;
+	this->ruleDiscount = 0;
+	this->version = 0;
+	reprice();
 }
 
 /**
@@ -78,47 +89,124 @@ void Product::setID(string new_id) {
     id = new_id;
 }
 /**
-* Sets a product name.
+* Sets a product name. Bumps the product's version stamp.
 * @param new_name Name for the product.
 * @return None.
 */
 void Product::setName(string new_name) { 
     productName = new_name; 
+    version++;
 }
 /**
-* Sets the category of the product.
+* Sets the category of the product. Bumps the product's version stamp. Rules matched on the old category no longer
+* apply, so the rule discount is cleared until DiscountCollection::reprice runs the rules again.
 * @param new_category Category for the product.
 * @return None.
 */
 void Product::setCategory(string new_category) {
-    category = new_category;
+    if (category != new_category)
+    {
+        category = new_category;
+        ruleDiscount = 0;
+        reprice();
+    }
+    version++;
 }
 /*void Product::setDiscount(float new_discount) {
     discount = new_discount;
 }*/
 /**
-* Sets the price of the product.
+* Sets the price of the product. Bumps the product's version stamp.
 * @param new_price Price of the product.
 * @return None.
 */
 void Product::setPrice(float new_price) { 
     price = new_price; 
+    reprice();
+    version++;
 }
 /**
-* Sets the on-hand quantity of the product.
+* Sets the on-hand quantity of the product. Bumps the product's version stamp.
 * @param new_quantity Quantity of the product.
 * @return None.
 */
 void Product::setQuantity(int new_quantity) { 
     quantity = new_quantity; 
+    version++;
 }
 /**
-* Sets the product discount.
-* @param *new_discount Product discount.
+* Sets the product discount. Bumps the product's version stamp.
+* @param new_discount Handle of the product's discount in the shared DiscountPool, or a null handle for none.
 * @return None.
 */
-void Product::setDiscount(Discount *new_discount){
+void Product::setDiscount(DiscountHandle new_discount){
 	discount = new_discount;
+	reprice();
+	version++;
+}
+/**
+* Sets the discount from the promotion currently running on the product. Bumps the product's version stamp if it changed.
+* @param new_promotion Fraction taken off the price by the active promotion, 0 if there is none.
+* @return None.
+*/
+void Product::setPromotion(float new_promotion){
+	if (promotion != new_promotion)
+	{
+		promotion = new_promotion;
+		reprice();
+		version++;
+	}
+}
+/**
+* Sets the discount from the best discount rule matching the product. Bumps the product's version stamp if it changed.
+* @param new_rule_discount Fraction taken off the price by matching rules, 0 if none match.
+* @return None.
+*/
+void Product::setRuleDiscount(float new_rule_discount){
+	if (ruleDiscount != new_rule_discount)
+	{
+		ruleDiscount = new_rule_discount;
+		reprice();
+		version++;
+	}
+}
+/**
+* Recomputes the cached discount rate and effective price. Called by every setter that changes one of their inputs,
+* so pricing never has to resolve the discount or compare the discount sources again.
+* @return None.
+*/
+void Product::reprice() const {
+	const Discount *own = getDiscount();
+	float rate = own != NULL ? own->getAmount() : 0;
+	if (promotion > rate)
+		rate = promotion;
+	if (ruleDiscount > rate)
+		rate = ruleDiscount;
+
+	discountRate = rate;
+	effectivePrice = price * (1 - rate);
+}
+/**
+* Drops the product's discount and recomputes the cached prices if the discount has been removed from the pool,
+* which bumps its slot's generation. Only copies of a product need this, the product in the collection is given a
+* null handle when its discount is removed.
+* @return None.
+*/
+void Product::dropStaleDiscount() const {
+	if (!discount.isNull() && !DiscountPool::shared().isLive(discount))
+	{
+		discount = DiscountHandle();
+		reprice();
+	}
+}
+/**
+* Sets the product's bulk pricing tiers. Bumps the product's version stamp.
+* @param new_pricing Breakpoint table of quantity tiers.
+* @return None.
+*/
+void Product::setBulkPricing(BulkPricing new_pricing){
+	bulkPricing = new_pricing;
+	version++;
 }
 /**
 * Gets the unique product ID.
@@ -131,55 +219,118 @@ string Product::getID() const{
 * Gets the product name.
 * @return A string with the product name.
 */
-string Product::getName() { 
+const string &Product::getName() const { 
     return productName; 
 }
 /**
 * Gets the product category.
 * @return A string with the product category.
 */
-string Product::getCategory() {
+const string &Product::getCategory() const {
     return category;
 }
 /**
-* Gets the product's discount.
-* @return A discount object for the product.
+* Gets the product's discount. A discount that has since been removed from the pool resolves to NULL.
+* @return A discount object for the product, or NULL if it has none.
 */
-Discount* Product::getDiscount() {
+const Discount* Product::getDiscount() const {
+    return DiscountPool::shared().resolve(discount);
+}
+/**
+* Gets the handle of the product's discount.
+* @return Handle into the shared DiscountPool.
+*/
+DiscountHandle Product::getDiscountHandle() const {
     return discount;
 }
 /**
+* Gets the discount from the promotion currently running on the product.
+* @return Fraction taken off the price, 0 if no promotion is active.
+*/
+float Product::getPromotion() const {
+    return promotion;
+}
+/**
+* Gets the discount from the best discount rule matching the product.
+* @return Fraction taken off the price, 0 if no rule matches.
+*/
+float Product::getRuleDiscount() const {
+    return ruleDiscount;
+}
+/**
+* Gets the discount applied when pricing the product: the largest of its own discount, its active promotion and its
+* matching rules. The value is cached, kept current by the setters and recomputed once the discount is removed.
+* @return Fraction taken off the price, 0 if there is none.
+*/
+float Product::getDiscountRate() const {
+    dropStaleDiscount();
+    return discountRate;
+}
+/**
+* Gets the unit price after the product's discount rate, before any bulk reduction. The value is cached, kept current
+* by the setters and recomputed once the discount is removed.
+* @return Discounted unit price.
+*/
+float Product::getEffectivePrice() const {
+    dropStaleDiscount();
+    return effectivePrice;
+}
+/**
 * Gets the price of the product.
 * @return A float with the product price.
 */
-float Product::getPrice() { 
+float Product::getPrice() const { 
     return price; 
 }
 /**
 * Gets the on-hand quantity of the product.
 * @return An integer representing the product's quantity.
 */
-int Product::getQuantity() { 
+int Product::getQuantity() const { 
     return quantity; 
 }
 /**
+* Gets the version stamp of the product. The stamp changes whenever the name, category, price, stock or discount changes,
+* which lets checkout detect that a product it read has since been modified.
+* @return An unsigned integer version stamp.
+*/
+unsigned int Product::getVersion() const {
+    return version;
+}
+/**
+* Gets the bulk price reduction for buying a given quantity of the product.
+* @param quantity Quantity being purchased.
+* @return Fraction taken off the unit price, 0 if no tier applies.
+*/
+float Product::getBulkModifier(int quantity) const {
+    return bulkPricing.modifierFor(quantity);
+}
+/**
+* Gets the product's bulk pricing tiers.
+* @return The product's breakpoint table.
+*/
+const BulkPricing &Product::getBulkPricing() const {
+    return bulkPricing;
+}
+/**
 * Adds to the product's on-hand quantity.
 * @param quantity Integer quantity to be added to current on-hand quantity.
 * @return None.
 */
 void Product::addQuantity(int quantity) {
 	this->quantity += quantity;
+	version++;
 }
 /**
 * Compares two unique product IDs to see if they are the same.
 * @param other Product object to check against
 * @return True if both product IDs are the same, false if not.
 */
-bool Product::operator == (const Product& other) {
+bool Product::operator == (const Product& other) const {
 	return this->getID() == other.getID();
 }
 
 ostream& operator<<(ostream& os, const Product& prod) {
-	os << prod.productName << "    " << prod.category << "    " << prod.id << "    " << prod.price << "    " << prod.quantity << "    " << prod.bulkModifier << endl;
+	os << prod.productName << "    " << prod.category << "    " << prod.id << "    " << prod.price << "    " << prod.quantity << "    " << prod.bulkPricing.toString() << endl;
 	return os;
 }
@@ -5,7 +5,8 @@
 #define PRODUCT_H
 #include <string>
 #include <iostream>
-#include "Discount.h"
+#include "DiscountPool.h"
+#include "BulkPricing.h"
 
 class Product
 {
@@ -16,8 +17,18 @@ private:
     float price;
     int quantity;
 
-    float bulkModifier;
-    Discount *discount;
+    BulkPricing bulkPricing;
+    // Cleared along with the cached prices by the getters once the discount is removed from the pool, since a copy
+    // of the product (e.g. in a cart) is not told about the removal
+    mutable DiscountHandle discount;
+    float promotion;
+    float ruleDiscount;
+    mutable float discountRate;
+    mutable float effectivePrice;
+    unsigned int version;
+
+    void reprice() const;
+    void dropStaleDiscount() const;
 
 public:
     Product();
@@ -28,20 +39,31 @@ public:
     ~Product();
 
     std::string getID() const;
-    std::string getName();
-    std::string getCategory();
-    Discount *getDiscount();
-    float getPrice();
-    int getQuantity();
+    const std::string &getName() const;
+    const std::string &getCategory() const;
+    const Discount *getDiscount() const;
+    DiscountHandle getDiscountHandle() const;
+    float getPromotion() const;
+    float getRuleDiscount() const;
+    float getDiscountRate() const;
+    float getEffectivePrice() const;
+    float getPrice() const;
+    int getQuantity() const;
+    unsigned int getVersion() const;
+    float getBulkModifier(int quantity) const;
+    const BulkPricing &getBulkPricing() const;
     void setID(std::string id);
     void setName(std::string productName);
     void setCategory(std::string category);
     void setPrice(float price);
     void setQuantity(int quantity);
-    void setDiscount(Discount *new_discount);
+    void setDiscount(DiscountHandle new_discount);
+    void setPromotion(float new_promotion);
+    void setRuleDiscount(float new_rule_discount);
+    void setBulkPricing(BulkPricing new_pricing);
 
     void addQuantity(int quantity);
-    bool operator==(const Product &other);
+    bool operator==(const Product &other) const;
     friend std::ostream &operator<<(std::ostream &os, const Product &prod);
 };
 
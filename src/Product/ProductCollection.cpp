@@ -1,6 +1,7 @@
 /*! \file ProductCollection.h
  * \brief Functions for maintaining product database. 
  * \details Reads and writes from/to the product database, including adding products and monitoring stock. 
+ * Every stock change is passed on to a StockAlerts queue, so low stock alerts are listed without scanning the catalog.
  * \authors Alex Broekhuyse, Shahryar Iqbal, Matthew Mombourquette
 */
 #include <iostream>
@@ -11,10 +12,28 @@
 #include <algorithm>
 #include <limits>
 #include <iomanip>
+#include <cstdlib>
+#include <cstring>
 #include "../ShoppingCart/Order.h"
 #include "ProductCollection.h"
 using namespace std;
 
+// Last column of the heading line, followed by the last journaled checkout the file holds
+constexpr auto CHECKOUT_HEADING = "Checkout=";
+
+/**
+* Writes one product as a line of the product database file.
+* @param out Stream to write to.
+* @param product Product to write.
+* @param quantity On-hand quantity to write for the product.
+* @return None.
+*/
+static void writeRecord(ostream &out, const Product &product, int quantity)
+{
+    float discount = product.getDiscount() != NULL ? product.getDiscount()->getAmount() : 0;
+    out << product.getID() << "," << product.getName() << "," << product.getCategory() << "," << product.getPrice() << "," << discount << "," << quantity << "," << product.getBulkPricing().toString() << "\n";
+}
+
 /**
 * Constructor reads from database file and puts product objects into a vector.
 * @param temp Tempory vector of product objects, use for loading products into application.
@@ -35,29 +54,55 @@ ProductCollection::ProductCollection()
     input.open("products.csv");
 
     string line, key;
-    getline(input, line); // Skip first line of CSV file (headings)
+    getline(input, line); // First line of CSV file holds the headings
+    size_t heading = line.find(CHECKOUT_HEADING);
+    lastCheckout = heading == string::npos ? 0 : strtoull(line.c_str() + heading + strlen(CHECKOUT_HEADING), NULL, 10);
 
     while (getline(input, line))
     { // Read lines of CSV file into a 'Product' object
         Product product;
+        vector<string> fields;
 
         istringstream iss(line);
-        getline(iss, key, ',');
-        product.setID(key);
-        getline(iss, key, ',');
-        product.setName(key);
-        getline(iss, key, ',');
-        product.setCategory(key);
-        getline(iss, key, ',');
-        product.setPrice(std::stof(key));
-        getline(iss, key, ',');
-        // product.setDiscount(std::stof(key));
-        getline(iss, key, ',');
-        product.setQuantity(std::stoi(key));
+        while (getline(iss, key, ','))
+        {
+            fields.push_back(key);
+        }
+        if (fields.size() < 5)
+        {
+            continue;
+        }
+
+        product.setID(fields[0]);
+        product.setName(fields[1]);
+        product.setCategory(fields[2]);
+        product.setPrice(std::stof(fields[3]));
+        if (fields.size() == 5)
+        {
+            // Older files were saved without the GlobalDiscount column
+            product.setQuantity(std::stoi(fields[4]));
+        }
+        else
+        {
+            // fields[4] is the GlobalDiscount column, discounts are loaded from discounts.csv
+            product.setQuantity(std::stoi(fields[5]));
+        }
+        if (fields.size() > 6)
+        {
+            product.setBulkPricing(BulkPricing::fromString(fields[6]));
+        }
 
         productList.push_back(product); // Add product to product list, rinse & repeat
     }
     input.close();
+    rebuildIndex();
+
+    salesRatesLoaded = false;
+    time_t now = time(NULL);
+    for (unsigned i = 0; i < productList.size(); i++)
+    {
+        stockAlerts.setStock(productList[i].getID(), productList[i].getQuantity(), now);
+    }
 }
 /**
  * Class destructor.
@@ -74,14 +119,7 @@ ProductCollection::~ProductCollection()
 // No need to take in quantity (like in UML diagram) because quantity is specified when creating Product object
 void ProductCollection::addProduct(Product newProduct)
 {
-    bool inCollection = false; //! Checks if this product is already in the collection */
-    for (unsigned i = 0; i < productList.size(); i++)
-    {
-        if (productList[i].getID() == newProduct.getID())
-        {
-            inCollection = true;
-        }
-    }
+    bool inCollection = findProduct(newProduct.getID()) != -1; //! Checks if this product is already in the collection */
 
     if (inCollection)
     {
@@ -91,11 +129,13 @@ void ProductCollection::addProduct(Product newProduct)
     else
     {
         productList.push_back(newProduct);
+        idIndex[newProduct.getID()] = productList.size() - 1;
+        stockAlerts.setStock(newProduct.getID(), newProduct.getQuantity(), time(NULL));
 
         // Writes product to file in CSV format
         ofstream output;
         output.open("products.csv", std::ios_base::app);
-        output << newProduct.getID() << "," << newProduct.getName() << "," << newProduct.getCategory() << "," << newProduct.getPrice() << "," << newProduct.getQuantity() << '\n'; // Outputs to .CSV
+        writeRecord(output, newProduct, newProduct.getQuantity()); // Outputs to .CSV
         output.close();
 
         cout << "Product was added successfully" << endl;
@@ -115,6 +155,7 @@ void ProductCollection::changeInventory(Product product, int quantity)
         if (productList[i].getID() == product.getID())
         {
             productList[i].setQuantity(quantity);
+            stockAlerts.setStock(product.getID(), quantity, time(NULL));
             saveToDatabase();
             return;
         }
@@ -136,6 +177,9 @@ void ProductCollection::removeProduct(string id)
         {
             found = true;
             productList.erase(productList.begin() + i);
+            stockAlerts.remove(id);
+            rebuildIndex();
+            priceKeys.clear(); // Keys no longer line up with the list
             cout << "Product was removed from the product collection successfully" << endl;
             saveToDatabase();
         }
@@ -147,20 +191,28 @@ void ProductCollection::removeProduct(string id)
 }
 
 /**
-* Finds the index of the product contained in the product vector.
+* Finds the index of the product contained in the product vector. Looks the ID up in the hash index, so it does not scan the list.
 * @param id Product's unique ID.
 * @return Int of the product's index in the product vector. Returns -1 if not found.
 */
 int ProductCollection::findProduct(string id)
 {
+    unordered_map<string, int>::const_iterator it = idIndex.find(id);
+    return it == idIndex.end() ? -1 : it->second;
+}
+/**
+* Rebuilds the ID to index map after the product list is loaded, reordered or shrunk.
+* If an ID appears more than once, the first product with it is indexed.
+* @return None.
+*/
+void ProductCollection::rebuildIndex()
+{
+    idIndex.clear();
+    idIndex.reserve(productList.size());
     for (unsigned i = 0; i < productList.size(); i++)
     {
-        if (productList[i].getID() == id)
-        {
-            return i;
-        }
+        idIndex.insert(make_pair(productList[i].getID(), (int)i));
     }
-    return -1;
 }
 /**
 * Changes a product's on-hand quantity
@@ -178,6 +230,7 @@ void ProductCollection::restockInventory(Product product, int quantity)
             found = true;
             cout << "Previous Quantity for " << productList.at(i).getName() << " was " << productList.at(i).getQuantity() << endl;
             productList.at(i).addQuantity(quantity);
+            stockAlerts.setStock(productList.at(i).getID(), productList.at(i).getQuantity(), time(NULL));
             saveToDatabase();
             cout << "New Quantity for " << productList.at(i).getName() << " is " << productList.at(i).getQuantity() << endl;
             break;
@@ -189,24 +242,88 @@ void ProductCollection::restockInventory(Product product, int quantity)
     }
 }
 /**
-* Sorts the product list according to price.
+* Brings the sort key of every product up to date. A product's key is its effective (discounted) price in whole cents,
+* and it is only recomputed when the product's version stamp shows its price or discounts may have changed.
+* @return None.
+*/
+void ProductCollection::refreshPriceKeys()
+{
+    if (priceKeys.size() != productList.size())
+    {
+        // The list changed shape since the keys were built, so every key is recomputed
+        priceKeys.assign(productList.size(), 0);
+        priceKeyVersions.assign(productList.size(), 0);
+        for (unsigned i = 0; i < productList.size(); i++)
+        {
+            priceKeyVersions[i] = productList[i].getVersion() + 1;
+        }
+    }
+
+    for (unsigned i = 0; i < productList.size(); i++)
+    {
+        if (priceKeyVersions[i] != productList[i].getVersion())
+        {
+            float cents = productList[i].getEffectivePrice() * 100 + 0.5f;
+            priceKeys[i] = cents <= 0 ? 0 : cents >= 4294967295.0f ? UINT32_MAX : (uint32_t)cents;
+            priceKeyVersions[i] = productList[i].getVersion();
+        }
+    }
+}
+/**
+* Rearranges the product list, and the sort keys with it, into a new order.
+* @param order Index into the current list of the product that goes at each position.
+* @return None.
+*/
+void ProductCollection::reorder(const vector<int> &order)
+{
+    vector<Product> products;
+    vector<uint32_t> keys;
+    vector<unsigned int> versions;
+    products.reserve(order.size());
+    keys.reserve(order.size());
+    versions.reserve(order.size());
+
+    for (unsigned i = 0; i < order.size(); i++)
+    {
+        products.push_back(productList[order[i]]);
+        keys.push_back(priceKeys[order[i]]);
+        versions.push_back(priceKeyVersions[order[i]]);
+    }
+
+    productList.swap(products);
+    priceKeys.swap(keys);
+    priceKeyVersions.swap(versions);
+    rebuildIndex();
+}
+/**
+* Sorts the product list according to effective price, so products on sale sort by what they actually cost.
+* The sort runs over packed integer keys (price in cents, then position) rather than comparing Product objects.
+* Products with the same price keep their relative order.
 * @param order Either in increasing or decreasing price.
 * @return None.
 */
 void ProductCollection::sortByPrice(string order)
 {
-    if (order == "increasing")
+    if (order != "increasing" && order != "decreasing")
     {
-        sort(productList.begin(), productList.end(), [](Product &lhs, Product &rhs) {
-            return lhs.getPrice() < rhs.getPrice();
-        });
+        return;
     }
-    else if (order == "decreasing")
+    refreshPriceKeys();
+
+    vector<uint64_t> keys(productList.size());
+    for (unsigned i = 0; i < productList.size(); i++)
     {
-        sort(productList.begin(), productList.end(), [](Product &lhs, Product &rhs) {
-            return lhs.getPrice() > rhs.getPrice();
-        });
+        uint32_t key = order == "increasing" ? priceKeys[i] : UINT32_MAX - priceKeys[i];
+        keys[i] = (uint64_t)key << 32 | i;
     }
+    sort(keys.begin(), keys.end());
+
+    vector<int> sorted(keys.size());
+    for (unsigned i = 0; i < keys.size(); i++)
+    {
+        sorted[i] = (int)(keys[i] & UINT32_MAX);
+    }
+    reorder(sorted);
 }
 /**
 * Sorts the product list according to category, alphabetically.
@@ -227,6 +344,8 @@ void ProductCollection::sortByCategory(string order)
             return lhs.getCategory() > rhs.getCategory();
         });
     }
+    rebuildIndex();
+    priceKeys.clear(); // Keys no longer line up with the list
 }
 /**
 * Changes the price of a product.
@@ -254,6 +373,35 @@ void ProductCollection::changePrice(Product product, float newPrice)
         cout << "Product was not found in the collection" << endl;
     }
 }
+/**
+* Adds, replaces or removes a bulk pricing tier of a product.
+* @param product Product to receive the tier change.
+* @param minQuantity Smallest quantity the tier applies to.
+* @param modifier Fraction taken off the unit price. A modifier of 0 removes the tier.
+* @return None.
+*/
+void ProductCollection::setBulkTier(Product product, int minQuantity, float modifier)
+{
+    int index = findProduct(product.getID());
+    if (index == -1)
+    {
+        cout << "Product was not found in the collection" << endl;
+        return;
+    }
+
+    BulkPricing tiers = productList[index].getBulkPricing();
+    if (modifier > 0)
+    {
+        tiers.setTier(minQuantity, modifier);
+    }
+    else
+    {
+        tiers.removeTier(minQuantity);
+    }
+    productList[index].setBulkPricing(tiers);
+    saveToDatabase();
+    cout << "Bulk tiers for " << productList[index].getName() << ": " << (tiers.empty() ? "none" : tiers.toString()) << endl;
+}
 
 /**
 * Returns the amount of products in the collection.
@@ -290,7 +438,52 @@ std::vector<Product> ProductCollection::getProductList()
     return productList;
 }
 /**
-* Saves any changes made to product collection to database file.
+* Applies a stock change that is recorded in the checkout journal rather than the product database file.
+* The change is left out of the database file until checkpointStock is called, so replaying the journal
+* after a restart never applies it twice. A fall in stock counts as a sale towards the product's sales rate.
+* @param id Product's unique ID.
+* @param delta Change in on-hand quantity.
+* @return None.
+*/
+void ProductCollection::applyJournaledStock(string id, int delta)
+{
+    int index = findProduct(id);
+    if (index == -1)
+    {
+        return;
+    }
+    productList[index].setQuantity(productList[index].getQuantity() + delta);
+    journaledStock[id] += delta;
+
+    time_t now = time(NULL);
+    if (delta < 0)
+    {
+        stockAlerts.recordSale(id, -delta, now);
+    }
+    stockAlerts.setStock(id, productList[index].getQuantity(), now);
+}
+/**
+* Folds every journaled stock change into the product database file, which then records the last checkout it holds
+* so a journal replay does not apply those changes again. Called just before the checkout journal is emptied.
+* @param checkout Sequence number of the last journaled checkout.
+* @return None.
+*/
+void ProductCollection::checkpointStock(uint64_t checkout)
+{
+    journaledStock.clear();
+    lastCheckout = checkout;
+    saveToDatabase();
+}
+/**
+* Gets the last journaled checkout whose stock changes are in the product database file.
+* @return Sequence number of the checkout, 0 if none.
+*/
+uint64_t ProductCollection::getLastCheckout() const
+{
+    return lastCheckout;
+}
+/**
+* Saves any changes made to product collection to database file. Stock changes still held in the checkout journal are left out.
 * @return None.
 */
 void ProductCollection::saveToDatabase()
@@ -303,37 +496,90 @@ void ProductCollection::saveToDatabase()
     // write the productsList vector into the empty csv file
     ofstream file;
     file.open("products.csv");
-    file << "ID,Name,Category,Price,GlobalDiscount,Quantity,\n"; // create the column titles
+    file << "ID,Name,Category,Price,GlobalDiscount,Quantity,BulkTiers," << CHECKOUT_HEADING << lastCheckout << "\n"; // create the column titles
 
     // create a product entry for each product in the list
     for (unsigned i = 0; i < productList.size(); i++)
     {
-        file << productList.at(i).getID() << "," << productList.at(i).getName() << "," << productList.at(i).getCategory() << "," << productList.at(i).getPrice() << "," << productList.at(i).getQuantity() << "\n";
+        int quantity = productList.at(i).getQuantity();
+        unordered_map<string, int>::iterator journaled = journaledStock.find(productList.at(i).getID());
+        if (journaled != journaledStock.end())
+        {
+            quantity -= journaled->second;
+        }
+        writeRecord(file, productList.at(i), quantity);
     }
 
     file.close();
 }
 /**
-* Displays admin alerts for product collection based on inventory.
+* Works out every product's sales rate from its daily sales, replacing the rates counted so far. Only done once,
+* since later sales reach the rates through applyJournaledStock.
+* @param sales Daily sales counters of the purchase history.
 * @return None.
 */
-void ProductCollection::alertInterface()
+void ProductCollection::loadSalesRates(const SalesCounters &sales)
+{
+    time_t now = time(NULL);
+    int64_t today = StockAlerts::dayOf(now);
+    int64_t firstDay = StockAlerts::dayOf(SalesCounters::earliest(now));
+    vector<int64_t> dailyUnits;
+    for (unsigned i = 0; i < productList.size(); i++)
+    {
+        dailyUnits.clear();
+        for (int64_t day = firstDay; day <= today; day++)
+        {
+            time_t start = StockAlerts::dayStart(day);
+            dailyUnits.push_back(sales.productDays(productList[i].getID(), start, start).units);
+        }
+        stockAlerts.seed(productList[i].getID(), firstDay, dailyUnits, now);
+    }
+    salesRatesLoaded = true;
+}
+/**
+* Lists the products that are out of stock or about to run out, most urgent first. The first call works out the sales
+* rates from the purchase history.
+* @param sales Daily sales counters of the purchase history.
+* @return Alerts ordered by days of cover.
+*/
+std::vector<StockAlert> ProductCollection::getStockAlerts(const SalesCounters &sales)
+{
+    if (!salesRatesLoaded)
+    {
+        loadSalesRates(sales);
+    }
+    return stockAlerts.alerts(time(NULL));
+}
+/**
+* Displays admin alerts for products that are out of stock or will run out within a week at their recent sales rate.
+* @param sales Daily sales counters of the purchase history.
+* @return None.
+*/
+void ProductCollection::alertInterface(const SalesCounters &sales)
 {
 
 	cout << "------------------Current Inventory Alerts------------------" << endl << endl;
 
-	for (unsigned i = 0; i < productList.size(); i++)
+	vector<StockAlert> alerts = getStockAlerts(sales);
+	for (unsigned i = 0; i < alerts.size(); i++)
 	{
-		if (productList[i].getQuantity() < 5) 
+		const Product &product = productList[findProduct(alerts[i].id)];
+		if (alerts[i].quantity <= 0)
 		{
-			cout << "Product: " << left << setw(20) << productList[i].getName() << " LOW STOCK - Current Stock: " << productList[i].getQuantity() << endl;
+			cout << "Product: " << left << setw(20) << product.getName() << " OUT OF STOCK - Current Stock: " << alerts[i].quantity << endl;
 		}
-		else if (productList[i].getQuantity() == 0) {
-			cout << "Product: " << productList[i].getName() << " OUT OF STOCK - Current Stock: " << productList[i].getQuantity() << endl;
+		else if (alerts[i].rate > 0)
+		{
+			ostringstream cover;
+			cover << fixed << setprecision(1) << alerts[i].cover << " days at " << alerts[i].rate << " per day";
+			cout << "Product: " << left << setw(20) << product.getName() << " LOW STOCK - Current Stock: " << alerts[i].quantity << " - " << cover.str() << endl;
+		}
+		else
+		{
+			cout << "Product: " << left << setw(20) << product.getName() << " LOW STOCK - Current Stock: " << alerts[i].quantity << endl;
 		}
-		
 	}
 	
 	cout <<endl<< "Press Enter to Continue";
 	cin.ignore(std::numeric_limits<streamsize>::max(), '\n');
-}
\ No newline at end of file
+}
@@ -3,7 +3,11 @@
 #define PRODUCTCOLLECTION_H
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
 #include "Product.h"
+#include "StockAlerts.h"
+#include "../PurchaseHistory/SalesCounters.h"
 #include <fstream>
 
 class Product;
@@ -11,6 +15,19 @@ class Product;
 class ProductCollection {
     private:
         std::vector<Product> productList; 
+        std::unordered_map<std::string, int> idIndex;
+        std::unordered_map<std::string, int> journaledStock;
+        // Last journaled checkout whose stock changes are in the database file
+        uint64_t lastCheckout;
+        std::vector<uint32_t> priceKeys;
+        std::vector<unsigned int> priceKeyVersions;
+        StockAlerts stockAlerts;
+        bool salesRatesLoaded;
+
+        void rebuildIndex();
+        void refreshPriceKeys();
+        void reorder(const std::vector<int> &order);
+        void loadSalesRates(const SalesCounters &sales);
         
     public:
         ProductCollection();
@@ -27,8 +44,13 @@ class ProductCollection {
         Product at(int index);
         Product *getProduct(int index);
         void changePrice(Product product, float newPrice);
+        void setBulkTier(Product product, int minQuantity, float modifier);
         std::vector<Product> getProductList();
+        void applyJournaledStock(std::string id, int delta);
+        void checkpointStock(uint64_t checkout);
+        uint64_t getLastCheckout() const;
         void saveToDatabase();
-		void alertInterface();
+        std::vector<StockAlert> getStockAlerts(const SalesCounters &sales);
+        void alertInterface(const SalesCounters &sales);
 };
 #endif
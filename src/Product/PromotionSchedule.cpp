@@ -0,0 +1,374 @@
+/** \file PromotionSchedule.h
+ * \brief Scheduled discount windows for products, categories or the whole catalog.
+ * \details Each promotion takes an amount off between a start and an end time. Windows are kept in one interval
+ * index per product, one per category and one for the whole catalog, so the discount for a product at any time,
+ * past, present or future, is found with three lookups of O(log n) each. Overlapping promotions do not stack;
+ * the largest one applies. The start and end times of every window are also kept in order, so callers can tell
+ * when the next promotion starts or ends without checking every product.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "PromotionSchedule.h"
+
+using namespace std;
+
+/**
+* Recomputes the latest end time of the subtree rooted at the middle of [lo, hi).
+* @param lo First index of the range.
+* @param hi One past the last index of the range.
+* @return Latest end time in the range, or 0 if the range is empty.
+*/
+time_t IntervalIndex::build(int lo, int hi)
+{
+    if (lo >= hi)
+    {
+        return 0;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    maxEnd[mid] = max(windows[mid].end, max(build(lo, mid), build(mid + 1, hi)));
+    return maxEnd[mid];
+}
+
+/**
+* Collects the windows in [lo, hi) that contain a time, skipping subtrees that all end at or before it.
+* @param lo First index of the range.
+* @param hi One past the last index of the range.
+* @param t Time to look up.
+* @param found Vector the promotion IDs of matching windows are added to.
+* @return None.
+*/
+void IntervalIndex::stab(int lo, int hi, time_t t, vector<int> &found) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    if (maxEnd[mid] <= t)
+    {
+        return;
+    }
+
+    stab(lo, mid, t, found);
+
+    // Windows to the right start no earlier than this one
+    if (windows[mid].start <= t)
+    {
+        if (t < windows[mid].end)
+        {
+            found.push_back(windows[mid].promotion);
+        }
+        stab(mid + 1, hi, t, found);
+    }
+}
+
+/**
+* Adds a window to the index.
+* @param start Time the window opens.
+* @param end Time the window closes.
+* @param promotion ID of the promotion the window belongs to.
+* @return None.
+*/
+void IntervalIndex::insert(time_t start, time_t end, int promotion)
+{
+    Window window = {start, end, promotion};
+    vector<Window>::iterator pos = windows.begin();
+    while (pos != windows.end() && pos->start <= start)
+    {
+        ++pos;
+    }
+    windows.insert(pos, window);
+
+    maxEnd.resize(windows.size());
+    build(0, windows.size());
+}
+
+/**
+* Removes the window of a promotion from the index.
+* @param promotion ID of the promotion.
+* @return None.
+*/
+void IntervalIndex::erase(int promotion)
+{
+    for (vector<Window>::iterator i = windows.begin(); i != windows.end(); ++i)
+    {
+        if (i->promotion == promotion)
+        {
+            windows.erase(i);
+            break;
+        }
+    }
+
+    maxEnd.resize(windows.size());
+    build(0, windows.size());
+}
+
+/**
+* Finds the windows that contain a time.
+* @param t Time to look up.
+* @param found Vector the promotion IDs of matching windows are added to.
+* @return None.
+*/
+void IntervalIndex::activeAt(time_t t, vector<int> &found) const
+{
+    stab(0, windows.size(), t, found);
+}
+
+/**
+* Checks if the index holds no windows.
+* @return True if there are no windows.
+*/
+bool IntervalIndex::empty() const
+{
+    return windows.empty();
+}
+
+/**
+* Default constructor, creates an empty schedule.
+* @return None.
+*/
+PromotionSchedule::PromotionSchedule()
+{
+    nextID = 1;
+}
+
+/**
+ * Class destructor.
+ * @return None.
+ */
+PromotionSchedule::~PromotionSchedule()
+{
+}
+
+/**
+* Gets the interval index that holds promotions of a scope and target.
+* @param scope Scope of the promotion.
+* @param target Product ID or category name, ignored for the global scope.
+* @return Reference to the index.
+*/
+IntervalIndex &PromotionSchedule::indexFor(PromotionScope scope, const string &target)
+{
+    if (scope == productScope)
+    {
+        return byProduct[target];
+    }
+    if (scope == categoryScope)
+    {
+        return byCategory[target];
+    }
+    return global;
+}
+
+/**
+* Picks the largest amount among a set of promotions.
+* @param found IDs of the promotions.
+* @return Largest amount, or 0 if there are none.
+*/
+float PromotionSchedule::bestOf(const vector<int> &found) const
+{
+    float best = 0;
+    for (unsigned i = 0; i < found.size(); i++)
+    {
+        best = max(best, promotions.at(found[i]).amount);
+    }
+    return best;
+}
+
+/**
+* Schedules a promotion.
+* @param scope Whether the promotion applies to one product, one category or every product.
+* @param target Product ID or category name, ignored for the global scope.
+* @param amount Fraction taken off the price, e.g. 0.25 for 25% off.
+* @param start Time the promotion starts.
+* @param end Time the promotion ends.
+* @return ID of the new promotion, or -1 if the amount or times are invalid.
+*/
+int PromotionSchedule::addPromotion(PromotionScope scope, string target, float amount, time_t start, time_t end)
+{
+    if (amount <= 0 || amount >= 1 || end <= start)
+    {
+        return -1;
+    }
+    if (scope == globalScope)
+    {
+        target = "";
+    }
+
+    Promotion promotion = {nextID++, scope, target, amount, start, end};
+    promotions[promotion.id] = promotion;
+    indexFor(scope, target).insert(start, end, promotion.id);
+    boundaries.insert(start);
+    boundaries.insert(end);
+    return promotion.id;
+}
+
+/**
+* Cancels a promotion.
+* @param id ID of the promotion.
+* @return 0 on success, -1 if there is no promotion with that ID.
+*/
+int PromotionSchedule::removePromotion(int id)
+{
+    map<int, Promotion>::iterator it = promotions.find(id);
+    if (it == promotions.end())
+    {
+        return -1;
+    }
+
+    indexFor(it->second.scope, it->second.target).erase(id);
+    boundaries.erase(boundaries.find(it->second.start));
+    boundaries.erase(boundaries.find(it->second.end));
+    promotions.erase(it);
+    return 0;
+}
+
+/**
+* Gets the promotional discount on a product at a point in time.
+* @param product Product to price.
+* @param t Time to price the product at.
+* @return Largest promotion amount active for the product at that time, or 0 if there is none.
+*/
+float PromotionSchedule::discountAt(const Product &product, time_t t) const
+{
+    vector<int> found;
+
+    unordered_map<string, IntervalIndex>::const_iterator it = byProduct.find(product.getID());
+    if (it != byProduct.end())
+    {
+        it->second.activeAt(t, found);
+    }
+    it = byCategory.find(product.getCategory());
+    if (it != byCategory.end())
+    {
+        it->second.activeAt(t, found);
+    }
+    global.activeAt(t, found);
+
+    return bestOf(found);
+}
+
+/**
+* Lists the promotions active at a point in time.
+* @param t Time to look up.
+* @return Promotions whose window contains the time, ordered by ID.
+*/
+vector<Promotion> PromotionSchedule::activeAt(time_t t) const
+{
+    vector<int> found;
+    global.activeAt(t, found);
+    for (unordered_map<string, IntervalIndex>::const_iterator it = byCategory.begin(); it != byCategory.end(); ++it)
+    {
+        it->second.activeAt(t, found);
+    }
+    for (unordered_map<string, IntervalIndex>::const_iterator it = byProduct.begin(); it != byProduct.end(); ++it)
+    {
+        it->second.activeAt(t, found);
+    }
+    sort(found.begin(), found.end());
+
+    vector<Promotion> active;
+    for (unsigned i = 0; i < found.size(); i++)
+    {
+        active.push_back(promotions.at(found[i]));
+    }
+    return active;
+}
+
+/**
+* Gets every scheduled promotion.
+* @return Map of promotion ID to promotion.
+*/
+const map<int, Promotion> &PromotionSchedule::getPromotions() const
+{
+    return promotions;
+}
+
+/**
+* Gets the next time a promotion starts or ends.
+* @param t Time to search from.
+* @return First start or end time after t, or 0 if there is none.
+*/
+time_t PromotionSchedule::nextChange(time_t t) const
+{
+    multiset<time_t>::const_iterator it = boundaries.upper_bound(t);
+    return it == boundaries.end() ? 0 : *it;
+}
+
+/**
+* Reads the promotion database file. Promotions that have already ended are dropped.
+* @return None.
+*/
+void PromotionSchedule::loadFromDatabase()
+{
+    ifstream input;
+    input.open("promotions.csv");
+
+    string line;
+    getline(input, line); // Skip first line of CSV file (headings)
+
+    time_t now = time(NULL);
+    while (getline(input, line))
+    {
+        istringstream iss(line);
+        string scope, target, amount, start, end;
+        getline(iss, scope, ',');
+        getline(iss, target, ',');
+        getline(iss, amount, ',');
+        getline(iss, start, ',');
+        getline(iss, end, ',');
+
+        try
+        {
+            if (stoll(end) <= now)
+            {
+                continue;
+            }
+            addPromotion((PromotionScope)stoi(scope), target, stof(amount), stoll(start), stoll(end));
+        }
+        catch (const std::exception &)
+        {
+            cerr << "Skipping malformed promotion: " << line << endl;
+        }
+    }
+    input.close();
+}
+
+/**
+* Saves the promotions to the promotion database file.
+* @return None.
+*/
+void PromotionSchedule::saveToDatabase()
+{
+    ofstream file;
+    file.open("promotions.csv", ofstream::out | ofstream::trunc);
+    file << "Scope,Target,Amount,Start,End\n"; // create the column titles
+
+    for (map<int, Promotion>::iterator it = promotions.begin(); it != promotions.end(); ++it)
+    {
+        file << it->second.scope << "," << it->second.target << "," << it->second.amount << "," << (long long)it->second.start << "," << (long long)it->second.end << '\n';
+    }
+    file.close();
+}
+
+/**
+* Gets a display name for a promotion scope.
+* @param scope Scope of a promotion.
+* @return Name of the scope.
+*/
+string PromotionSchedule::scopeName(PromotionScope scope)
+{
+    if (scope == productScope)
+    {
+        return "Product";
+    }
+    if (scope == categoryScope)
+    {
+        return "Category";
+    }
+    return "All products";
+}
@@ -0,0 +1,83 @@
+/** \file PromotionSchedule.h
+ */
+#ifndef PROMOTION_SCHEDULE_H
+#define PROMOTION_SCHEDULE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <ctime>
+#include "Product.h"
+
+enum PromotionScope
+{
+    productScope,
+    categoryScope,
+    globalScope
+};
+
+/** A discount that is active from start (inclusive) until end (exclusive). */
+struct Promotion
+{
+    int id;
+    PromotionScope scope;
+    std::string target;
+    float amount;
+    time_t start;
+    time_t end;
+};
+
+/** Time windows sorted by start, searched as an implicit balanced tree augmented with the latest end in each subtree. */
+class IntervalIndex
+{
+private:
+    struct Window
+    {
+        time_t start;
+        time_t end;
+        int promotion;
+    };
+
+    std::vector<Window> windows;
+    std::vector<time_t> maxEnd;
+
+    time_t build(int lo, int hi);
+    void stab(int lo, int hi, time_t t, std::vector<int> &found) const;
+
+public:
+    void insert(time_t start, time_t end, int promotion);
+    void erase(int promotion);
+    void activeAt(time_t t, std::vector<int> &found) const;
+    bool empty() const;
+};
+
+class PromotionSchedule
+{
+private:
+    std::map<int, Promotion> promotions;
+    std::unordered_map<std::string, IntervalIndex> byProduct;
+    std::unordered_map<std::string, IntervalIndex> byCategory;
+    IntervalIndex global;
+    std::multiset<time_t> boundaries;
+    int nextID;
+
+    IntervalIndex &indexFor(PromotionScope scope, const std::string &target);
+    float bestOf(const std::vector<int> &found) const;
+
+public:
+    PromotionSchedule();
+    ~PromotionSchedule();
+    int addPromotion(PromotionScope scope, std::string target, float amount, time_t start, time_t end);
+    int removePromotion(int id);
+    float discountAt(const Product &product, time_t t) const;
+    std::vector<Promotion> activeAt(time_t t) const;
+    const std::map<int, Promotion> &getPromotions() const;
+    time_t nextChange(time_t t) const;
+    void loadFromDatabase();
+    void saveToDatabase();
+    static std::string scopeName(PromotionScope scope);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/** \file StockAlerts.h
+ * \brief Low stock alerts ranked by how long the stock on hand will last.
+ * \details Each product's sales rate is an exponentially smoothed count of units sold per day, so recent days weigh
+ * the most and a day with no sales pulls the rate down. Units sold today count towards the rate in proportion to the
+ * smoothing factor, so a sudden run on a product shows up straight away. Days of cover is the stock on hand divided
+ * by that rate. A product needs an alert when it is out of stock, has less than a week of cover, or has no sales rate
+ * yet and fewer than five units left. Those products are kept in an ordered set by days of cover, and each stock
+ * change moves its product in or out of the set, so listing the alerts never looks at the rest of the catalog.
+ * Days are counted from midnight UTC.
+ */
+
+#include <cmath>
+#include <limits>
+#include "StockAlerts.h"
+
+using namespace std;
+
+constexpr double SMOOTHING = 0.3;   // Weight of the latest day in the sales rate
+constexpr double COVER_DAYS = 7;    // Products with less cover than this need restocking
+constexpr int LOW_STOCK = 5;        // Alert level for products with no sales rate
+constexpr time_t DAY_SECONDS = 86400;
+
+/**
+* Gets the day a date falls in.
+* @param date Date to look up.
+* @return Number of days since the epoch, rounded down.
+*/
+int64_t StockAlerts::dayOf(time_t date)
+{
+    int64_t day = date / DAY_SECONDS;
+    if (date < 0 && date % DAY_SECONDS != 0)
+    {
+        day--;
+    }
+    return day;
+}
+
+/**
+* Gets the first second of a day.
+* @param day Day number, as returned by dayOf().
+* @return Date the day starts at.
+*/
+time_t StockAlerts::dayStart(int64_t day)
+{
+    return day * DAY_SECONDS;
+}
+
+/**
+* Gets a product's smoothed sales rate over every day before a given day.
+* @param level Stock level of the product.
+* @param day Day to get the rate at, no earlier than the level's day.
+* @return Units per day.
+*/
+double StockAlerts::rateBefore(const StockLevel &level, int64_t day)
+{
+    if (day <= level.day)
+    {
+        return level.rate;
+    }
+
+    // The pending day is complete, and every day after it up to the given day sold nothing
+    double rate = SMOOTHING * level.pending + (1 - SMOOTHING) * level.rate;
+    return rate * pow(1 - SMOOTHING, (double)(day - level.day - 1));
+}
+
+/**
+* Gets a product's sales rate on a day, counting what it has sold so far that day.
+* @param level Stock level of the product.
+* @param day Current day.
+* @return Units per day.
+*/
+double StockAlerts::velocity(const StockLevel &level, int64_t day)
+{
+    int soldToday = day == level.day ? level.pending : 0;
+    return SMOOTHING * soldToday + (1 - SMOOTHING) * rateBefore(level, day);
+}
+
+/**
+* Works out a product's days of cover and moves it into, within or out of the alert queue.
+* @param id Product's unique ID.
+* @param level Stock level of the product.
+* @param now Current date.
+* @return None.
+*/
+void StockAlerts::rank(const string &id, StockLevel &level, time_t now)
+{
+    if (level.queued)
+    {
+        queue.erase(make_pair(level.cover, id));
+    }
+
+    double rate = velocity(level, dayOf(now));
+    if (level.quantity <= 0)
+    {
+        level.cover = 0;
+    }
+    else if (rate > 0)
+    {
+        level.cover = level.quantity / rate;
+    }
+    else
+    {
+        level.cover = numeric_limits<double>::infinity();
+    }
+
+    level.queued = level.cover < COVER_DAYS || level.quantity < LOW_STOCK;
+    if (level.queued)
+    {
+        queue.insert(make_pair(level.cover, id));
+    }
+}
+
+/**
+* Records a product's stock on hand. Called on every stock change, and for every product when the catalog is loaded.
+* @param id Product's unique ID.
+* @param quantity Units on hand.
+* @param now Current date.
+* @return None.
+*/
+void StockAlerts::setStock(const string &id, int quantity, time_t now)
+{
+    StockLevel &level = levels[id];
+    level.quantity = quantity;
+    rank(id, level, now);
+}
+
+/**
+* Counts units sold towards a product's sales rate. Sales from before the last day counted are ignored. The stock
+* change that goes with the sale is recorded separately with setStock().
+* @param id Product's unique ID.
+* @param units Units sold.
+* @param date Date of the sale.
+* @return None.
+*/
+void StockAlerts::recordSale(const string &id, int units, time_t date)
+{
+    StockLevel &level = levels[id];
+    int64_t day = dayOf(date);
+    if (day < level.day)
+    {
+        return;
+    }
+    if (day > level.day)
+    {
+        level.rate = rateBefore(level, day);
+        level.day = day;
+        level.pending = 0;
+    }
+    level.pending += units;
+}
+
+/**
+* Replaces a product's sales rate with one worked out from its daily sales.
+* @param id Product's unique ID.
+* @param firstDay Day the first count is for.
+* @param dailyUnits Units sold on each day from the first, ending with the current day.
+* @param now Current date.
+* @return None.
+*/
+void StockAlerts::seed(const string &id, int64_t firstDay, const vector<int64_t> &dailyUnits, time_t now)
+{
+    StockLevel &level = levels[id];
+    level.rate = 0;
+    level.day = firstDay;
+    level.pending = 0;
+    for (unsigned i = 0; i < dailyUnits.size(); i++)
+    {
+        recordSale(id, dailyUnits[i], dayStart(firstDay + i));
+    }
+    rank(id, level, now);
+}
+
+/**
+* Stops tracking a product, e.g. once it is removed from the catalog.
+* @param id Product's unique ID.
+* @return None.
+*/
+void StockAlerts::remove(const string &id)
+{
+    unordered_map<string, StockLevel>::iterator found = levels.find(id);
+    if (found == levels.end())
+    {
+        return;
+    }
+    if (found->second.queued)
+    {
+        queue.erase(make_pair(found->second.cover, id));
+    }
+    levels.erase(found);
+}
+
+/**
+* Lists the products that need an alert, most urgent first. The days of cover of each queued product are brought up
+* to date first, since a rate falls on days without sales.
+* @param now Current date.
+* @return Out of stock products first, then the rest by days of cover.
+*/
+vector<StockAlert> StockAlerts::alerts(time_t now)
+{
+    vector<string> queued;
+    queued.reserve(queue.size());
+    for (set<pair<double, string>>::const_iterator i = queue.begin(); i != queue.end(); i++)
+    {
+        queued.push_back(i->second);
+    }
+    for (unsigned i = 0; i < queued.size(); i++)
+    {
+        rank(queued[i], levels[queued[i]], now);
+    }
+
+    vector<StockAlert> found;
+    found.reserve(queue.size());
+    int64_t today = dayOf(now);
+    for (set<pair<double, string>>::const_iterator i = queue.begin(); i != queue.end(); i++)
+    {
+        const StockLevel &level = levels[i->second];
+        StockAlert alert = {i->second, level.quantity, velocity(level, today), level.cover};
+        found.push_back(alert);
+    }
+    return found;
+}
+
+/**
+* Returns the number of products that need an alert.
+* @return Size of the alert queue.
+*/
+size_t StockAlerts::size() const
+{
+    return queue.size();
+}
@@ -0,0 +1,59 @@
+/** \file StockAlerts.h
+ */
+#ifndef STOCK_ALERTS_H
+#define STOCK_ALERTS_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+/** A product that is out of stock or about to run out. */
+struct StockAlert
+{
+    std::string id;
+    int quantity;
+    double rate;
+    double cover;
+};
+
+class StockAlerts
+{
+private:
+    /** Stock on hand and smoothed sales rate of one product. */
+    struct StockLevel
+    {
+        int quantity;
+        double rate;     // Units per day, smoothed over the days before day
+        int64_t day;     // Day the pending units were sold on
+        int pending;
+        double cover;    // Days of cover the product is queued under
+        bool queued;
+
+        StockLevel() : quantity(0), rate(0), day(0), pending(0), cover(0), queued(false) {}
+    };
+
+    std::unordered_map<std::string, StockLevel> levels;
+    // Products that need an alert, most urgent first
+    std::set<std::pair<double, std::string>> queue;
+
+    static double rateBefore(const StockLevel &level, int64_t day);
+    static double velocity(const StockLevel &level, int64_t day);
+    void rank(const std::string &id, StockLevel &level, time_t now);
+
+public:
+    static int64_t dayOf(time_t date);
+    static time_t dayStart(int64_t day);
+
+    void setStock(const std::string &id, int quantity, time_t now);
+    void recordSale(const std::string &id, int units, time_t date);
+    void seed(const std::string &id, int64_t firstDay, const std::vector<int64_t> &dailyUnits, time_t now);
+    void remove(const std::string &id);
+    std::vector<StockAlert> alerts(time_t now);
+    size_t size() const;
+};
+
+#endif
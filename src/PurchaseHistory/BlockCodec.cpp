@@ -0,0 +1,344 @@
+/** \file BlockCodec.h
+ * \brief Block compression for purchase history segments.
+ * \details A stream is cut into blocks of up to 64 KiB, and each block is compressed on its own. That lets a reader
+ * decode one block at a time straight from a mapped file, with only one decompressed block held at once and
+ * uncompressed blocks read in place. Each block starts with its raw size and stored size as 32-bit values. A stored
+ * size equal to the raw size means the block is kept uncompressed, and a raw size of zero ends the stream.
+ *
+ * Compressed blocks are LZ77 sequences. Each sequence has a token byte: the high nibble is the literal count and the
+ * low nibble is the match length minus four, with 15 meaning more length bytes follow. Next come the literals, then a
+ * two-byte offset back into the output and any extra match length bytes. The last sequence has literals only.
+ * Matches are found greedily with a 4096-entry hash table of 4-byte prefixes.
+ */
+
+#include "BlockCodec.h"
+#include <cstring>
+#include <vector>
+
+constexpr size_t BLOCK_SIZE = 64 * 1024;
+constexpr size_t MAX_BLOCK = 1024 * 1024;
+constexpr size_t MIN_MATCH = 4;
+constexpr int HASH_BITS = 12;
+
+/** Hashes the four bytes at a position.
+ * @param p Pointer to at least four bytes.
+ * @return Hash table slot.
+ */
+static uint32_t hash4(const char *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/** Appends a length that did not fit in a token nibble, 255 at a time.
+ * @param out Buffer to append to.
+ * @param length Length minus 15.
+ * @return None.
+ */
+static void putLength(std::string &out, size_t length) {
+	while(length >= 255) {
+		out += (char)255;
+		length -= 255;
+	}
+	out += (char)length;
+}
+
+/** Reads a length that did not fit in a token nibble.
+ * @param src Compressed data.
+ * @param size Size of the compressed data.
+ * @param pos Read position, moved past the length bytes.
+ * @param length Length to add to.
+ * @return False if the data ends first.
+ */
+static bool takeLength(const unsigned char *src, size_t size, size_t &pos, size_t &length) {
+	unsigned char b;
+	do {
+		if(pos >= size)
+			return false;
+		b = src[pos++];
+		length += b;
+	} while(b == 255);
+	return true;
+}
+
+/** Compresses a block.
+ * @param src Data to compress.
+ * @param size Size of the data.
+ * @param out Buffer the compressed data is appended to.
+ * @return None.
+ */
+void BlockCodec::compress(const char *src, size_t size, std::string &out) {
+	std::vector<int64_t> table(1 << HASH_BITS, -1);
+	size_t anchor = 0, pos = 0;
+
+	while(pos + MIN_MATCH <= size) {
+		uint32_t h = hash4(src + pos);
+		int64_t candidate = table[h];
+		table[h] = pos;
+
+		if(candidate < 0 || pos - candidate > 0xFFFF || memcmp(src + candidate, src + pos, MIN_MATCH) != 0) {
+			pos++;
+			continue;
+		}
+
+		size_t length = MIN_MATCH;
+		while(pos + length < size && src[candidate + length] == src[pos + length])
+			length++;
+
+		size_t literals = pos - anchor;
+		size_t extra = length - MIN_MATCH;
+		out += (char)(((literals < 15 ? literals : 15) << 4) | (extra < 15 ? extra : 15));
+		if(literals >= 15)
+			putLength(out, literals - 15);
+		out.append(src + anchor, literals);
+		uint16_t offset = pos - candidate;
+		out += (char)(offset & 0xFF);
+		out += (char)(offset >> 8);
+		if(extra >= 15)
+			putLength(out, extra - 15);
+
+		pos += length;
+		anchor = pos;
+	}
+
+	// Whatever is left goes out as literals
+	size_t literals = size - anchor;
+	out += (char)((literals < 15 ? literals : 15) << 4);
+	if(literals >= 15)
+		putLength(out, literals - 15);
+	out.append(src + anchor, literals);
+}
+
+/** Decompresses a block.
+ * @param src Compressed data.
+ * @param size Size of the compressed data.
+ * @param dst Buffer with room for the raw data.
+ * @param rawSize Size of the raw data.
+ * @return False if the data is malformed.
+ */
+bool BlockCodec::decompress(const char *src, size_t size, char *dst, size_t rawSize) {
+	const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+	size_t pos = 0, outPos = 0;
+
+	while(pos < size) {
+		unsigned char token = in[pos++];
+		size_t literals = token >> 4;
+		if(literals == 15 && !takeLength(in, size, pos, literals))
+			return false;
+		if(size - pos < literals || rawSize - outPos < literals)
+			return false;
+		memcpy(dst + outPos, in + pos, literals);
+		pos += literals;
+		outPos += literals;
+
+		if(outPos == rawSize)
+			return pos == size;
+		if(size - pos < 2)
+			return false;
+		size_t offset = in[pos] | (in[pos + 1] << 8);
+		pos += 2;
+		size_t length = token & 0x0F;
+		if(length == 15 && !takeLength(in, size, pos, length))
+			return false;
+		length += MIN_MATCH;
+		if(offset == 0 || offset > outPos || rawSize - outPos < length)
+			return false;
+
+		// Copy byte by byte, the match may overlap what it is writing
+		for(size_t i = 0; i < length; i++, outPos++)
+			dst[outPos] = dst[outPos - offset];
+	}
+	return outPos == rawSize;
+}
+
+/** Class constructor.
+ * @param out Buffer the blocks are appended to.
+ * @return None.
+ */
+BlockWriter::BlockWriter(std::string &out) : out(out) {
+	block.reserve(BLOCK_SIZE);
+}
+
+/** Compresses the buffered bytes and appends them as a block.
+ * @return None.
+ */
+void BlockWriter::flushBlock() {
+	if(block.empty())
+		return;
+
+	std::string packed;
+	BlockCodec::compress(block.data(), block.size(), packed);
+	// Data that does not shrink is stored as it is
+	const std::string &stored = packed.size() < block.size() ? packed : block;
+
+	uint32_t header[2] = {(uint32_t)block.size(), (uint32_t)stored.size()};
+	out.append(reinterpret_cast<const char *>(header), sizeof(header));
+	out += stored;
+	block.clear();
+}
+
+/** Writes raw bytes.
+ * @param data Bytes to write.
+ * @param size Number of bytes.
+ * @return None.
+ */
+void BlockWriter::write(const void *data, size_t size) {
+	const char *p = static_cast<const char *>(data);
+	while(size > 0) {
+		size_t room = BLOCK_SIZE - block.size();
+		size_t n = size < room ? size : room;
+		block.append(p, n);
+		p += n;
+		size -= n;
+		if(block.size() == BLOCK_SIZE)
+			flushBlock();
+	}
+}
+
+/** Writes an unsigned value in seven-bit groups, lowest first.
+ * @param value Value to write.
+ * @return None.
+ */
+void BlockWriter::writeVarint(uint64_t value) {
+	char bytes[10];
+	size_t n = 0;
+	while(value >= 0x80) {
+		bytes[n++] = (char)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[n++] = (char)value;
+	write(bytes, n);
+}
+
+/** Writes a signed value as a varint, mapping small negative values to small codes.
+ * @param value Value to write.
+ * @return None.
+ */
+void BlockWriter::writeSigned(int64_t value) {
+	writeVarint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/** Writes a string prefixed by its length.
+ * @param text String to write.
+ * @return None.
+ */
+void BlockWriter::writeString(const std::string &text) {
+	writeVarint(text.size());
+	write(text.data(), text.size());
+}
+
+/** Writes the last block and the end of the stream.
+ * @return None.
+ */
+void BlockWriter::finish() {
+	flushBlock();
+	uint32_t header[2] = {0, 0};
+	out.append(reinterpret_cast<const char *>(header), sizeof(header));
+}
+
+/** Class constructor.
+ * @param data Stream of blocks, which must stay in memory while it is read.
+ * @param size Size of the stream in bytes.
+ * @return None.
+ */
+BlockReader::BlockReader(const char *data, size_t size) {
+	in = data;
+	end = data + size;
+	block = NULL;
+	blockSize = 0;
+	pos = 0;
+}
+
+/** Moves on to the next block, decompressing it if needed.
+ * @return False at the end of the stream or if the block is malformed.
+ */
+bool BlockReader::nextBlock() {
+	uint32_t header[2];
+	if((size_t)(end - in) < sizeof(header))
+		return false;
+	memcpy(header, in, sizeof(header));
+	if(header[0] == 0 || header[0] > MAX_BLOCK || header[1] > header[0] || (size_t)(end - in) - sizeof(header) < header[1]) {
+		// Nothing more is read from a stream that has ended or is malformed
+		in = end;
+		return false;
+	}
+
+	const char *stored = in + sizeof(header);
+	in = stored + header[1];
+	pos = 0;
+	// An uncompressed block is read where it is
+	if(header[1] == header[0]) {
+		block = stored;
+		blockSize = header[0];
+		return true;
+	}
+
+	buffer.resize(header[0]);
+	if(!BlockCodec::decompress(stored, header[1], &buffer[0], buffer.size())) {
+		in = end;
+		return false;
+	}
+	block = buffer.data();
+	blockSize = buffer.size();
+	return true;
+}
+
+/** Reads raw bytes, moving on to the next block as needed.
+ * @param data Buffer to read into.
+ * @param size Number of bytes.
+ * @return False if the stream ends first.
+ */
+bool BlockReader::read(void *data, size_t size) {
+	char *p = static_cast<char *>(data);
+	while(size > 0) {
+		if(pos == blockSize && !nextBlock())
+			return false;
+		size_t n = blockSize - pos < size ? blockSize - pos : size;
+		memcpy(p, block + pos, n);
+		pos += n;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+/** Reads a value written by BlockWriter::writeVarint().
+ * @param value Variable the value is read into.
+ * @return False if the stream ends first or the value is too long.
+ */
+bool BlockReader::readVarint(uint64_t &value) {
+	value = 0;
+	for(int shift = 0; shift < 64; shift += 7) {
+		unsigned char b;
+		if(!read(&b, 1))
+			return false;
+		value |= (uint64_t)(b & 0x7F) << shift;
+		if(!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+/** Reads a value written by BlockWriter::writeSigned().
+ * @param value Variable the value is read into.
+ * @return False if the stream ends first.
+ */
+bool BlockReader::readSigned(int64_t &value) {
+	uint64_t code;
+	if(!readVarint(code))
+		return false;
+	value = (int64_t)(code >> 1) ^ -(int64_t)(code & 1);
+	return true;
+}
+
+/** Reads a string written by BlockWriter::writeString().
+ * @param text String the value is read into.
+ * @return False if the stream ends first.
+ */
+bool BlockReader::readString(std::string &text) {
+	uint64_t length;
+	if(!readVarint(length) || length > MAX_BLOCK)
+		return false;
+	text.resize(length);
+	return length == 0 || read(&text[0], length);
+}
@@ -0,0 +1,55 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/** LZ77 compression of single blocks, in the style of LZ4. */
+class BlockCodec {
+	public:
+		static void compress(const char *src, size_t size, std::string &out);
+		static bool decompress(const char *src, size_t size, char *dst, size_t rawSize);
+};
+
+/** Writes bytes and varints as a stream of compressed blocks. */
+class BlockWriter {
+	private:
+		std::string &out;
+		std::string block;
+
+		void flushBlock();
+
+	public:
+		BlockWriter(std::string &out);
+
+		void write(const void *data, size_t size);
+		void writeVarint(uint64_t value);
+		void writeSigned(int64_t value);
+		void writeString(const std::string &text);
+		void finish();
+};
+
+/** Reads a stream written by BlockWriter from memory, decompressing one block at a time. */
+class BlockReader {
+	private:
+		const char *in;
+		const char *end;
+		// Block being read, either decompressed into the buffer or left where it is stored
+		std::string buffer;
+		const char *block;
+		size_t blockSize;
+		size_t pos;
+
+		bool nextBlock();
+
+	public:
+		BlockReader(const char *data, size_t size);
+
+		bool read(void *data, size_t size);
+		bool readVarint(uint64_t &value);
+		bool readSigned(int64_t &value);
+		bool readString(std::string &text);
+};
+
+#endif
@@ -0,0 +1,87 @@
+/** \file BloomFilter.h
+ * \brief Bloom filter over strings.
+ * \details Sized at ten bits per item with seven probes, which gives about one false positive in a hundred. Probes
+ * come from two FNV-1a hashes combined, so the bits are the same in every build and can be saved to disk. An empty
+ * filter contains everything, so a segment without a filter is never skipped.
+ */
+
+#include "BloomFilter.h"
+
+constexpr int BITS_PER_ITEM = 10;
+constexpr int PROBES = 7;
+
+/** Default constructor. Creates an empty filter that reports every key as possibly present.
+ * @return None.
+ */
+BloomFilter::BloomFilter() {}
+
+/** Class constructor. Creates a filter with room for a number of items.
+ * @param items Number of items expected.
+ * @return None.
+ */
+BloomFilter::BloomFilter(size_t items) {
+	bits.assign((items * BITS_PER_ITEM + 63) / 64 + 1, 0);
+}
+
+/** Class constructor. Creates a filter from saved bits.
+ * @param words Bits of the filter, as returned by getWords().
+ * @return None.
+ */
+BloomFilter::BloomFilter(const std::vector<uint64_t> &words) {
+	bits = words;
+}
+
+/** Hashes a key with FNV-1a.
+ * @param key Key to hash.
+ * @param seed Starting value of the hash.
+ * @return 64-bit hash.
+ */
+uint64_t BloomFilter::hash(const std::string &key, uint64_t seed) {
+	uint64_t h = seed;
+	for(std::string::const_iterator i = key.begin(); i != key.end(); i++) {
+		h ^= (unsigned char)*i;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/** Adds a key.
+ * @param key Key to add.
+ * @return None.
+ */
+void BloomFilter::add(const std::string &key) {
+	if(bits.empty())
+		return;
+
+	uint64_t size = bits.size() * 64;
+	uint64_t h1 = hash(key, 14695981039346656037ULL), h2 = hash(key, 0x9e3779b97f4a7c15ULL) | 1;
+	for(int p = 0; p < PROBES; p++) {
+		uint64_t bit = (h1 + p * h2) % size;
+		bits[bit / 64] |= 1ULL << (bit % 64);
+	}
+}
+
+/** Checks if a key may have been added.
+ * @param key Key to look up.
+ * @return False if the key was definitely never added, true otherwise.
+ */
+bool BloomFilter::mayContain(const std::string &key) const {
+	if(bits.empty())
+		return true;
+
+	uint64_t size = bits.size() * 64;
+	uint64_t h1 = hash(key, 14695981039346656037ULL), h2 = hash(key, 0x9e3779b97f4a7c15ULL) | 1;
+	for(int p = 0; p < PROBES; p++) {
+		uint64_t bit = (h1 + p * h2) % size;
+		if(!(bits[bit / 64] & (1ULL << (bit % 64))))
+			return false;
+	}
+	return true;
+}
+
+/** Gets the bits of the filter, for saving.
+ * @return Bits in 64-bit words.
+ */
+const std::vector<uint64_t> &BloomFilter::getWords() const {
+	return bits;
+}
@@ -0,0 +1,25 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/** Set of strings that can give false positives but never false negatives. */
+class BloomFilter {
+	private:
+		std::vector<uint64_t> bits;
+
+		static uint64_t hash(const std::string &key, uint64_t seed);
+
+	public:
+		BloomFilter();
+		BloomFilter(size_t items);
+		BloomFilter(const std::vector<uint64_t> &words);
+
+		void add(const std::string &key);
+		bool mayContain(const std::string &key) const;
+		const std::vector<uint64_t> &getWords() const;
+};
+
+#endif
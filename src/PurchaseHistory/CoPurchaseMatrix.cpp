@@ -0,0 +1,259 @@
+/** \file CoPurchaseMatrix.h
+ * \brief Counts of products bought together, for "frequently bought together" suggestions.
+ * \details The matrix is sparse: each product has a row holding, for every other product that shares a purchase
+ * history with it, the number of histories holding both. Each row also keeps its eight largest counts in order, so a
+ * lookup is one hash lookup and a copy of at most eight entries however many products there are. Adding or removing
+ * a history only touches the rows of the products in it, and the ordered counts are patched in place unless a
+ * removal lowers one of them.
+ *
+ * A rebuild first gathers every history's distinct products into one flat list, one store at a time so the stores
+ * can be dropped as it goes, then counts the pairs on every core. Each task owns the rows whose product code falls in
+ * its share, so tasks never write to the same row and nothing needs merging afterwards.
+ */
+
+#include "CoPurchaseMatrix.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <functional>
+
+constexpr size_t CoPurchaseMatrix::TOP_KEPT;
+
+/** Gets the code of a product, giving it one and a row if it has none.
+ * @param id Unique ID of the product.
+ * @return Position of the product's row.
+ */
+uint32_t CoPurchaseMatrix::productCode(const std::string &id) {
+	std::unordered_map<std::string, uint32_t>::const_iterator found = productCodes.find(id);
+	if(found != productCodes.end())
+		return found->second;
+
+	uint32_t code = products.size();
+	products.push_back(id);
+	productCodes[id] = code;
+	rows.push_back(Row());
+	return code;
+}
+
+/** Gets the distinct products of a history.
+ * @param store Store holding the history.
+ * @param record Record number of the history.
+ * @param basket Vector the product codes are written to, in increasing order.
+ * @return None.
+ */
+void CoPurchaseMatrix::basketOf(const HistoryStore &store, uint32_t record, std::vector<uint32_t> &basket) {
+	basket.clear();
+	for(uint32_t l = store.firstLine(record); l < store.endLine(record); l++)
+		basket.push_back(productCode(store.getProduct(store.productColumn()[l]).id));
+	std::sort(basket.begin(), basket.end());
+	basket.erase(std::unique(basket.begin(), basket.end()), basket.end());
+}
+
+/** Adds one to a count and moves it up the row's ordered counts if it now belongs there.
+ * @param row Row of the first product.
+ * @param partner Code of the product bought with it.
+ * @return None.
+ */
+void CoPurchaseMatrix::raise(Row &row, uint32_t partner) {
+	uint32_t count = ++row.counts[partner];
+	size_t pos = 0;
+	while(pos < row.top.size() && row.top[pos].second != partner)
+		pos++;
+
+	if(pos == row.top.size()) {
+		// Only the raised count changed, so it displaces the smallest kept count if it now beats it
+		if(row.top.size() < TOP_KEPT)
+			row.top.push_back(std::make_pair(count, partner));
+		else if(count > row.top.back().first)
+			row.top.back() = std::make_pair(count, partner);
+		else
+			return;
+		pos = row.top.size() - 1;
+	}
+
+	row.top[pos].first = count;
+	for(; pos > 0 && row.top[pos - 1].first < row.top[pos].first; pos--)
+		std::swap(row.top[pos - 1], row.top[pos]);
+}
+
+/** Takes one off a count. If the count was among the row's ordered counts they are worked out again, since a count
+ * that was not kept may now be larger.
+ * @param row Row of the first product.
+ * @param partner Code of the product bought with it.
+ * @return None.
+ */
+void CoPurchaseMatrix::lower(Row &row, uint32_t partner) {
+	std::unordered_map<uint32_t, uint32_t>::iterator found = row.counts.find(partner);
+	if(found == row.counts.end())
+		return;
+	if(--found->second == 0)
+		row.counts.erase(found);
+
+	for(size_t i = 0; i < row.top.size(); i++) {
+		if(row.top[i].second == partner) {
+			rank(row);
+			return;
+		}
+	}
+}
+
+/** Works out a row's largest counts from all of its counts.
+ * @param row Row to rank.
+ * @return None.
+ */
+void CoPurchaseMatrix::rank(Row &row) {
+	std::vector<std::pair<uint32_t, uint32_t>> all;
+	all.reserve(row.counts.size());
+	for(std::unordered_map<uint32_t, uint32_t>::const_iterator i = row.counts.begin(); i != row.counts.end(); i++)
+		all.push_back(std::make_pair(i->second, i->first));
+
+	size_t kept = all.size() < TOP_KEPT ? all.size() : TOP_KEPT;
+	std::partial_sort(all.begin(), all.begin() + kept, all.end(), std::greater<std::pair<uint32_t, uint32_t>>());
+	row.top.assign(all.begin(), all.begin() + kept);
+}
+
+/** Adds the distinct products of every history in a store to the list countGathered() counts. Deleted histories
+ * are left out. The store is not needed once this returns.
+ * @param store Store holding the histories.
+ * @return None.
+ */
+void CoPurchaseMatrix::gather(const HistoryStore &store) {
+	std::vector<uint32_t> basket;
+	for(uint32_t r = 0; r < store.records(); r++) {
+		if(store.isDeleted(r))
+			continue;
+		basketOf(store, r, basket);
+		if(basket.size() < 2)
+			continue;
+		gatheredStarts.push_back(gatheredItems.size());
+		gatheredItems.insert(gatheredItems.end(), basket.begin(), basket.end());
+	}
+}
+
+/** Counts the gathered histories in parallel, on top of the counts already held, then drops the gathered list.
+ * @return None.
+ */
+void CoPurchaseMatrix::countGathered() {
+	std::vector<uint32_t> items, starts;
+	items.swap(gatheredItems);
+	starts.swap(gatheredStarts);
+	starts.push_back(items.size());
+
+	size_t tasks = TaskPool::workers();
+	TaskPool::run(tasks, [&](size_t t) {
+		for(size_t b = 0; b + 1 < starts.size(); b++) {
+			for(uint32_t i = starts[b]; i < starts[b + 1]; i++) {
+				if(items[i] % tasks != t)
+					continue;
+				Row &row = rows[items[i]];
+				for(uint32_t j = starts[b]; j < starts[b + 1]; j++) {
+					if(j != i)
+						row.counts[items[j]]++;
+				}
+			}
+		}
+		for(size_t code = t; code < rows.size(); code += tasks)
+			rank(rows[code]);
+	});
+}
+
+/** Counts every history in a store from scratch, in parallel.
+ * @param store Store holding the histories. Deleted histories are left out.
+ * @return None.
+ */
+void CoPurchaseMatrix::rebuild(const HistoryStore &store) {
+	clear();
+	gather(store);
+	countGathered();
+}
+
+/** Adds one to, or takes one off, the count of every pair of products in a history.
+ * @param basket Distinct product codes of the history.
+ * @param add True to add the history, false to take it back.
+ * @return None.
+ */
+void CoPurchaseMatrix::countBasket(const std::vector<uint32_t> &basket, bool add) {
+	for(size_t i = 0; i < basket.size(); i++) {
+		for(size_t j = 0; j < basket.size(); j++) {
+			if(j == i)
+				continue;
+			if(add)
+				raise(rows[basket[i]], basket[j]);
+			else
+				lower(rows[basket[i]], basket[j]);
+		}
+	}
+}
+
+/** Counts the products of a history that was just added.
+ * @param store Store holding the history.
+ * @param record Record number of the history.
+ * @return None.
+ */
+void CoPurchaseMatrix::addBasket(const HistoryStore &store, uint32_t record) {
+	std::vector<uint32_t> basket;
+	basketOf(store, record, basket);
+	countBasket(basket, true);
+}
+
+/** Takes back the counts of a history that is being deleted.
+ * @param store Store holding the history.
+ * @param record Record number of the history.
+ * @return None.
+ */
+void CoPurchaseMatrix::removeBasket(const HistoryStore &store, uint32_t record) {
+	std::vector<uint32_t> basket;
+	basketOf(store, record, basket);
+	countBasket(basket, false);
+}
+
+/** Counts a history given by the IDs of its products, for histories no longer in a store.
+ * @param productIDs Unique IDs of the products in the history, each once.
+ * @return None.
+ */
+void CoPurchaseMatrix::addBasket(const std::vector<std::string> &productIDs) {
+	std::vector<uint32_t> basket;
+	for(size_t i = 0; i < productIDs.size(); i++)
+		basket.push_back(productCode(productIDs[i]));
+	countBasket(basket, true);
+}
+
+/** Takes back the counts of a history given by the IDs of its products.
+ * @param productIDs Unique IDs of the products in the history, each once.
+ * @return None.
+ */
+void CoPurchaseMatrix::removeBasket(const std::vector<std::string> &productIDs) {
+	std::vector<uint32_t> basket;
+	for(size_t i = 0; i < productIDs.size(); i++)
+		basket.push_back(productCode(productIDs[i]));
+	countBasket(basket, false);
+}
+
+/** Gets the products most often bought together with a product.
+ * @param productID Unique ID of the product.
+ * @param count Largest number of products returned, at most eight.
+ * @return Products with the number of histories they share with the product, most shared first.
+ */
+std::vector<CoPurchase> CoPurchaseMatrix::topPartners(const std::string &productID, size_t count) const {
+	std::vector<CoPurchase> partners;
+	std::unordered_map<std::string, uint32_t>::const_iterator found = productCodes.find(productID);
+	if(found == productCodes.end())
+		return partners;
+
+	const std::vector<std::pair<uint32_t, uint32_t>> &top = rows[found->second].top;
+	for(size_t i = 0; i < top.size() && i < count; i++) {
+		CoPurchase partner = {products[top[i].second], top[i].first};
+		partners.push_back(partner);
+	}
+	return partners;
+}
+
+/** Removes every count.
+ * @return None.
+ */
+void CoPurchaseMatrix::clear() {
+	products.clear();
+	productCodes.clear();
+	rows.clear();
+	gatheredItems.clear();
+	gatheredStarts.clear();
+}
@@ -0,0 +1,55 @@
+#ifndef CO_PURCHASE_MATRIX_H
+#define CO_PURCHASE_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+#include "HistoryStore.h"
+
+/** A product bought together with another, and how many purchase histories hold both. */
+struct CoPurchase {
+	std::string productID;
+	uint32_t baskets;
+};
+
+class CoPurchaseMatrix {
+	private:
+		/** Co-purchase counts of one product, with the largest kept in order. */
+		struct Row {
+			std::unordered_map<uint32_t, uint32_t> counts;
+			// Pairs of count and product code, largest count first
+			std::vector<std::pair<uint32_t, uint32_t>> top;
+		};
+
+		std::vector<std::string> products;
+		std::unordered_map<std::string, uint32_t> productCodes;
+		std::vector<Row> rows;
+		// Distinct product codes of every gathered history, one after another, and where each history starts
+		std::vector<uint32_t> gatheredItems;
+		std::vector<uint32_t> gatheredStarts;
+
+		uint32_t productCode(const std::string &id);
+		void basketOf(const HistoryStore &store, uint32_t record, std::vector<uint32_t> &basket);
+		void raise(Row &row, uint32_t partner);
+		void lower(Row &row, uint32_t partner);
+		void countBasket(const std::vector<uint32_t> &basket, bool add);
+		static void rank(Row &row);
+
+	public:
+		// Largest number of partners kept in order for each product
+		static constexpr size_t TOP_KEPT = 8;
+
+		void gather(const HistoryStore &store);
+		void countGathered();
+		void rebuild(const HistoryStore &store);
+		void addBasket(const HistoryStore &store, uint32_t record);
+		void removeBasket(const HistoryStore &store, uint32_t record);
+		void addBasket(const std::vector<std::string> &productIDs);
+		void removeBasket(const std::vector<std::string> &productIDs);
+		std::vector<CoPurchase> topPartners(const std::string &productID, size_t count) const;
+		void clear();
+};
+
+#endif
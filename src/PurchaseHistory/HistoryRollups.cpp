@@ -0,0 +1,239 @@
+/** \file HistoryRollups.h
+ * \brief Daily sales totals for purchase histories past their retention period.
+ * \details Once a history is older than the retention period its order lines are added to two sets of daily totals,
+ * units and revenue per product and per member, and the history itself is dropped. The horizon is the date before
+ * which only these totals remain. Queries over rolled up days count whole days.
+ *
+ * Encoding (as a BlockWriter stream): the horizon, then the product rows and the member rows. Each set starts with
+ * its row count, and each row is the day as its distance from the row before, the product or member ID, the units,
+ * and the revenue as the bits of a double.
+ */
+
+#include "HistoryRollups.h"
+#include <cstring>
+#include <utility>
+
+constexpr time_t DAY_SECONDS = 86400;
+
+/** Default constructor. Starts with no rollups and no horizon.
+ * @return None.
+ */
+HistoryRollups::HistoryRollups() {
+	horizon = 0;
+}
+
+/** Gets the day a date falls in.
+ * @param date Date to look up.
+ * @return Number of days since the epoch, rounded down.
+ */
+int64_t HistoryRollups::dayOf(time_t date) {
+	int64_t day = date / DAY_SECONDS;
+	// Division rounds towards zero, dates before the epoch belong to the day before
+	if(date < 0 && date % DAY_SECONDS != 0)
+		day--;
+	return day;
+}
+
+/** Gets the first second of a day.
+ * @param day Day number, as returned by dayOf().
+ * @return Date the day starts at.
+ */
+time_t HistoryRollups::dayStart(int64_t day) {
+	return day * DAY_SECONDS;
+}
+
+/** Gets the date before which histories are only held as rollups.
+ * @return The horizon, 0 if nothing has been rolled up.
+ */
+time_t HistoryRollups::getHorizon() const {
+	return horizon;
+}
+
+/** Moves the horizon forward.
+ * @param date New horizon. A date before the current horizon is ignored.
+ * @return None.
+ */
+void HistoryRollups::setHorizon(time_t date) {
+	if(date > horizon)
+		horizon = date;
+}
+
+/** Adds an order line to the totals of its day.
+ * @param date Date of the purchase.
+ * @param memberID Unique ID of the member who bought it.
+ * @param productID Unique ID of the product bought.
+ * @param units Quantity bought.
+ * @param revenue Total cost paid.
+ * @return None.
+ */
+void HistoryRollups::add(time_t date, int memberID, const std::string &productID, int units, float revenue) {
+	int64_t day = dayOf(date);
+	SalesTotals &product = productDays[day].emplace(productID, SalesTotals{0, 0}).first->second;
+	product.units += units;
+	product.revenue += revenue;
+	SalesTotals &member = memberDays[day].emplace(memberID, SalesTotals{0, 0}).first->second;
+	member.units += units;
+	member.revenue += revenue;
+}
+
+/** Removes the totals of a member. Product totals keep the member's purchases.
+ * @param memberID Unique ID of the member.
+ * @return True if the member had any totals.
+ */
+bool HistoryRollups::eraseMember(int memberID) {
+	bool found = false;
+	for(std::map<int64_t, std::unordered_map<int, SalesTotals>>::iterator d = memberDays.begin(); d != memberDays.end();) {
+		if(d->second.erase(memberID) > 0)
+			found = true;
+		if(d->second.empty())
+			d = memberDays.erase(d);
+		else
+			d++;
+	}
+	return found;
+}
+
+/** Adds up the daily totals of a product.
+ * @param productID Unique ID of the product.
+ * @param from Date in the first day counted.
+ * @param to Date in the last day counted.
+ * @return Units sold and revenue over those days.
+ */
+SalesTotals HistoryRollups::productTotals(const std::string &productID, time_t from, time_t to) const {
+	SalesTotals totals = {0, 0};
+	std::map<int64_t, std::unordered_map<std::string, SalesTotals>>::const_iterator d = productDays.lower_bound(dayOf(from));
+	for(; d != productDays.end() && d->first <= dayOf(to); d++) {
+		std::unordered_map<std::string, SalesTotals>::const_iterator row = d->second.find(productID);
+		if(row != d->second.end()) {
+			totals.units += row->second.units;
+			totals.revenue += row->second.revenue;
+		}
+	}
+	return totals;
+}
+
+/** Adds up the daily totals of a member.
+ * @param memberID Unique ID of the member.
+ * @param from Date in the first day counted.
+ * @param to Date in the last day counted.
+ * @return Units bought and money spent over those days.
+ */
+SalesTotals HistoryRollups::memberTotals(int memberID, time_t from, time_t to) const {
+	SalesTotals totals = {0, 0};
+	std::map<int64_t, std::unordered_map<int, SalesTotals>>::const_iterator d = memberDays.lower_bound(dayOf(from));
+	for(; d != memberDays.end() && d->first <= dayOf(to); d++) {
+		std::unordered_map<int, SalesTotals>::const_iterator row = d->second.find(memberID);
+		if(row != d->second.end()) {
+			totals.units += row->second.units;
+			totals.revenue += row->second.revenue;
+		}
+	}
+	return totals;
+}
+
+/** Gets the number of days with rollups.
+ * @return Number of days any product was sold on.
+ */
+size_t HistoryRollups::days() const {
+	return productDays.size();
+}
+
+/** Writes a row's totals.
+ * @param out Stream to write to.
+ * @param totals Totals to write.
+ * @return None.
+ */
+static void writeTotals(BlockWriter &out, const SalesTotals &totals) {
+	uint64_t bits;
+	memcpy(&bits, &totals.revenue, sizeof(bits));
+	out.writeSigned(totals.units);
+	out.write(&bits, sizeof(bits));
+}
+
+/** Reads a row's totals.
+ * @param in Stream to read from.
+ * @param totals Totals to read into.
+ * @return False if the stream ends first.
+ */
+static bool readTotals(BlockReader &in, SalesTotals &totals) {
+	uint64_t bits;
+	if(!in.readSigned(totals.units) || !in.read(&bits, sizeof(bits)))
+		return false;
+	memcpy(&totals.revenue, &bits, sizeof(bits));
+	return true;
+}
+
+/** Writes the rollups to a block stream.
+ * @param out Stream to write to.
+ * @return None.
+ */
+void HistoryRollups::encode(BlockWriter &out) const {
+	out.writeSigned(horizon);
+
+	uint64_t rows = 0;
+	for(std::map<int64_t, std::unordered_map<std::string, SalesTotals>>::const_iterator d = productDays.begin(); d != productDays.end(); d++)
+		rows += d->second.size();
+	out.writeVarint(rows);
+	int64_t previous = 0;
+	for(std::map<int64_t, std::unordered_map<std::string, SalesTotals>>::const_iterator d = productDays.begin(); d != productDays.end(); d++) {
+		for(std::unordered_map<std::string, SalesTotals>::const_iterator row = d->second.begin(); row != d->second.end(); row++) {
+			out.writeSigned(d->first - previous);
+			previous = d->first;
+			out.writeString(row->first);
+			writeTotals(out, row->second);
+		}
+	}
+
+	rows = 0;
+	for(std::map<int64_t, std::unordered_map<int, SalesTotals>>::const_iterator d = memberDays.begin(); d != memberDays.end(); d++)
+		rows += d->second.size();
+	out.writeVarint(rows);
+	previous = 0;
+	for(std::map<int64_t, std::unordered_map<int, SalesTotals>>::const_iterator d = memberDays.begin(); d != memberDays.end(); d++) {
+		for(std::unordered_map<int, SalesTotals>::const_iterator row = d->second.begin(); row != d->second.end(); row++) {
+			out.writeSigned(d->first - previous);
+			previous = d->first;
+			out.writeSigned(row->first);
+			writeTotals(out, row->second);
+		}
+	}
+}
+
+/** Replaces the rollups with ones read from a block stream written by encode(). The rollups are left unchanged if
+ * the stream is malformed.
+ * @param in Stream to read from.
+ * @return True if the rollups were loaded.
+ */
+bool HistoryRollups::decode(BlockReader &in) {
+	HistoryRollups loaded;
+	int64_t value;
+	uint64_t rows;
+	if(!in.readSigned(value) || !in.readVarint(rows))
+		return false;
+	loaded.horizon = value;
+
+	int64_t day = 0;
+	for(uint64_t r = 0; r < rows; r++) {
+		std::string productID;
+		SalesTotals totals;
+		if(!in.readSigned(value) || !in.readString(productID) || !readTotals(in, totals))
+			return false;
+		day += value;
+		loaded.productDays[day][productID] = totals;
+	}
+
+	if(!in.readVarint(rows))
+		return false;
+	day = 0;
+	for(uint64_t r = 0; r < rows; r++) {
+		int64_t memberID;
+		SalesTotals totals;
+		if(!in.readSigned(value) || !in.readSigned(memberID) || !readTotals(in, totals))
+			return false;
+		day += value;
+		loaded.memberDays[day][memberID] = totals;
+	}
+
+	*this = std::move(loaded);
+	return true;
+}
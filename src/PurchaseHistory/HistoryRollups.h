@@ -0,0 +1,43 @@
+#ifndef HISTORY_ROLLUPS_H
+#define HISTORY_ROLLUPS_H
+
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include "BlockCodec.h"
+
+/** Units sold and money taken over some period. */
+struct SalesTotals {
+	int64_t units;
+	double revenue;
+};
+
+class HistoryRollups {
+	private:
+		// Histories before this date are only held as rollups
+		time_t horizon;
+		// Daily totals, keyed by day number and then by product ID or member ID
+		std::map<int64_t, std::unordered_map<std::string, SalesTotals>> productDays;
+		std::map<int64_t, std::unordered_map<int, SalesTotals>> memberDays;
+
+	public:
+		HistoryRollups();
+
+		static int64_t dayOf(time_t date);
+		static time_t dayStart(int64_t day);
+
+		time_t getHorizon() const;
+		void setHorizon(time_t date);
+		void add(time_t date, int memberID, const std::string &productID, int units, float revenue);
+		bool eraseMember(int memberID);
+		SalesTotals productTotals(const std::string &productID, time_t from, time_t to) const;
+		SalesTotals memberTotals(int memberID, time_t from, time_t to) const;
+		size_t days() const;
+
+		void encode(BlockWriter &out) const;
+		bool decode(BlockReader &in);
+};
+
+#endif
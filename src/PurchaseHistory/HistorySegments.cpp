@@ -0,0 +1,476 @@
+/** \file HistorySegments.h
+ * \brief Purchase history split into time-bounded segment files.
+ * \details Each segment file holds the histories of one 30-day window, named after the day the window starts
+ * (history-YYYYMMDD.seg). A segment is "VMHC", the HistoryStore records as a compressed block stream, then a
+ * footer. The file is memory-mapped and the records are decoded straight from the mapping one block at a time.
+ * Segments starting "VMHB" were written before checkouts were numbered and have no checkout numbers, and segments
+ * written before compression hold the fixed-width encoding instead. Both are still read, and are rewritten in the
+ * current form when next changed. The footer records the earliest and latest purchase date, the lowest and highest
+ * member ID, the number of histories, and a bloom filter of the product IDs bought. Opening the history reads only
+ * the footers. A query loads just the segments whose footer says they can hold a match, decoding them in parallel,
+ * and only segments whose window changed are rewritten.
+ *
+ * Footer layout (host byte order): window number, earliest and latest date, lowest and highest member ID, history
+ * count, bloom filter word count and words, then the footer's size and "VMHZ" as the last eight bytes of the file.
+ */
+
+#include "HistorySegments.h"
+#include "TaskPool.h"
+#include "MappedFile.h"
+#include <iostream>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr time_t SEGMENT_SECONDS = 30 * 86400;
+static const char FOOTER_MAGIC[4] = {'V', 'M', 'H', 'Z'};
+static const char BLOCK_MAGIC[4] = {'V', 'M', 'H', 'C'};
+static const char UNNUMBERED_MAGIC[4] = {'V', 'M', 'H', 'B'};	// Compressed, from before checkouts were numbered
+
+/** Appends the bytes of a fixed-width value.
+ * @param out Buffer to append to.
+ * @param value Value to append.
+ * @return None.
+ */
+template <typename T>
+static void put(std::string &out, const T &value) {
+	out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/** Reads a fixed-width value.
+ * @param data Buffer to read from.
+ * @param pos Read position, moved past the value.
+ * @param value Variable the value is read into.
+ * @return False if the buffer ends before the value does.
+ */
+template <typename T>
+static bool take(const std::string &data, size_t &pos, T &value) {
+	if(data.size() - pos < sizeof(T))
+		return false;
+	memcpy(&value, data.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+/** Class constructor. Creates a set with no segments.
+ * @return None.
+ */
+HistorySegments::HistorySegments() {}
+
+/** Class destructor.
+ * @return None.
+ */
+HistorySegments::~HistorySegments() {}
+
+/** Gets the window a date falls in.
+ * @param date Date of a purchase.
+ * @return Number of the 30-day window.
+ */
+int64_t HistorySegments::bucketOf(time_t date) {
+	return date / SEGMENT_SECONDS;
+}
+
+/** Gets the time a window starts.
+ * @param bucket Number of the window.
+ * @return First second of the window.
+ */
+time_t HistorySegments::bucketStart(int64_t bucket) {
+	return bucket * SEGMENT_SECONDS;
+}
+
+/** Gets the name of the segment file for a window.
+ * @param bucket Number of the window.
+ * @return File name, e.g. history-20261016.seg.
+ */
+std::string HistorySegments::fileName(int64_t bucket) {
+	time_t start = bucketStart(bucket);
+	struct tm day;
+	gmtime_r(&start, &day);
+	char name[32];
+	strftime(name, sizeof(name), "history-%Y%m%d.seg", &day);
+	return std::string(name);
+}
+
+/** Finds where the footer of a segment file starts.
+ * @param file Mapped segment file.
+ * @param bodySize Set to the size of everything in front of the footer.
+ * @return False if the file has no valid footer.
+ */
+bool HistorySegments::footerAt(const MappedFile &file, size_t &bodySize) {
+	if(file.size() < 8)
+		return false;
+
+	// The last eight bytes give the size of the footer in front of them, only those pages are read
+	const char *tail = file.data() + file.size() - 8;
+	uint32_t footerSize;
+	memcpy(&footerSize, tail, sizeof(footerSize));
+	if(memcmp(tail + 4, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0 || footerSize > file.size() - 8)
+		return false;
+	bodySize = file.size() - 8 - footerSize;
+	return true;
+}
+
+/** Reads the footer of a segment file.
+ * @param fileName Path of the segment.
+ * @param bucket Set to the window the segment holds.
+ * @param zone Set to the zone map in the footer.
+ * @return False if the file cannot be read or has no valid footer.
+ */
+bool HistorySegments::readZone(const std::string &fileName, int64_t &bucket, SegmentZone &zone) {
+	MappedFile file(fileName);
+	size_t bodySize;
+	if(!footerAt(file, bodySize))
+		return false;
+	zone.bodySize = bodySize;
+	std::string footer(file.data() + bodySize, file.size() - 8 - bodySize);
+
+	size_t pos = 0;
+	int64_t minDate, maxDate;
+	uint32_t words;
+	if(!take(footer, pos, bucket) || !take(footer, pos, minDate) || !take(footer, pos, maxDate) ||
+			!take(footer, pos, zone.minMember) || !take(footer, pos, zone.maxMember) ||
+			!take(footer, pos, zone.records) || !take(footer, pos, words) || (footer.size() - pos) / 8 < words)
+		return false;
+
+	std::vector<uint64_t> bits(words);
+	for(uint32_t w = 0; w < words; w++)
+		take(footer, pos, bits[w]);
+	zone.minDate = minDate;
+	zone.maxDate = maxDate;
+	zone.products = BloomFilter(bits);
+	zone.loaded = false;
+	zone.failed = false;
+	return true;
+}
+
+/** Finds the segment files in the working directory and reads their footers. No histories are loaded.
+ * @return Number of segments found.
+ */
+int HistorySegments::open() {
+	DIR *dir = opendir(".");
+	if(dir == NULL)
+		return 0;
+
+	struct dirent *entry;
+	while((entry = readdir(dir)) != NULL) {
+		std::string name = entry->d_name;
+		if(name.size() <= 12 || name.compare(0, 8, "history-") != 0 || name.compare(name.size() - 4, 4, ".seg") != 0)
+			continue;
+
+		int64_t bucket;
+		SegmentZone zone;
+		if(readZone(name, bucket, zone) && name == fileName(bucket))
+			zones[bucket] = zone;
+		else
+			std::cerr << "Skipping damaged purchase history segment " << name << "\n";
+	}
+	closedir(dir);
+	return zones.size();
+}
+
+/** Checks if there are no segments.
+ * @return True if no segment has been found or written.
+ */
+bool HistorySegments::empty() const {
+	return zones.empty();
+}
+
+/** Gets the names of every segment file.
+ * @return File names, oldest window first.
+ */
+std::vector<std::string> HistorySegments::fileNames() const {
+	std::vector<std::string> names;
+	for(std::map<int64_t, SegmentZone>::const_iterator i = zones.begin(); i != zones.end(); i++)
+		names.push_back(fileName(i->first));
+	return names;
+}
+
+/** Gets the number of segments whose histories are in memory.
+ * @return Number of loaded segments.
+ */
+int HistorySegments::loadedCount() const {
+	int count = 0;
+	for(std::map<int64_t, SegmentZone>::const_iterator i = zones.begin(); i != zones.end(); i++) {
+		if(i->second.loaded)
+			count++;
+	}
+	return count;
+}
+
+/** Decodes the histories in front of a segment's footer.
+ * @param data Start of the segment.
+ * @param bodySize Size of everything in front of the footer.
+ * @param segment Store the histories are read into.
+ * @return False if the histories could not be decoded.
+ */
+bool HistorySegments::decodeBody(const char *data, size_t bodySize, HistoryStore &segment) {
+	bool numbered = bodySize >= sizeof(BLOCK_MAGIC) && memcmp(data, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) == 0;
+	if(numbered || (bodySize >= sizeof(UNNUMBERED_MAGIC) && memcmp(data, UNNUMBERED_MAGIC, sizeof(UNNUMBERED_MAGIC)) == 0)) {
+		BlockReader reader(data + sizeof(BLOCK_MAGIC), bodySize - sizeof(BLOCK_MAGIC));
+		return segment.decode(reader, numbered);
+	}
+
+	// Segment from before compression, everything in front of the footer is the encoding
+	return segment.deserialize(std::string(data, bodySize));
+}
+
+/** Reads the histories of a segment file.
+ * @param bucket Window of the segment.
+ * @param segment Store the histories are read into.
+ * @return False if the segment could not be read.
+ */
+bool HistorySegments::read(int64_t bucket, HistoryStore &segment) const {
+	std::map<int64_t, SegmentZone>::const_iterator zone = zones.find(bucket);
+	MappedFile file(fileName(bucket));
+	// The file must still be the one whose footer was read
+	if(zone == zones.end() || file.size() < zone->second.bodySize + 8)
+		return false;
+	return decodeBody(file.data(), zone->second.bodySize, segment);
+}
+
+/** Reads the histories of a segment file mapped earlier, going by its own footer rather than the one read when the
+ * segments were opened. A mapping keeps the file as it was even if the segment is rewritten since.
+ * @param file Mapped segment file.
+ * @param segment Store the histories are read into.
+ * @return False if the segment could not be read.
+ */
+bool HistorySegments::decodeFile(const MappedFile &file, HistoryStore &segment) {
+	size_t bodySize;
+	return footerAt(file, bodySize) && decodeBody(file.data(), bodySize, segment);
+}
+
+/** Loads the histories of several segments into a store. The segments are decoded in parallel, each into a store
+ * of its own, and then merged in date order.
+ * @param store Store to load into.
+ * @param buckets Windows of the segments, none of them loaded yet.
+ * @return None.
+ */
+void HistorySegments::load(HistoryStore &store, const std::vector<int64_t> &buckets) {
+	std::vector<HistoryStore> decoded(buckets.size());
+	std::vector<char> read(buckets.size(), 0);
+	TaskPool::run(buckets.size(), [&](size_t t) {
+		read[t] = this->read(buckets[t], decoded[t]);
+	});
+
+	for(size_t t = 0; t < buckets.size(); t++) {
+		if(read[t]) {
+			zones[buckets[t]].loaded = true;
+			store.merge(decoded[t]);
+		}
+		else {
+			// A damaged segment is not retried on every query, and is never rewritten from what is in memory
+			zones[buckets[t]].failed = true;
+			std::cerr << "Could not read purchase history segment " << fileName(buckets[t]) << "\n";
+		}
+		decoded[t] = HistoryStore();
+	}
+}
+
+/** Loads the segment a date falls in, so a history at that date can be found or added.
+ * @param store Store to load into.
+ * @param date Date of the history.
+ * @return None.
+ */
+void HistorySegments::loadBucket(HistoryStore &store, time_t date) {
+	std::map<int64_t, SegmentZone>::iterator i = zones.find(bucketOf(date));
+	if(i != zones.end() && !i->second.loaded && !i->second.failed)
+		load(store, std::vector<int64_t>(1, i->first));
+}
+
+/** Loads every segment that may hold histories between two dates.
+ * @param store Store to load into.
+ * @param from Earliest date wanted.
+ * @param to Latest date wanted.
+ * @return None.
+ */
+void HistorySegments::loadRange(HistoryStore &store, time_t from, time_t to) {
+	std::vector<int64_t> buckets;
+	for(std::map<int64_t, SegmentZone>::iterator i = zones.begin(); i != zones.end(); i++) {
+		if(!i->second.loaded && !i->second.failed && i->second.maxDate >= from && i->second.minDate <= to)
+			buckets.push_back(i->first);
+	}
+	load(store, buckets);
+}
+
+/** Loads every segment that may hold histories of a member between two dates.
+ * @param store Store to load into.
+ * @param memberID Unique ID of the member.
+ * @param from Earliest date wanted.
+ * @param to Latest date wanted.
+ * @return None.
+ */
+void HistorySegments::loadMember(HistoryStore &store, int memberID, time_t from, time_t to) {
+	std::vector<int64_t> buckets;
+	for(std::map<int64_t, SegmentZone>::iterator i = zones.begin(); i != zones.end(); i++) {
+		const SegmentZone &zone = i->second;
+		if(!zone.loaded && !zone.failed && zone.maxDate >= from && zone.minDate <= to && zone.minMember <= memberID && memberID <= zone.maxMember)
+			buckets.push_back(i->first);
+	}
+	load(store, buckets);
+}
+
+/** Loads every segment whose bloom filter says it may hold a purchase of a product.
+ * @param store Store to load into.
+ * @param productID Unique ID of the product.
+ * @return None.
+ */
+void HistorySegments::loadProduct(HistoryStore &store, const std::string &productID) {
+	std::vector<int64_t> buckets;
+	for(std::map<int64_t, SegmentZone>::iterator i = zones.begin(); i != zones.end(); i++) {
+		if(!i->second.loaded && !i->second.failed && i->second.products.mayContain(productID))
+			buckets.push_back(i->first);
+	}
+	load(store, buckets);
+}
+
+/** Notes that the histories of a window have changed. The window's segment must already be loaded, or have failed
+ * to load, in which case flush() leaves it alone.
+ * @param date Date of a history that was added or removed.
+ * @return None.
+ */
+void HistorySegments::markDirty(time_t date) {
+	dirty.insert(bucketOf(date));
+}
+
+/** Encodes the segments of every changed window, updating their zone maps. Windows stay pending until synced()
+ * is called, so a failed write is retried by the next flush. A window whose segment could not be read is not
+ * rewritten or deleted, as memory holds only the changes and not what is in the file; allFlushed() then returns
+ * false.
+ * @param store Store holding the histories.
+ * @param records Set to the number of histories in the encoded segments.
+ * @return Files to write, with empty contents for windows that no longer hold any histories.
+ */
+std::vector<SegmentFile> HistorySegments::flush(const HistoryStore &store, int &records) {
+	unsynced.insert(dirty.begin(), dirty.end());
+	dirty.clear();
+	records = 0;
+
+	for(std::set<int64_t>::iterator b = unsynced.begin(); b != unsynced.end();) {
+		std::map<int64_t, SegmentZone>::const_iterator old = zones.find(*b);
+		if(old != zones.end() && old->second.failed) {
+			if(unreadable.insert(*b).second)
+				std::cerr << "Not rewriting unreadable purchase history segment " << fileName(*b) << ", its changes stay in the log\n";
+			unsynced.erase(b++);
+		}
+		else
+			b++;
+	}
+
+	std::vector<SegmentFile> files;
+	const std::vector<uint32_t> &byDate = store.byDate();
+	for(std::set<int64_t>::iterator b = unsynced.begin(); b != unsynced.end(); b++) {
+		SegmentFile file;
+		file.name = fileName(*b);
+
+		// Deleted histories are left out, which is where their space is reclaimed on disk
+		std::vector<uint32_t> live;
+		std::vector<uint32_t>::const_iterator end = store.lowerBound(byDate, bucketStart(*b + 1));
+		for(std::vector<uint32_t>::const_iterator i = store.lowerBound(byDate, bucketStart(*b)); i != end; i++) {
+			if(!store.isDeleted(*i))
+				live.push_back(*i);
+		}
+		std::vector<uint32_t>::const_iterator first = live.begin(), last = live.end();
+		if(first == last) {
+			zones.erase(*b);
+			files.push_back(file);
+			continue;
+		}
+
+		SegmentZone zone;
+		zone.minDate = store.getDate(*first);
+		zone.maxDate = store.getDate(*(last - 1));
+		zone.minMember = std::numeric_limits<int>::max();
+		zone.maxMember = std::numeric_limits<int>::min();
+		zone.records = last - first;
+		zone.loaded = true;
+		zone.failed = false;
+
+		std::set<uint32_t> bought;
+		for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+			zone.minMember = std::min(zone.minMember, store.getMemberID(*r));
+			zone.maxMember = std::max(zone.maxMember, store.getMemberID(*r));
+			for(uint32_t l = store.firstLine(*r); l < store.endLine(*r); l++)
+				bought.insert(store.productColumn()[l]);
+		}
+		zone.products = BloomFilter(bought.size());
+		for(std::set<uint32_t>::iterator p = bought.begin(); p != bought.end(); p++)
+			zone.products.add(store.getProduct(*p).id);
+
+		file.contents.assign(BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+		BlockWriter writer(file.contents);
+		store.encode(writer, first, last);
+		writer.finish();
+		size_t footerStart = file.contents.size();
+		zone.bodySize = footerStart;
+		put<int64_t>(file.contents, *b);
+		put<int64_t>(file.contents, zone.minDate);
+		put<int64_t>(file.contents, zone.maxDate);
+		put<int32_t>(file.contents, zone.minMember);
+		put<int32_t>(file.contents, zone.maxMember);
+		put<uint32_t>(file.contents, zone.records);
+		const std::vector<uint64_t> &words = zone.products.getWords();
+		put<uint32_t>(file.contents, words.size());
+		for(std::vector<uint64_t>::const_iterator w = words.begin(); w != words.end(); w++)
+			put<uint64_t>(file.contents, *w);
+		put<uint32_t>(file.contents, file.contents.size() - footerStart);
+		file.contents.append(FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+
+		zones[*b] = zone;
+		records += zone.records;
+		files.push_back(file);
+	}
+	return files;
+}
+
+/** Marks every flushed window as safely on disk.
+ * @return None.
+ */
+void HistorySegments::synced() {
+	unsynced.clear();
+}
+
+/** Checks if every changed window was flushed, or if some are held back because their segment could not be read.
+ * Their changes are only in memory and the history log, so the log must be kept.
+ * @return True if no changed window was held back.
+ */
+bool HistorySegments::allFlushed() const {
+	return unreadable.empty();
+}
+
+/** Writes segment files. Each file is written to a temporary file and flushed to disk before being renamed into
+ * place, so a crash leaves either the old or the new segment.
+ * @param files Files from flush().
+ * @return True if every file was written or removed.
+ */
+bool HistorySegments::writeFiles(const std::vector<SegmentFile> &files) {
+	bool ok = true;
+	for(std::vector<SegmentFile>::const_iterator f = files.begin(); f != files.end(); f++) {
+		if(f->contents.empty()) {
+			unlink(f->name.c_str());
+			continue;
+		}
+
+		std::string temp = f->name + ".tmp";
+		int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd == -1) {
+			ok = false;
+			continue;
+		}
+
+		size_t written = 0;
+		while(written < f->contents.size()) {
+			ssize_t n = write(fd, f->contents.data() + written, f->contents.size() - written);
+			if(n <= 0)
+				break;
+			written += n;
+		}
+		bool synced = written == f->contents.size() && fsync(fd) == 0;
+		close(fd);
+		if(!synced || rename(temp.c_str(), f->name.c_str()) != 0)
+			ok = false;
+	}
+	return ok;
+}
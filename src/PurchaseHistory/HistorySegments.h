@@ -0,0 +1,73 @@
+#ifndef HISTORY_SEGMENTS_H
+#define HISTORY_SEGMENTS_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include "HistoryStore.h"
+#include "BloomFilter.h"
+
+class MappedFile;
+
+/** Zone map kept in a segment's footer: the ranges and products its histories fall in. */
+struct SegmentZone {
+	time_t minDate;
+	time_t maxDate;
+	int minMember;
+	int maxMember;
+	uint32_t records;
+	uint64_t bodySize;
+	BloomFilter products;
+	bool loaded;
+	// The segment could not be read, so it is neither loaded again nor rewritten from memory
+	bool failed;
+};
+
+/** New contents for a segment file. Empty contents mean the file is to be deleted. */
+struct SegmentFile {
+	std::string name;
+	std::string contents;
+};
+
+class HistorySegments {
+	private:
+		std::map<int64_t, SegmentZone> zones;
+		std::set<int64_t> dirty;
+		std::set<int64_t> unsynced;
+		// Changed windows whose segment could not be read, whose changes stay in the history log
+		std::set<int64_t> unreadable;
+
+		void load(HistoryStore &store, const std::vector<int64_t> &buckets);
+		bool read(int64_t bucket, HistoryStore &segment) const;
+		static bool readZone(const std::string &fileName, int64_t &bucket, SegmentZone &zone);
+		static bool footerAt(const MappedFile &file, size_t &bodySize);
+		static bool decodeBody(const char *data, size_t bodySize, HistoryStore &segment);
+
+	public:
+		HistorySegments();
+		~HistorySegments();
+
+		static int64_t bucketOf(time_t date);
+		static time_t bucketStart(int64_t bucket);
+		static std::string fileName(int64_t bucket);
+
+		int open();
+		bool empty() const;
+		int loadedCount() const;
+		std::vector<std::string> fileNames() const;
+		static bool decodeFile(const MappedFile &file, HistoryStore &segment);
+		void loadBucket(HistoryStore &store, time_t date);
+		void loadRange(HistoryStore &store, time_t from, time_t to);
+		void loadMember(HistoryStore &store, int memberID, time_t from, time_t to);
+		void loadProduct(HistoryStore &store, const std::string &productID);
+		void markDirty(time_t date);
+		std::vector<SegmentFile> flush(const HistoryStore &store, int &records);
+		void synced();
+		bool allFlushed() const;
+		static bool writeFiles(const std::vector<SegmentFile> &files);
+};
+
+#endif
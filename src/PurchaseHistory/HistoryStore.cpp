@@ -0,0 +1,786 @@
+/** \file HistoryStore.h
+ * \brief Columnar storage for purchase histories.
+ * \details Purchase histories are kept as columns instead of PurchaseHistory objects. Each history is a member code,
+ * a date and the position of its first order line. Each order line is a product code, quantity, unit price, discount
+ * rate and cost paid, held in fixed-width arrays. Product IDs, names and categories and member IDs are stored once
+ * in dictionaries. An order line takes 20 bytes in memory, and totals over the history are tight loops over the
+ * arrays. PurchaseHistory objects are only built when a caller asks for one. Record indexes are also kept
+ * sorted by date, per member and overall, so date range lookups are two binary searches. Deleting a history only
+ * sets its bit in a tombstone bitmap, and readers skip it until purge() removes deleted records in one pass.
+ * Each history also keeps the sequence number of the checkout that made it, and that number is what recognises a
+ * history seen twice, so two checkouts by one member in the same second are both kept.
+ *
+ * Records are written with encode() as a BlockWriter stream: the product, member, record and line counts, the
+ * product dictionary, the member IDs, the record member codes, each date as its distance from the one before, each
+ * checkout number as its distance from the one before, the line count of each record, and then the five line
+ * columns one after the other. Integers are varints and floats are XORed with the product's previous value, so
+ * repeated prices take one byte before block compression. Streams written before checkouts were numbered have no
+ * checkout numbers.
+ *
+ * The older fixed-width encoding (host byte order) is still read by deserialize(): "VMHS", version, product,
+ * member, record and line counts, the product dictionary as length-prefixed strings, the member IDs, the record
+ * member codes, the first date followed by 32-bit date differences, the line count of each record, and the five
+ * line columns as plain arrays. Histories read from it have no checkout number.
+ */
+
+#include "HistoryStore.h"
+#include "BlockCodec.h"
+#include <cstring>
+#include <algorithm>
+#include <utility>
+
+static const char MAGIC[4] = {'V', 'M', 'H', 'S'};
+constexpr uint32_t FORMAT_VERSION = 1;
+
+/** Reads a fixed-width value.
+ * @param data Buffer to read from.
+ * @param pos Read position, moved past the value.
+ * @param value Variable the value is read into.
+ * @return False if the buffer ends before the value does.
+ */
+template <typename T>
+static bool take(const std::string &data, size_t &pos, T &value) {
+	if(data.size() - pos < sizeof(T))
+		return false;
+	memcpy(&value, data.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+/** Reads a whole column.
+ * @param data Buffer to read from.
+ * @param pos Read position, moved past the column.
+ * @param column Vector the column is read into.
+ * @param count Number of entries in the column.
+ * @return False if the buffer ends before the column does.
+ */
+template <typename T>
+static bool takeColumn(const std::string &data, size_t &pos, std::vector<T> &column, size_t count) {
+	if((data.size() - pos) / sizeof(T) < count)
+		return false;
+	column.resize(count);
+	if(count > 0)
+		memcpy(column.data(), data.data() + pos, count * sizeof(T));
+	pos += count * sizeof(T);
+	return true;
+}
+
+/** Reads a length-prefixed string.
+ * @param data Buffer to read from.
+ * @param pos Read position, moved past the string.
+ * @param text String the value is read into.
+ * @return False if the buffer ends before the string does.
+ */
+static bool takeString(const std::string &data, size_t &pos, std::string &text) {
+	uint32_t length;
+	if(!take(data, pos, length) || data.size() - pos < length)
+		return false;
+	text.assign(data, pos, length);
+	pos += length;
+	return true;
+}
+
+/** Class constructor. Creates an empty store.
+ * @return None.
+ */
+HistoryStore::HistoryStore() {
+	tombstoneCount = 0;
+}
+
+/** Class destructor.
+ * @return None.
+ */
+HistoryStore::~HistoryStore() {}
+
+/** Gets the dictionary code of a product, adding the product if it is new. The name and category are updated to
+ * the ones given, so every line shows the product's latest details.
+ * @param id Unique ID of the product.
+ * @param name Name of the product.
+ * @param category Category of the product.
+ * @return Code of the product.
+ */
+uint32_t HistoryStore::productCode(const std::string &id, const std::string &name, const std::string &category) {
+	std::unordered_map<std::string, uint32_t>::iterator it = productCodes.find(id);
+	if(it != productCodes.end()) {
+		products[it->second].name = name;
+		products[it->second].category = category;
+		return it->second;
+	}
+
+	HistoryProduct product = {id, name, category};
+	products.push_back(product);
+	productCodes.emplace(id, products.size() - 1);
+	return products.size() - 1;
+}
+
+/** Gets the dictionary code of a member, adding the member if it is new.
+ * @param memberID Unique ID of the member.
+ * @return Code of the member.
+ */
+uint32_t HistoryStore::memberCode(int memberID) {
+	std::unordered_map<int, uint32_t>::iterator it = memberCodes.find(memberID);
+	if(it != memberCodes.end())
+		return it->second;
+
+	members.push_back(memberID);
+	memberRecords.push_back(std::vector<uint32_t>());
+	memberCodes.emplace(memberID, members.size() - 1);
+	return members.size() - 1;
+}
+
+/** Adds a record to a date-ordered index. Records usually arrive in date order, so this is normally an append.
+ * @param index Index to add to.
+ * @param record Index of the record.
+ * @return None.
+ */
+void HistoryStore::insertByDate(std::vector<uint32_t> &index, uint32_t record) {
+	std::vector<uint32_t>::iterator pos = index.end();
+	if(!index.empty() && recordDate[index.back()] > recordDate[record])
+		pos = index.begin() + (upperBound(index, recordDate[record]) - index.begin());
+	index.insert(pos, record);
+}
+
+/** Rebuilds the date-ordered indexes after records have moved.
+ * @return None.
+ */
+void HistoryStore::rebuildIndexes() {
+	const std::vector<time_t> &dates = recordDate;
+	auto earlier = [&dates](uint32_t a, uint32_t b) { return dates[a] < dates[b]; };
+
+	timeIndex.resize(recordMember.size());
+	memberRecords.assign(members.size(), std::vector<uint32_t>());
+	checkoutRecords.clear();
+	for(uint32_t r = 0; r < recordMember.size(); r++) {
+		timeIndex[r] = r;
+		memberRecords[recordMember[r]].push_back(r);
+		if(recordCheckout[r] != 0)
+			checkoutRecords[recordCheckout[r]] = r;
+	}
+
+	std::stable_sort(timeIndex.begin(), timeIndex.end(), earlier);
+	for(std::vector<std::vector<uint32_t>>::iterator i = memberRecords.begin(); i != memberRecords.end(); i++)
+		std::stable_sort(i->begin(), i->end(), earlier);
+}
+
+/** Adds a purchase history. A history from a checkout already stored, even one since deleted, is not added again.
+ * @param history PurchaseHistory to add.
+ * @param checkout Sequence number of the checkout that made the history, 0 if it has none.
+ * @return True if the history was added, false if it was already stored.
+ */
+bool HistoryStore::add(PurchaseHistory &history, uint64_t checkout) {
+	if(checkout != 0 && !checkoutRecords.emplace(checkout, recordMember.size()).second)
+		return false;
+
+	uint32_t member = memberCode(history.getMemberID());
+	uint32_t record = recordMember.size();
+	recordMember.push_back(member);
+	recordDate.push_back(history.getRawTime());
+	recordStart.push_back(lineProduct.size());
+	recordCheckout.push_back(checkout);
+	insertByDate(memberRecords[member], record);
+	insertByDate(timeIndex, record);
+
+	for(std::list<Order>::iterator i = history.begin(); i != history.end(); i++) {
+		const Product &product = i->getProduct();
+		lineProduct.push_back(productCode(product.getID(), product.getName(), product.getCategory()));
+		lineQuantity.push_back(i->getQuantity());
+		linePrice.push_back(product.getPrice());
+		lineDiscount.push_back(product.getDiscountRate());
+		lineCost.push_back(i->getTotalCost());
+	}
+	return true;
+}
+
+/** Finds the record of a member's purchase at a given time. Deleted records are not found.
+ * @param memberID Unique ID of the member.
+ * @param date Date of the purchase.
+ * @return Index of the record, or -1 if there is none.
+ */
+int HistoryStore::find(int memberID, time_t date) const {
+	const std::vector<uint32_t> &own = recordsOf(memberID);
+	// A deleted record can sit next to a history added again later with the same date
+	for(std::vector<uint32_t>::const_iterator i = lowerBound(own, date); i != own.end() && recordDate[*i] == date; i++) {
+		if(!isDeleted(*i))
+			return *i;
+	}
+	return -1;
+}
+
+/** Finds the record of a checkout. Deleted records are found too, until they are purged.
+ * @param checkout Sequence number of the checkout.
+ * @return Index of the record, or -1 if there is none.
+ */
+int HistoryStore::findCheckout(uint64_t checkout) const {
+	std::unordered_map<uint64_t, uint32_t>::const_iterator it = checkoutRecords.find(checkout);
+	if(checkout == 0 || it == checkoutRecords.end())
+		return -1;
+	return it->second;
+}
+
+/** Gets the records of a member.
+ * @param memberID Unique ID of the member.
+ * @return Indexes of the member's records ordered by date, empty if the member has none.
+ */
+const std::vector<uint32_t> &HistoryStore::recordsOf(int memberID) const {
+	static const std::vector<uint32_t> none;
+	std::unordered_map<int, uint32_t>::const_iterator it = memberCodes.find(memberID);
+	if(it == memberCodes.end())
+		return none;
+	return memberRecords[it->second];
+}
+
+/** Gets every record.
+ * @return Indexes of all records ordered by date.
+ */
+const std::vector<uint32_t> &HistoryStore::byDate() const {
+	return timeIndex;
+}
+
+/** Finds the first record in a date-ordered index dated at or after a time.
+ * @param index Index returned by recordsOf() or byDate().
+ * @param date Time to search for.
+ * @return Position of the first record not before the time.
+ */
+std::vector<uint32_t>::const_iterator HistoryStore::lowerBound(const std::vector<uint32_t> &index, time_t date) const {
+	const std::vector<time_t> &dates = recordDate;
+	return std::lower_bound(index.begin(), index.end(), date, [&dates](uint32_t r, time_t t) { return dates[r] < t; });
+}
+
+/** Finds the first record in a date-ordered index dated after a time.
+ * @param index Index returned by recordsOf() or byDate().
+ * @param date Time to search for.
+ * @return Position of the first record after the time.
+ */
+std::vector<uint32_t>::const_iterator HistoryStore::upperBound(const std::vector<uint32_t> &index, time_t date) const {
+	const std::vector<time_t> &dates = recordDate;
+	return std::upper_bound(index.begin(), index.end(), date, [&dates](time_t t, uint32_t r) { return t < dates[r]; });
+}
+
+/** Builds a PurchaseHistory from a record. Each product carries the discount rate it was sold at as its promotion,
+ * and each order keeps the cost that was paid.
+ * @param record Index of the record.
+ * @return PurchaseHistory holding the record's orders.
+ */
+PurchaseHistory HistoryStore::materialize(uint32_t record) const {
+	std::list<Order> orders;
+	for(uint32_t l = firstLine(record); l < endLine(record); l++) {
+		const HistoryProduct &details = products[lineProduct[l]];
+		Product product = Product(details.name, details.category, details.id, linePrice[l], 0);
+		product.setPromotion(lineDiscount[l]);
+		Order order = Order(product, 0, lineQuantity[l]);
+		order.changeTotalCost(lineCost[l]);
+		orders.push_back(order);
+	}
+	return PurchaseHistory(orders, members[recordMember[record]], recordDate[record]);
+}
+
+/** Removes records, moving the ones after them down. Dictionary entries are kept.
+ * @param drop Flag for each record, true if it is to be removed.
+ * @return None.
+ */
+void HistoryStore::compactRecords(const std::vector<bool> &drop) {
+	uint32_t outRecord = 0, outLine = 0;
+	uint32_t total = recordMember.size();
+	std::vector<bool> kept;
+	uint32_t keptCount = 0;
+	for(uint32_t r = 0; r < total; r++) {
+		uint32_t first = firstLine(r), last = endLine(r);
+		if(drop[r])
+			continue;
+
+		if(isDeleted(r)) {
+			kept.resize(outRecord + 1, false);
+			kept[outRecord] = true;
+			keptCount++;
+		}
+		recordMember[outRecord] = recordMember[r];
+		recordDate[outRecord] = recordDate[r];
+		recordStart[outRecord] = outLine;
+		recordCheckout[outRecord] = recordCheckout[r];
+		for(uint32_t l = first; l < last; l++, outLine++) {
+			lineProduct[outLine] = lineProduct[l];
+			lineQuantity[outLine] = lineQuantity[l];
+			linePrice[outLine] = linePrice[l];
+			lineDiscount[outLine] = lineDiscount[l];
+			lineCost[outLine] = lineCost[l];
+		}
+		outRecord++;
+	}
+
+	recordMember.resize(outRecord);
+	recordDate.resize(outRecord);
+	recordStart.resize(outRecord);
+	recordCheckout.resize(outRecord);
+	lineProduct.resize(outLine);
+	lineQuantity.resize(outLine);
+	linePrice.resize(outLine);
+	lineDiscount.resize(outLine);
+	lineCost.resize(outLine);
+	tombstones.swap(kept);
+	tombstoneCount = keptCount;
+	rebuildIndexes();
+}
+
+/** Marks a record as deleted. It stays in the columns and indexes, where readers skip it, until purge() is called.
+ * @param record Index of the record.
+ * @return None.
+ */
+void HistoryStore::markDeleted(uint32_t record) {
+	if(isDeleted(record))
+		return;
+	if(tombstones.size() <= record)
+		tombstones.resize(recordMember.size(), false);
+	tombstones[record] = true;
+	tombstoneCount++;
+}
+
+/** Checks if a record has been deleted.
+ * @param record Index of the record.
+ * @return True if the record is marked as deleted.
+ */
+bool HistoryStore::isDeleted(uint32_t record) const {
+	return record < tombstones.size() && tombstones[record];
+}
+
+/** Gets the number of records marked as deleted.
+ * @return Number of deleted records not yet purged.
+ */
+size_t HistoryStore::deleted() const {
+	return tombstoneCount;
+}
+
+/** Removes the records marked as deleted, moving the ones after them down.
+ * @return None.
+ */
+void HistoryStore::purge() {
+	if(tombstoneCount == 0)
+		return;
+	std::vector<bool> drop = tombstones;
+	drop.resize(recordMember.size(), false);
+	compactRecords(drop);
+}
+
+/** Removes every record from before a date.
+ * @param date Date the kept records start at.
+ * @return None.
+ */
+void HistoryStore::eraseBefore(time_t date) {
+	std::vector<bool> drop(recordMember.size(), false);
+	for(std::vector<uint32_t>::const_iterator i = timeIndex.begin(); i != lowerBound(timeIndex, date); i++)
+		drop[*i] = true;
+	compactRecords(drop);
+}
+
+/** Removes every record and dictionary entry.
+ * @return None.
+ */
+void HistoryStore::clear() {
+	*this = HistoryStore();
+}
+
+/** Gets the number of records.
+ * @return Number of purchase histories stored.
+ */
+size_t HistoryStore::records() const {
+	return recordMember.size();
+}
+
+/** Gets the number of order lines.
+ * @return Number of order lines across every record.
+ */
+size_t HistoryStore::lines() const {
+	return lineProduct.size();
+}
+
+/** Gets the member a record belongs to.
+ * @param record Index of the record.
+ * @return Unique ID of the member.
+ */
+int HistoryStore::getMemberID(uint32_t record) const {
+	return members[recordMember[record]];
+}
+
+/** Gets the date of a record.
+ * @param record Index of the record.
+ * @return Date of the purchase.
+ */
+time_t HistoryStore::getDate(uint32_t record) const {
+	return recordDate[record];
+}
+
+/** Gets the checkout a record came from.
+ * @param record Index of the record.
+ * @return Sequence number of the checkout, 0 if the history has none.
+ */
+uint64_t HistoryStore::getCheckout(uint32_t record) const {
+	return recordCheckout[record];
+}
+
+/** Gets the position of a record's first order line in the line columns.
+ * @param record Index of the record.
+ * @return Index of the first line.
+ */
+uint32_t HistoryStore::firstLine(uint32_t record) const {
+	return recordStart[record];
+}
+
+/** Gets the position just past a record's last order line in the line columns.
+ * @param record Index of the record.
+ * @return Index one past the last line.
+ */
+uint32_t HistoryStore::endLine(uint32_t record) const {
+	return record + 1 < recordStart.size() ? recordStart[record + 1] : lineProduct.size();
+}
+
+/** Gets the details of a product in the dictionary.
+ * @param code Code of the product, as found in the product column.
+ * @return Product ID, name and category.
+ */
+const HistoryProduct &HistoryStore::getProduct(uint32_t code) const {
+	return products[code];
+}
+
+/** Gets the product code of every order line.
+ * @return Product column.
+ */
+const std::vector<uint32_t> &HistoryStore::productColumn() const {
+	return lineProduct;
+}
+
+/** Gets the quantity bought on every order line.
+ * @return Quantity column.
+ */
+const std::vector<int32_t> &HistoryStore::quantityColumn() const {
+	return lineQuantity;
+}
+
+/** Gets the undiscounted unit price of every order line.
+ * @return Price column.
+ */
+const std::vector<float> &HistoryStore::priceColumn() const {
+	return linePrice;
+}
+
+/** Gets the discount rate of every order line.
+ * @return Discount column.
+ */
+const std::vector<float> &HistoryStore::discountColumn() const {
+	return lineDiscount;
+}
+
+/** Gets the cost paid for every order line.
+ * @return Cost column.
+ */
+const std::vector<float> &HistoryStore::costColumn() const {
+	return lineCost;
+}
+
+/** Writes a float column as the bits of each value XORed with the previous value for the same product, so a
+ * product that keeps its price or discount costs one byte per line.
+ * @param out Stream to write to.
+ * @param column Line column to write.
+ * @param productMap Code each product is written with.
+ * @param productCount Number of products written.
+ * @param first Position of the first record in one of the store's indexes.
+ * @param last Position just past the last record.
+ * @return None.
+ */
+void HistoryStore::encodeFloats(BlockWriter &out, const std::vector<float> &column, const std::vector<uint32_t> &productMap, size_t productCount, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last) const {
+	std::vector<uint32_t> previous(productCount, 0);
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		for(uint32_t l = firstLine(*r); l < endLine(*r); l++) {
+			uint32_t bits, &before = previous[productMap[lineProduct[l]]];
+			memcpy(&bits, &column[l], sizeof(bits));
+			out.writeVarint(bits ^ before);
+			before = bits;
+		}
+	}
+}
+
+/** Reads a float column written by encodeFloats().
+ * @param in Stream to read from.
+ * @param column Line column to fill, already holding one entry per line.
+ * @param productCount Number of products in the dictionary.
+ * @return False if the stream ends first.
+ */
+bool HistoryStore::decodeFloats(BlockReader &in, std::vector<float> &column, size_t productCount) const {
+	std::vector<uint32_t> previous(productCount, 0);
+	for(uint32_t l = 0; l < column.size(); l++) {
+		uint64_t code;
+		if(!in.readVarint(code))
+			return false;
+		uint32_t &before = previous[lineProduct[l]];
+		before ^= (uint32_t)code;
+		memcpy(&column[l], &before, sizeof(float));
+	}
+	return true;
+}
+
+/** Writes some of the store's records to a block stream. Counts, codes and quantities are varints and each date
+ * is written as its distance from the one before. Only the products and members those records refer to are written
+ * to the dictionaries.
+ * @param out Stream to write to.
+ * @param first Position of the first record in one of the store's indexes.
+ * @param last Position just past the last record.
+ * @return None.
+ */
+void HistoryStore::encode(BlockWriter &out, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last) const {
+	const uint32_t unused = UINT32_MAX;
+	std::vector<uint32_t> productMap(products.size(), unused), memberMap(members.size(), unused);
+	std::vector<uint32_t> usedProducts, usedMembers;
+	uint32_t lineCount = 0;
+
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		if(memberMap[recordMember[*r]] == unused) {
+			memberMap[recordMember[*r]] = usedMembers.size();
+			usedMembers.push_back(recordMember[*r]);
+		}
+		for(uint32_t l = firstLine(*r); l < endLine(*r); l++, lineCount++) {
+			if(productMap[lineProduct[l]] == unused) {
+				productMap[lineProduct[l]] = usedProducts.size();
+				usedProducts.push_back(lineProduct[l]);
+			}
+		}
+	}
+
+	out.writeVarint(usedProducts.size());
+	out.writeVarint(usedMembers.size());
+	out.writeVarint(last - first);
+	out.writeVarint(lineCount);
+
+	for(std::vector<uint32_t>::const_iterator i = usedProducts.begin(); i != usedProducts.end(); i++) {
+		out.writeString(products[*i].id);
+		out.writeString(products[*i].name);
+		out.writeString(products[*i].category);
+	}
+	for(std::vector<uint32_t>::const_iterator i = usedMembers.begin(); i != usedMembers.end(); i++)
+		out.writeSigned(members[*i]);
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++)
+		out.writeVarint(memberMap[recordMember[*r]]);
+
+	int64_t previous = 0;
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		out.writeSigned((int64_t)recordDate[*r] - previous);
+		previous = recordDate[*r];
+	}
+	previous = 0;
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		out.writeSigned((int64_t)recordCheckout[*r] - previous);
+		previous = recordCheckout[*r];
+	}
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++)
+		out.writeVarint(endLine(*r) - firstLine(*r));
+
+	// Each line column is written whole before the next
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		for(uint32_t l = firstLine(*r); l < endLine(*r); l++)
+			out.writeVarint(productMap[lineProduct[l]]);
+	}
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++) {
+		for(uint32_t l = firstLine(*r); l < endLine(*r); l++)
+			out.writeSigned(lineQuantity[l]);
+	}
+	encodeFloats(out, linePrice, productMap, usedProducts.size(), first, last);
+	encodeFloats(out, lineDiscount, productMap, usedProducts.size(), first, last);
+	encodeFloats(out, lineCost, productMap, usedProducts.size(), first, last);
+}
+
+/** Replaces the contents of the store with records read from a block stream written by encode(). The store is left
+ * unchanged if the stream is malformed.
+ * @param in Stream to read from.
+ * @param numbered False for a stream written before checkouts were numbered, whose histories get no number.
+ * @return True if the records were loaded.
+ */
+bool HistoryStore::decode(BlockReader &in, bool numbered) {
+	HistoryStore loaded;
+	uint64_t productCount, memberCount, recordCount, lineCount;
+	if(!in.readVarint(productCount) || !in.readVarint(memberCount) || !in.readVarint(recordCount) ||
+			!in.readVarint(lineCount) || lineCount > UINT32_MAX)
+		return false;
+
+	for(uint64_t p = 0; p < productCount; p++) {
+		HistoryProduct product;
+		if(!in.readString(product.id) || !in.readString(product.name) || !in.readString(product.category))
+			return false;
+		loaded.productCodes.emplace(product.id, p);
+		loaded.products.push_back(product);
+	}
+	for(uint64_t m = 0; m < memberCount; m++) {
+		int64_t memberID;
+		if(!in.readSigned(memberID))
+			return false;
+		loaded.memberCodes.emplace(memberID, m);
+		loaded.members.push_back(memberID);
+	}
+	for(uint64_t r = 0; r < recordCount; r++) {
+		uint64_t member;
+		if(!in.readVarint(member) || member >= memberCount)
+			return false;
+		loaded.recordMember.push_back(member);
+	}
+
+	int64_t date = 0;
+	for(uint64_t r = 0; r < recordCount; r++) {
+		int64_t delta;
+		if(!in.readSigned(delta))
+			return false;
+		date += delta;
+		loaded.recordDate.push_back(date);
+	}
+	int64_t checkout = 0;
+	for(uint64_t r = 0; r < recordCount; r++) {
+		int64_t delta = 0;
+		if(numbered && !in.readSigned(delta))
+			return false;
+		checkout += delta;
+		loaded.recordCheckout.push_back(checkout);
+	}
+	uint64_t next = 0;
+	for(uint64_t r = 0; r < recordCount; r++) {
+		uint64_t count;
+		if(!in.readVarint(count))
+			return false;
+		loaded.recordStart.push_back(next);
+		next += count;
+	}
+	if(next != lineCount)
+		return false;
+
+	for(uint64_t l = 0; l < lineCount; l++) {
+		uint64_t product;
+		if(!in.readVarint(product) || product >= productCount)
+			return false;
+		loaded.lineProduct.push_back(product);
+	}
+	for(uint64_t l = 0; l < lineCount; l++) {
+		int64_t quantity;
+		if(!in.readSigned(quantity))
+			return false;
+		loaded.lineQuantity.push_back(quantity);
+	}
+	loaded.linePrice.resize(lineCount);
+	loaded.lineDiscount.resize(lineCount);
+	loaded.lineCost.resize(lineCount);
+	if(!loaded.decodeFloats(in, loaded.linePrice, productCount) || !loaded.decodeFloats(in, loaded.lineDiscount, productCount) ||
+			!loaded.decodeFloats(in, loaded.lineCost, productCount))
+		return false;
+
+	loaded.rebuildIndexes();
+	*this = std::move(loaded);
+	return true;
+}
+
+/** Replaces the contents of the store with records in the fixed-width encoding that history.dat and the first
+ * segment files used. The store is left unchanged if the data is not a valid encoding.
+ * @param data Encoded store.
+ * @return True if the data was loaded, false if it is malformed.
+ */
+bool HistoryStore::deserialize(const std::string &data) {
+	HistoryStore loaded;
+	size_t pos = 0;
+	uint32_t version, productCount, memberCount, recordCount, lineCount;
+
+	if(data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+	pos += sizeof(MAGIC);
+	if(!take(data, pos, version) || version != FORMAT_VERSION || !take(data, pos, productCount) ||
+			!take(data, pos, memberCount) || !take(data, pos, recordCount) || !take(data, pos, lineCount))
+		return false;
+
+	for(uint32_t p = 0; p < productCount; p++) {
+		HistoryProduct product;
+		if(!takeString(data, pos, product.id) || !takeString(data, pos, product.name) ||
+				!takeString(data, pos, product.category))
+			return false;
+		loaded.productCodes.emplace(product.id, p);
+		loaded.products.push_back(product);
+	}
+	if(!takeColumn(data, pos, loaded.members, memberCount) || !takeColumn(data, pos, loaded.recordMember, recordCount))
+		return false;
+	for(uint32_t m = 0; m < memberCount; m++)
+		loaded.memberCodes.emplace(loaded.members[m], m);
+
+	int64_t date;
+	if(!take(data, pos, date))
+		return false;
+	loaded.recordDate.resize(recordCount);
+	for(uint32_t r = 0; r < recordCount; r++) {
+		int32_t delta;
+		if(!take(data, pos, delta))
+			return false;
+		date += delta;
+		loaded.recordDate[r] = date;
+	}
+
+	uint64_t next = 0;
+	loaded.recordStart.resize(recordCount);
+	loaded.recordCheckout.assign(recordCount, 0);
+	for(uint32_t r = 0; r < recordCount; r++) {
+		uint32_t count;
+		if(!take(data, pos, count) || loaded.recordMember[r] >= memberCount)
+			return false;
+		loaded.recordStart[r] = next;
+		next += count;
+	}
+	if(next != lineCount)
+		return false;
+
+	if(!takeColumn(data, pos, loaded.lineProduct, lineCount) || !takeColumn(data, pos, loaded.lineQuantity, lineCount) ||
+			!takeColumn(data, pos, loaded.linePrice, lineCount) || !takeColumn(data, pos, loaded.lineDiscount, lineCount) ||
+			!takeColumn(data, pos, loaded.lineCost, lineCount))
+		return false;
+	for(uint32_t l = 0; l < lineCount; l++) {
+		if(loaded.lineProduct[l] >= productCount)
+			return false;
+	}
+
+	loaded.rebuildIndexes();
+	*this = std::move(loaded);
+	return true;
+}
+
+/** Adds the records of another store that are not already in this one, going by their checkout numbers. Records
+ * newer than everything already stored are appended to the indexes; otherwise the indexes are rebuilt once at the end.
+ * @param other Store to copy records from.
+ * @return Number of records added.
+ */
+int HistoryStore::merge(const HistoryStore &other) {
+	// Dictionary codes are translated once rather than per line
+	std::vector<uint32_t> productMap(other.products.size());
+	for(uint32_t p = 0; p < other.products.size(); p++)
+		productMap[p] = productCode(other.products[p].id, other.products[p].name, other.products[p].category);
+
+	bool ordered = true;
+	int added = 0;
+	for(std::vector<uint32_t>::const_iterator r = other.timeIndex.begin(); r != other.timeIndex.end(); r++) {
+		uint64_t checkout = other.recordCheckout[*r];
+		if(other.isDeleted(*r) || (checkout != 0 && !checkoutRecords.emplace(checkout, recordMember.size()).second))
+			continue;
+
+		uint32_t member = memberCode(other.getMemberID(*r));
+		uint32_t record = recordMember.size();
+		if(ordered && !timeIndex.empty() && recordDate[timeIndex.back()] > other.getDate(*r))
+			ordered = false;
+		recordMember.push_back(member);
+		recordDate.push_back(other.getDate(*r));
+		recordStart.push_back(lineProduct.size());
+		recordCheckout.push_back(checkout);
+		if(ordered) {
+			memberRecords[member].push_back(record);
+			timeIndex.push_back(record);
+		}
+
+		for(uint32_t l = other.firstLine(*r); l < other.endLine(*r); l++) {
+			lineProduct.push_back(productMap[other.lineProduct[l]]);
+			lineQuantity.push_back(other.lineQuantity[l]);
+			linePrice.push_back(other.linePrice[l]);
+			lineDiscount.push_back(other.lineDiscount[l]);
+			lineCost.push_back(other.lineCost[l]);
+		}
+		added++;
+	}
+
+	if(!ordered)
+		rebuildIndexes();
+	return added;
+}
@@ -0,0 +1,97 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+#include "PurchaseHistory.h"
+#include "BlockCodec.h"
+
+/** Product details shared by every order line that refers to the product. */
+struct HistoryProduct {
+	std::string id;
+	std::string name;
+	std::string category;
+};
+
+class HistoryStore {
+	private:
+		// Dictionaries, order lines refer to products and members by their position in these
+		std::vector<HistoryProduct> products;
+		std::unordered_map<std::string, uint32_t> productCodes;
+		std::vector<int> members;
+		std::unordered_map<int, uint32_t> memberCodes;
+		// Record indexes ordered by date, for each member and across every member
+		std::vector<std::vector<uint32_t>> memberRecords;
+		std::vector<uint32_t> timeIndex;
+		// Record index of each numbered checkout, deleted records included
+		std::unordered_map<uint64_t, uint32_t> checkoutRecords;
+
+		// One entry per purchase history
+		std::vector<uint32_t> recordMember;
+		std::vector<time_t> recordDate;
+		std::vector<uint32_t> recordStart;
+		// Checkout sequence number, 0 for histories from before checkouts were numbered
+		std::vector<uint64_t> recordCheckout;
+
+		// One entry per order line
+		std::vector<uint32_t> lineProduct;
+		std::vector<int32_t> lineQuantity;
+		std::vector<float> linePrice;
+		std::vector<float> lineDiscount;
+		std::vector<float> lineCost;
+
+		// Records deleted since the last purge, still in the columns and indexes until then
+		std::vector<bool> tombstones;
+		uint32_t tombstoneCount;
+
+		uint32_t memberCode(int memberID);
+		void insertByDate(std::vector<uint32_t> &index, uint32_t record);
+		void rebuildIndexes();
+		void compactRecords(const std::vector<bool> &drop);
+		void encodeFloats(BlockWriter &out, const std::vector<float> &column, const std::vector<uint32_t> &productMap, size_t productCount, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last) const;
+		bool decodeFloats(BlockReader &in, std::vector<float> &column, size_t productCount) const;
+
+	public:
+		HistoryStore();
+		~HistoryStore();
+
+		uint32_t productCode(const std::string &id, const std::string &name, const std::string &category);
+		bool add(PurchaseHistory &history, uint64_t checkout);
+		int find(int memberID, time_t date) const;
+		int findCheckout(uint64_t checkout) const;
+		const std::vector<uint32_t> &recordsOf(int memberID) const;
+		const std::vector<uint32_t> &byDate() const;
+		std::vector<uint32_t>::const_iterator lowerBound(const std::vector<uint32_t> &index, time_t date) const;
+		std::vector<uint32_t>::const_iterator upperBound(const std::vector<uint32_t> &index, time_t date) const;
+		PurchaseHistory materialize(uint32_t record) const;
+		void markDeleted(uint32_t record);
+		bool isDeleted(uint32_t record) const;
+		size_t deleted() const;
+		void purge();
+		void eraseBefore(time_t date);
+		void clear();
+
+		size_t records() const;
+		size_t lines() const;
+		int getMemberID(uint32_t record) const;
+		time_t getDate(uint32_t record) const;
+		uint64_t getCheckout(uint32_t record) const;
+		uint32_t firstLine(uint32_t record) const;
+		uint32_t endLine(uint32_t record) const;
+		const HistoryProduct &getProduct(uint32_t code) const;
+		const std::vector<uint32_t> &productColumn() const;
+		const std::vector<int32_t> &quantityColumn() const;
+		const std::vector<float> &priceColumn() const;
+		const std::vector<float> &discountColumn() const;
+		const std::vector<float> &costColumn() const;
+
+		void encode(BlockWriter &out, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last) const;
+		bool decode(BlockReader &in, bool numbered);
+		bool deserialize(const std::string &data);
+		int merge(const HistoryStore &other);
+};
+
+#endif
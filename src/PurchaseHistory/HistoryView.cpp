@@ -0,0 +1,208 @@
+/** \file HistoryView.h
+ * \brief Views over purchase histories held in a HistoryStore.
+ * \details A view is a store pointer and a record or line index. Its getters read the store's columns directly, so
+ * going through millions of histories copies nothing. Every view, whether a HistoryRange, a single HistoryView or a
+ * HistoryLine, is only valid until the next history is added to or deleted from the collection or the collection is
+ * compacted, since any of these may renumber or drop records. A later query loading an older segment counts as an
+ * add. Use materialize() to keep a copy after that.
+ */
+
+#include "HistoryView.h"
+#include "HistoryStore.h"
+
+/** Class constructor.
+ * @param store Store holding the line.
+ * @param line Index of the line in the store's line columns.
+ * @return None.
+ */
+HistoryLine::HistoryLine(const HistoryStore *store, uint32_t line) {
+	this->store = store;
+	this->line = line;
+}
+
+/** Gets the ID of the product bought.
+ * @return Unique product ID.
+ */
+const std::string &HistoryLine::getProductID() const {
+	return store->getProduct(store->productColumn()[line]).id;
+}
+
+/** Gets the name of the product bought.
+ * @return Product name.
+ */
+const std::string &HistoryLine::getName() const {
+	return store->getProduct(store->productColumn()[line]).name;
+}
+
+/** Gets the category of the product bought.
+ * @return Product category.
+ */
+const std::string &HistoryLine::getCategory() const {
+	return store->getProduct(store->productColumn()[line]).category;
+}
+
+/** Gets the quantity bought.
+ * @return Number of units.
+ */
+int HistoryLine::getQuantity() const {
+	return store->quantityColumn()[line];
+}
+
+/** Gets the unit price before discounts.
+ * @return Price of one unit.
+ */
+float HistoryLine::getPrice() const {
+	return store->priceColumn()[line];
+}
+
+/** Gets the discount rate the product sold at.
+ * @return Fraction taken off the price.
+ */
+float HistoryLine::getDiscount() const {
+	return store->discountColumn()[line];
+}
+
+/** Gets the amount paid for the line.
+ * @return Total cost of the line.
+ */
+float HistoryLine::getTotalCost() const {
+	return store->costColumn()[line];
+}
+
+/** Default constructor. Creates a null view that refers to no history.
+ * @return None.
+ */
+HistoryView::HistoryView() {
+	store = NULL;
+	record = 0;
+}
+
+/** Class constructor.
+ * @param store Store holding the history.
+ * @param record Index of the history's record.
+ * @return None.
+ */
+HistoryView::HistoryView(const HistoryStore *store, uint32_t record) {
+	this->store = store;
+	this->record = record;
+}
+
+/** Checks if the view refers to no history, e.g. because a lookup found nothing.
+ * @return True if the view is null.
+ */
+bool HistoryView::isNull() const {
+	return store == NULL;
+}
+
+/** Gets the member the history belongs to.
+ * @return Unique member ID.
+ */
+int HistoryView::getMemberID() const {
+	return store->getMemberID(record);
+}
+
+/** Gets the date of the purchase.
+ * @return Timestamp of the purchase.
+ */
+time_t HistoryView::getRawTime() const {
+	return store->getDate(record);
+}
+
+/** Gets the number of order lines in the history.
+ * @return Number of lines.
+ */
+int HistoryView::length() const {
+	return store->endLine(record) - store->firstLine(record);
+}
+
+/** Gets one order line of the history.
+ * @param i Position of the line, from 0 to length() - 1.
+ * @return View of the line.
+ */
+HistoryLine HistoryView::line(int i) const {
+	return HistoryLine(store, store->firstLine(record) + i);
+}
+
+/** Gets the amount paid for the whole history.
+ * @return Sum of the cost of every line.
+ */
+float HistoryView::getTotalCost() const {
+	const std::vector<float> &cost = store->costColumn();
+	float total = 0;
+	for(uint32_t l = store->firstLine(record); l < store->endLine(record); l++)
+		total += cost[l];
+	return total;
+}
+
+/** Copies the history out of the store.
+ * @return PurchaseHistory holding the history's orders.
+ */
+PurchaseHistory HistoryView::materialize() const {
+	return store->materialize(record);
+}
+
+/** Class constructor. Moves past any deleted records at the starting position.
+ * @param store Store the records are in.
+ * @param pos Position in one of the store's indexes.
+ * @param last Position just past the end of the range.
+ * @return None.
+ */
+HistoryRange::iterator::iterator(const HistoryStore *store, std::vector<uint32_t>::const_iterator pos, std::vector<uint32_t>::const_iterator last) : store(store), pos(pos), last(last) {
+	skipDeleted();
+}
+
+/** Moves forward to the next record that has not been deleted.
+ * @return None.
+ */
+void HistoryRange::iterator::skipDeleted() {
+	while(pos != last && store->isDeleted(*pos))
+		++pos;
+}
+
+/** Class constructor.
+ * @param store Store the records are in.
+ * @param first Position of the first record in one of the store's indexes.
+ * @param last Position just past the last record.
+ * @return None.
+ */
+HistoryRange::HistoryRange(const HistoryStore *store, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last) {
+	this->store = store;
+	this->first = first;
+	this->last = last;
+}
+
+/** Gets an iterator to the first history in the range.
+ * @return Iterator that yields HistoryView objects.
+ */
+HistoryRange::iterator HistoryRange::begin() const {
+	return iterator(store, first, last);
+}
+
+/** Gets an iterator just past the last history in the range.
+ * @return End iterator.
+ */
+HistoryRange::iterator HistoryRange::end() const {
+	return iterator(store, last, last);
+}
+
+/** Gets the number of histories in the range. Only counts one by one if the store holds deleted records.
+ * @return Number of histories.
+ */
+size_t HistoryRange::size() const {
+	if(store->deleted() == 0)
+		return last - first;
+
+	size_t count = 0;
+	for(std::vector<uint32_t>::const_iterator i = first; i != last; i++) {
+		if(!store->isDeleted(*i))
+			count++;
+	}
+	return count;
+}
+
+/** Checks if the range is empty.
+ * @return True if the range holds no histories.
+ */
+bool HistoryRange::empty() const {
+	return begin() == end();
+}
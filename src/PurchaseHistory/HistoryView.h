@@ -0,0 +1,83 @@
+#ifndef HISTORY_VIEW_H
+#define HISTORY_VIEW_H
+
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include <cstddef>
+#include "PurchaseHistory.h"
+
+class HistoryStore;
+
+/** Read-only view of one order line in a HistoryStore. */
+class HistoryLine {
+	private:
+		const HistoryStore *store;
+		uint32_t line;
+
+	public:
+		HistoryLine(const HistoryStore *store, uint32_t line);
+
+		const std::string &getProductID() const;
+		const std::string &getName() const;
+		const std::string &getCategory() const;
+		int getQuantity() const;
+		float getPrice() const;
+		float getDiscount() const;
+		float getTotalCost() const;
+};
+
+/** Read-only view of one purchase history in a HistoryStore. */
+class HistoryView {
+	private:
+		const HistoryStore *store;
+		uint32_t record;
+
+	public:
+		HistoryView();
+		HistoryView(const HistoryStore *store, uint32_t record);
+
+		bool isNull() const;
+		int getMemberID() const;
+		time_t getRawTime() const;
+		int length() const;
+		HistoryLine line(int i) const;
+		float getTotalCost() const;
+		PurchaseHistory materialize() const;
+};
+
+/** Run of purchase histories taken from one of a HistoryStore's date-ordered indexes. Deleted histories are skipped. */
+class HistoryRange {
+	public:
+		class iterator {
+			private:
+				const HistoryStore *store;
+				std::vector<uint32_t>::const_iterator pos;
+				std::vector<uint32_t>::const_iterator last;
+
+				void skipDeleted();
+
+			public:
+				iterator(const HistoryStore *store, std::vector<uint32_t>::const_iterator pos, std::vector<uint32_t>::const_iterator last);
+				HistoryView operator*() const { return HistoryView(store, *pos); }
+				iterator &operator++() { ++pos; skipDeleted(); return *this; }
+				bool operator==(const iterator &other) const { return pos == other.pos; }
+				bool operator!=(const iterator &other) const { return pos != other.pos; }
+		};
+
+	private:
+		const HistoryStore *store;
+		std::vector<uint32_t>::const_iterator first;
+		std::vector<uint32_t>::const_iterator last;
+
+	public:
+		HistoryRange(const HistoryStore *store, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last);
+
+		iterator begin() const;
+		iterator end() const;
+		size_t size() const;
+		bool empty() const;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/** \file MappedFile.h
+ * \brief Read-only memory maps for purchase history files.
+ * \details History files are replaced by renaming a new file over them, never changed in place, so a mapping keeps
+ * showing the file as it was when it was mapped. An empty file is open but has no mapping.
+ */
+
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** Class constructor. Maps a file into memory.
+ * @param fileName Path of the file.
+ * @return None.
+ */
+MappedFile::MappedFile(const std::string &fileName) {
+	bytes = NULL;
+	length = 0;
+
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if(fd == -1)
+		return;
+
+	struct stat info;
+	if(fstat(fd, &info) == 0) {
+		void *mapping;
+		// Empty files cannot be mapped, but are still open
+		if(info.st_size == 0)
+			bytes = "";
+		else if((mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+			bytes = static_cast<const char *>(mapping);
+			length = info.st_size;
+		}
+	}
+	// The mapping stays valid once the file is closed
+	close(fd);
+}
+
+/** Class destructor. Unmaps the file.
+ * @return None.
+ */
+MappedFile::~MappedFile() {
+	if(length > 0)
+		munmap(const_cast<char *>(bytes), length);
+}
+
+/** Checks if the file was mapped.
+ * @return False if the file does not exist or could not be mapped.
+ */
+bool MappedFile::isOpen() const {
+	return bytes != NULL;
+}
+
+/** Gets the contents of the file.
+ * @return Pointer to the first byte.
+ */
+const char *MappedFile::data() const {
+	return bytes;
+}
+
+/** Gets the size of the file.
+ * @return Size in bytes.
+ */
+size_t MappedFile::size() const {
+	return length;
+}
@@ -0,0 +1,25 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+/** Read-only memory map of a whole file. Pages are only read from disk when they are touched. */
+class MappedFile {
+	private:
+		const char *bytes;
+		size_t length;
+
+		MappedFile(const MappedFile &other);
+		MappedFile &operator=(const MappedFile &other);
+
+	public:
+		MappedFile(const std::string &fileName);
+		~MappedFile();
+
+		bool isOpen() const;
+		const char *data() const;
+		size_t size() const;
+};
+
+#endif
@@ -1,31 +1,479 @@
 /** \file PurchaseHistoryCollection.h
  * \brief Functionality for purchase history database. 
  * \details Class for reading/writing the purchase history database file, including updating and removing entries.
+ * Histories are held in a columnar HistoryStore and saved in 30-day segment files, with new checkouts and
+ * tombstones for deleted histories appended to a log in between. Startup only reads the segment footers and the
+ * log, so it does not grow with the number of histories. A segment is memory-mapped and decoded, in parallel with
+ * any others, when a query first needs it, and PurchaseHistory objects are only built from views on request. A
+ * history.dat or history.csv from older versions is read once and replaced by segments, with history.csv cut into
+ * chunks that are parsed in parallel. Histories older than the retention period of two years are folded into
+ * daily totals per product and per member kept in history.rollup, so memory and disk use stop growing while
+ * long-range sales totals can still be asked for. Recent sales per product and category are also
+ * kept as hourly and daily counters, so reports do not scan the histories, and products bought together are counted
+ * for "frequently bought together" suggestions, from the segment files on a background thread so no shopper waits
+ * for every segment to be read.
+ *
+ * Each history carries the sequence number of the checkout that made it, on its H line and in the segments, and a
+ * history is only recognised as seen before by that number. Every fresh log starts with an S line holding the
+ * highest checkout number added so far, so the number survives compaction, deletion and the rollups; the checkout
+ * journal skips every checkout up to it when it is replayed. Tombstones name the checkout of the deleted history.
  * \author Michael Schmittat
  */
 
 #include "PurchaseHistoryCollection.h"
-#include <cmath>
+#include "TaskPool.h"
+#include "MappedFile.h"
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits>
+#include <cstring>
+#include <memory>
+#include <algorithm>
 
-/** Reads database file into the application. Constructor that opens the collection database file. Reads
- * orders, and creates a purchase history for orders associated with a particular member.
+constexpr auto LEGACY_SNAPSHOT = "history.dat";	// Single snapshot used before segments
+constexpr auto LEGACY_FILE = "history.csv";		// Text format used before history.dat
+constexpr auto ACTIVE_LOG = "history.log";		// Checkouts since the last compaction
+constexpr auto SEALED_LOG = "history.log.1";	// Log being folded into the segments
+constexpr auto ROLLUP_FILE = "history.rollup";	// Daily totals of histories past the retention period
+constexpr int COMPACT_MIN_RECORDS = 64;
+constexpr size_t PURGE_SHARE = 8;	// Deleted records are purged once they are one in this many
+constexpr int RETENTION_DAYS = 730;	// Days histories are kept in full
+constexpr time_t EARLIEST = std::numeric_limits<time_t>::min();
+constexpr time_t LATEST = std::numeric_limits<time_t>::max();
+static const char ROLLUP_MAGIC[4] = {'V', 'M', 'H', 'R'};
+
+/** Reads database file into the application. Constructor that reads the segment footers and rollups and replays
+ * the history log, then rolls up histories past the retention period. If the log ends
+ * in a torn record, a compaction was interrupted, histories were rolled up or they came from an older file format,
+ * the collection is checkpointed straight away.
  * @return None.
  */
 PurchaseHistoryCollection::PurchaseHistoryCollection() {
+	logRecords = 0;
+	snapshotRecords = 0;
+	salesCounted = false;
+	coPurchasesBuilt = false;
+	coPurchasesRequested = false;
+	pairsReady = false;
+	lastCheckout = 0;
+	bool migrate = false;
+	readRollups();
+
+	// Only the segment footers are read, histories are loaded when a query or checkout needs their segment
+	if(segments.open() == 0)
+		migrate = readLegacy();
+
+	// A sealed segment is left behind only if the program stopped during a compaction
+	bool clean = true;
+	std::unordered_map<std::string, HistoryProduct> sealedProducts;
+	int sealed = readLog(SEALED_LOG, clean, sealedProducts);
+	int logged = readLog(ACTIVE_LOG, clean, logProducts);
+	logRecords = logged > 0 ? logged : 0;
+
+	logFd = open(ACTIVE_LOG, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if(logFd == -1)
+		std::cerr << "Could not open purchase history log " << ACTIVE_LOG << "\n";
+
+	bool rolled = applyRetention();
+	if((sealed >= 0 || !clean || migrate || rolled) && checkpoint() && migrate) {
+		unlink(LEGACY_SNAPSHOT);
+		unlink(LEGACY_FILE);
+	}
+}
+
+/** Reads purchase histories saved by older versions, from history.dat or else history.csv.
+ * @return True if an older file was found.
+ */
+bool PurchaseHistoryCollection::readLegacy() {
 	std::ifstream input;
-	input.open("history.csv");
+	input.open(LEGACY_SNAPSHOT, std::ios::binary);
+	if(input.is_open()) {
+		std::ostringstream contents;
+		contents << input.rdbuf();
+		HistoryStore legacy;
+		if(legacy.deserialize(contents.str())) {
+			for(uint32_t r = 0; r < legacy.records(); r++)
+				segments.markDirty(legacy.getDate(r));
+			store.merge(legacy);
+			return true;
+		}
+		std::cerr << LEGACY_SNAPSHOT << " is damaged, purchase histories in it were not loaded\n";
+		return false;
+	}
+
+	input.open(LEGACY_FILE);
+	if(!input.is_open())
+		return false;
+	std::ostringstream contents;
+	contents << input.rdbuf();
+	input.close();
+	std::string data = contents.str();
 	
-	std::string line, key;
 	// Skip first three csv lines
-	getline(input, line);
-	getline(input, line);
-	getline(input, line);
-	
-	while(getline(input, line)) {
+	size_t start = 0;
+	for(int i = 0; i < 3 && start < data.size(); i++) {
+		start = data.find('\n', start);
+		start = start == std::string::npos ? data.size() : start + 1;
+	}
+
+	// Each H line gives the number of lines after it, so the file can be cut at any line starting with "H,"
+	size_t chunkCount = TaskPool::workers();
+	std::vector<size_t> bounds(1, start);
+	for(size_t c = 1; c < chunkCount; c++) {
+		size_t target = start + (data.size() - start) * c / chunkCount;
+		size_t split = data.find("\nH,", target > bounds.back() ? target : bounds.back());
+		if(split == std::string::npos)
+			break;
+		bounds.push_back(split + 1);
+	}
+	bounds.push_back(data.size());
+
+	std::vector<HistoryStore> parsed(bounds.size() - 1);
+	std::vector<int> results(parsed.size());
+	TaskPool::run(parsed.size(), [&](size_t c) {
+		std::istringstream chunk(data.substr(bounds[c], bounds[c + 1] - bounds[c]));
+		std::unordered_map<std::string, HistoryProduct> products;
+		PurchaseHistory ph;
+		uint64_t checkout;
+		while((results[c] = readHistory(chunk, ph, checkout, products)) == 1)
+			parsed[c].add(ph, checkout);
+	});
+
+	for(size_t c = 0; c < parsed.size(); c++) {
+		for(uint32_t r = 0; r < parsed[c].records(); r++)
+			segments.markDirty(parsed[c].getDate(r));
+		store.merge(parsed[c]);
+		parsed[c] = HistoryStore();
+		if(results[c] == -1) {
+			std::cerr << LEGACY_FILE << " has an unreadable record, histories after it were not loaded\n";
+			break;
+		}
+	}
+	return true;
+}
+
+/** Reads the daily totals of histories past the retention period.
+ * @return None.
+ */
+void PurchaseHistoryCollection::readRollups() {
+	MappedFile file(ROLLUP_FILE);
+	if(!file.isOpen())
+		return;
+
+	bool read = false;
+	if(file.size() >= sizeof(ROLLUP_MAGIC) && memcmp(file.data(), ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC)) == 0) {
+		BlockReader reader(file.data() + sizeof(ROLLUP_MAGIC), file.size() - sizeof(ROLLUP_MAGIC));
+		read = rollups.decode(reader);
+	}
+	if(!read)
+		std::cerr << ROLLUP_FILE << " is damaged, sales totals before the retention period were not loaded\n";
+}
+
+/** Writes the daily totals of histories past the retention period.
+ * @return True if the rollups were written.
+ */
+bool PurchaseHistoryCollection::saveRollups() {
+	SegmentFile file;
+	file.name = ROLLUP_FILE;
+	file.contents.assign(ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC));
+	BlockWriter writer(file.contents);
+	rollups.encode(writer);
+	writer.finish();
+
+	if(!HistorySegments::writeFiles(std::vector<SegmentFile>(1, file))) {
+		std::cerr << "Could not write " << ROLLUP_FILE << "\n";
+		return false;
+	}
+	return true;
+}
+
+/** Adds the order lines of histories older than the retention period to the daily rollups and drops the histories.
+ * The rollups are written before the segments, so a history that is still in a segment or log after a crash is
+ * recognised as rolled up by its date and dropped without being counted twice. Changed segments still need to be
+ * written.
+ * @return True if any histories were dropped.
+ */
+bool PurchaseHistoryCollection::applyRetention() {
+	time_t limit = rollups.getHorizon();
+	time_t cutoff = HistoryRollups::dayStart(HistoryRollups::dayOf(time(NULL)) - RETENTION_DAYS);
+	if(cutoff > limit)
+		limit = cutoff;
+
+	segments.loadRange(store, EARLIEST, limit - 1);
+	const std::vector<uint32_t> &records = store.byDate();
+	std::vector<uint32_t>::const_iterator end = store.lowerBound(records, limit);
+	if(end == records.begin())
+		return false;
+
+	const std::vector<uint32_t> &products = store.productColumn();
+	for(std::vector<uint32_t>::const_iterator r = records.begin(); r != end; r++) {
+		segments.markDirty(store.getDate(*r));
+		if(store.getDate(*r) < rollups.getHorizon() || store.isDeleted(*r))
+			continue;
+		for(uint32_t l = store.firstLine(*r); l < store.endLine(*r); l++)
+			rollups.add(store.getDate(*r), store.getMemberID(*r), store.getProduct(products[l]).id, store.quantityColumn()[l], store.costColumn()[l]);
+	}
+	rollups.setHorizon(limit);
+	if(!saveRollups())
+		return false;
+
+	store.eraseBefore(limit);
+	return true;
+}
+
+/** Gets the daily totals of histories past the retention period.
+ * @return Reference to the rollups.
+ */
+const HistoryRollups &PurchaseHistoryCollection::getRollups() const {
+	return rollups;
+}
+
+/** Adds up the sales of a product between two dates, from the rollups before the horizon and the histories after.
+ * Days that have been rolled up are counted whole.
+ * @param productID Unique ID of the product.
+ * @param from Earliest date counted.
+ * @param to Latest date counted.
+ * @return Units sold and revenue taken.
+ */
+SalesTotals PurchaseHistoryCollection::getProductSales(const std::string &productID, time_t from, time_t to) {
+	SalesTotals totals = {0, 0};
+	time_t horizon = rollups.getHorizon();
+	if(from < horizon)
+		totals = rollups.productTotals(productID, from, to < horizon ? to : horizon - 1);
+	if(to < horizon)
+		return totals;
+
+	from = from > horizon ? from : horizon;
+	segments.loadRange(store, from, to);
+	const std::vector<uint32_t> &records = store.byDate();
+	const std::vector<uint32_t> &products = store.productColumn();
+	for(std::vector<uint32_t>::const_iterator r = store.lowerBound(records, from); r != store.upperBound(records, to); r++) {
+		if(store.isDeleted(*r))
+			continue;
+		for(uint32_t l = store.firstLine(*r); l < store.endLine(*r); l++) {
+			if(store.getProduct(products[l]).id == productID) {
+				totals.units += store.quantityColumn()[l];
+				totals.revenue += store.costColumn()[l];
+			}
+		}
+	}
+	return totals;
+}
+
+/** Adds up the purchases of a member between two dates, from the rollups before the horizon and the histories
+ * after. Days that have been rolled up are counted whole.
+ * @param memberID Unique ID of the member.
+ * @param from Earliest date counted.
+ * @param to Latest date counted.
+ * @return Units bought and money spent.
+ */
+SalesTotals PurchaseHistoryCollection::getMemberSpending(int memberID, time_t from, time_t to) {
+	SalesTotals totals = {0, 0};
+	time_t horizon = rollups.getHorizon();
+	if(from < horizon)
+		totals = rollups.memberTotals(memberID, from, to < horizon ? to : horizon - 1);
+	if(to < horizon)
+		return totals;
+
+	from = from > horizon ? from : horizon;
+	segments.loadMember(store, memberID, from, to);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	for(std::vector<uint32_t>::const_iterator r = store.lowerBound(records, from); r != store.upperBound(records, to); r++) {
+		if(store.isDeleted(*r))
+			continue;
+		for(uint32_t l = store.firstLine(*r); l < store.endLine(*r); l++) {
+			totals.units += store.quantityColumn()[l];
+			totals.revenue += store.costColumn()[l];
+		}
+	}
+	return totals;
+}
+
+/** Gets the hourly and daily sales counters. The first call loads the segments they cover and counts their
+ * histories, later calls return the counters as they are.
+ * @return Reference to the counters.
+ */
+const SalesCounters &PurchaseHistoryCollection::getSalesCounters() {
+	if(salesCounted)
+		return sales;
+
+	time_t from = SalesCounters::earliest(time(NULL));
+	segments.loadRange(store, from, LATEST);
+	const std::vector<uint32_t> &records = store.byDate();
+	for(std::vector<uint32_t>::const_iterator r = store.lowerBound(records, from); r != records.end(); r++) {
+		if(!store.isDeleted(*r))
+			countSales(*r, 1);
+	}
+	salesCounted = true;
+	return sales;
+}
+
+/** Adds a history's order lines to the sales counters, or takes them off.
+ * @param record Record number of the history in the store.
+ * @param sign 1 to add the sales, -1 to take them off.
+ * @return None.
+ */
+void PurchaseHistoryCollection::countSales(uint32_t record, int sign) {
+	time_t date = store.getDate(record);
+	for(uint32_t l = store.firstLine(record); l < store.endLine(record); l++) {
+		int32_t units = store.quantityColumn()[l];
+		double paid = store.costColumn()[l];
+		double discount = (double)store.priceColumn()[l] * units - paid;
+		sales.add(date, store.getProduct(store.productColumn()[l]), sign * units, sign * paid, sign * discount);
+	}
+}
+
+/** Gets the counts of products bought together. The first call compacts the log, so the segment files come to hold
+ * every history, and from then on histories changed are kept aside for the count. A later call starts counting the
+ * histories on a background thread once the compaction is done, and calls return no counts until they are ready,
+ * so the caller never waits for every segment to be read. Once the counts are ready they are taken over and kept up
+ * to date, and later calls return them as they are.
+ * @return Reference to the co-purchase matrix, empty until the counts are ready.
+ */
+const CoPurchaseMatrix &PurchaseHistoryCollection::getCoPurchases() {
+	if(coPurchasesBuilt)
+		return coPurchases;
+
+	if(!coPurchasesRequested) {
+		coPurchasesRequested = true;
+		compact();
+	}
+	else if(!pairBuilder.joinable())
+		buildCoPurchases();
+	else if(pairsReady)
+		adoptCoPurchases();
+	return coPurchases;
+}
+
+/** Takes over the counts once the background thread has finished, applying the histories added and deleted while
+ * the segment files were being read.
+ * @return None.
+ */
+void PurchaseHistoryCollection::adoptCoPurchases() {
+	pairBuilder.join();
+	coPurchases = std::move(builtPairs);
+	builtPairs.clear();
+	for(size_t i = 0; i < unwrittenBaskets.size(); i++) {
+		if(unwrittenBaskets[i].first)
+			coPurchases.addBasket(unwrittenBaskets[i].second);
+		else
+			coPurchases.removeBasket(unwrittenBaskets[i].second);
+	}
+	unwrittenBaskets.clear();
+	unwrittenBaskets.shrink_to_fit();
+	coPurchasesBuilt = true;
+}
+
+/** Starts counting the products bought together in every segment file on a background thread. Each segment is
+ * mapped before the thread starts, so a compaction rewriting segments meanwhile does not change what is counted,
+ * and decoded into a store of its own that is dropped once its products are gathered, so the histories are never
+ * all in memory. Histories not yet written to a segment are tracked in unwrittenBaskets and applied when the
+ * counts are taken over. Nothing is started while a compaction is writing segments.
+ * @return None.
+ */
+void PurchaseHistoryCollection::buildCoPurchases() {
+	// The segment files only hold every written history once the sealed log is gone
+	if(access(SEALED_LOG, F_OK) == 0)
+		return;
+
+	std::vector<std::shared_ptr<MappedFile>> files;
+	std::vector<std::string> names = segments.fileNames();
+	for(size_t i = 0; i < names.size(); i++)
+		files.push_back(std::make_shared<MappedFile>(names[i]));
+
+	pairsReady = false;
+	pairBuilder = std::thread([this, files]() {
+		builtPairs.clear();
+		for(size_t i = 0; i < files.size(); i++) {
+			// A damaged segment is reported when a query loads it
+			HistoryStore segment;
+			if(HistorySegments::decodeFile(*files[i], segment))
+				builtPairs.gather(segment);
+		}
+		builtPairs.countGathered();
+		pairsReady = true;
+	});
+}
+
+/** Gets the distinct products of a history.
+ * @param record Record number of the history in the store.
+ * @return Unique IDs of the products, each once.
+ */
+std::vector<std::string> PurchaseHistoryCollection::basketOf(uint32_t record) const {
+	std::vector<std::string> basket;
+	for(uint32_t l = store.firstLine(record); l < store.endLine(record); l++)
+		basket.push_back(store.getProduct(store.productColumn()[l]).id);
+	std::sort(basket.begin(), basket.end());
+	basket.erase(std::unique(basket.begin(), basket.end()), basket.end());
+	return basket;
+}
+
+/** Adds a history that was just added to the store to the sales counters and co-purchase matrix, if they are built.
+ * A count finished on the background thread is taken over first. Until the matrix is built, once it has been
+ * requested, the history is kept aside for it.
+ * @param record Record number of the history in the store.
+ * @return None.
+ */
+void PurchaseHistoryCollection::countAdded(uint32_t record) {
+	if(salesCounted)
+		countSales(record, 1);
+	if(!coPurchasesBuilt && pairsReady)
+		adoptCoPurchases();
+	if(coPurchasesBuilt)
+		coPurchases.addBasket(store, record);
+	else if(coPurchasesRequested)
+		unwrittenBaskets.push_back(std::make_pair(true, basketOf(record)));
+}
+
+/** Takes a history that is about to be deleted off the sales counters and co-purchase matrix, if they are built.
+ * A count finished on the background thread is taken over first. Until the matrix is built, once it has been
+ * requested, the deletion is kept aside for it.
+ * @param record Record number of the history in the store.
+ * @return None.
+ */
+void PurchaseHistoryCollection::countRemoved(uint32_t record) {
+	if(salesCounted)
+		countSales(record, -1);
+	if(!coPurchasesBuilt && pairsReady)
+		adoptCoPurchases();
+	if(coPurchasesBuilt)
+		coPurchases.removeBasket(store, record);
+	else if(coPurchasesRequested)
+		unwrittenBaskets.push_back(std::make_pair(false, basketOf(record)));
+}
+
+/** Class destructor. Waits for a running compaction or co-purchase count to finish and closes the history log.
+ * @return None.
+ */
+PurchaseHistoryCollection::~PurchaseHistoryCollection() {
+	if(pairBuilder.joinable())
+		pairBuilder.join();
+	waitForCompaction();
+	if(logFd != -1)
+		close(logFd);
+}
+
+/** Reads one history record: an H line followed by an L line per order line, each of which may come after a D
+ * line for its product. Records written by older versions have an O and a P line per order instead, and no checkout
+ * number on the H line.
+ * @param input Stream positioned at the start of a record.
+ * @param history PurchaseHistory the record is read into.
+ * @param checkout Set to the sequence number of the checkout that made the history, 0 if it has none.
+ * @param products Products described by D lines so far in the stream, updated with the record's D lines.
+ * @return 1 if a record was read, 0 at the end of the stream, -1 if the record is malformed or cut short.
+ */
+int PurchaseHistoryCollection::readHistory(std::istream &input, PurchaseHistory &history, uint64_t &checkout, std::unordered_map<std::string, HistoryProduct> &products) {
+	std::string line, key;
+	if(!getline(input, line))
+		return 0;
+	if(line.compare(0, 2, "H,") != 0 || input.eof())
+		return -1;
+
+	try {
 		std::list<Order> ordList;
 		
 		std::istringstream iss(line);
@@ -34,26 +482,66 @@ PurchaseHistoryCollection::PurchaseHistoryCollection() {
 		getline(iss, key, ',');
 		int memberID = std::stoi(key);
 		getline(iss, key, ',');
-		double rawtime = std::stod(key);
+		time_t rawtime = (time_t)std::stoll(key);
 		getline(iss, key, ',');
 		int orders = std::stoi(key);	
+		checkout = getline(iss, key, ',') ? std::stoull(key) : 0;
 		
 		for(int c = 0; c < orders; c++) {
-			// New line
-			getline(input, line);
+			// New line, a last line without its newline was cut short by a crash
+			if(!getline(input, line) || input.eof())
+				return -1;
 			std::istringstream nestIss(line);
-			// Get constructor components for Order
 			getline(nestIss, key, ',');
+
+			if(key == "D") {
+				// Product details, in force for the rest of the stream
+				HistoryProduct details;
+				getline(nestIss, details.id, ',');
+				getline(nestIss, details.name, ',');
+				getline(nestIss, details.category, ',');
+				products[details.id] = details;
+				c--;
+				continue;
+			}
+
+			if(key == "L") {
+				// Order line referring to a product by ID
+				getline(nestIss, key, ',');
+				std::unordered_map<std::string, HistoryProduct>::const_iterator details = products.find(key);
+				if(details == products.end())
+					return -1;
+				getline(nestIss, key, ',');
+				int oQty = std::stoi(key);
+				getline(nestIss, key, ',');
+				float price = std::stof(key);
+				getline(nestIss, key, ',');
+				float rate = std::stof(key);
+				getline(nestIss, key, ',');
+				float tCost = std::stof(key);
+
+				Product product = Product(details->second.name, details->second.category, details->second.id, price, 0);
+				product.setPromotion(rate);
+				Order order = Order(product, 0, oQty);
+				order.changeTotalCost(tCost);
+				ordList.push_back(order);
+				continue;
+			}
+
+			if(key != "O")
+				return -1;
+			// Get constructor components for Order
 			getline(nestIss, key, ',');
 			int oQty = std::stoi(key);
 			getline(nestIss, key, ',');
-			//float tCost = std::stof(key);
+			float tCost = std::stof(key);
 			getline(nestIss, key, ',');
 			
 			// New line
-			getline(input, line);
+			if(!getline(input, line) || line.compare(0, 2, "P,") != 0 || input.eof())
+				return -1;
 			std::istringstream nestIss2(line);
-			// Create Product
+			// Create Product, the stock quantity it was saved with is not kept
 			Product product;
 			getline(nestIss2, key, ',');
 			getline(nestIss2, key, ',');
@@ -65,31 +553,197 @@ PurchaseHistoryCollection::PurchaseHistoryCollection() {
 	        getline(nestIss2, key, ',');
 	        product.setPrice(std::stof(key));
 	        getline(nestIss2, key, ',');
-			product.setQuantity(std::stoi(key));
 			getline(nestIss2, key, ',');
-			float disc = std::stof(key);
-			if(disc != 0) {
-				Discount d = Discount(product.getID(), disc, 1, 1, 100);
-				product.setDiscount(&d);
-			}
+			// History keeps only the rate the product sold at, which is carried as its promotion
+			product.setPromotion(std::stof(key));
 			// Create and push Order
 			Order order = Order(product, 0, oQty);
+			order.changeTotalCost(tCost);
 			ordList.push_back(order);
 		}
-		
-		// Add the completed PurchaseHistory to the map
-		PurchaseHistory ph = PurchaseHistory(ordList, memberID, rawtime);
-		//std::cout << ph.printHistory() << '\n';
-		addPurchaseHistory(ph);
+
+		history = PurchaseHistory(ordList, memberID, rawtime);
+		return 1;
 	}
-	
+	catch(const std::exception &) {
+		return -1;
+	}
+}
+
+/** Reads every record of a history log segment into the collection, applying tombstones as they come and raising
+ * the last checkout number to the highest one seen.
+ * @param fileName Path of the segment.
+ * @param clean Set to false if the segment ends in a torn or malformed record.
+ * @param products Set to the products described by D lines in the segment.
+ * @return Number of records read, or -1 if the segment does not exist.
+ */
+int PurchaseHistoryCollection::readLog(const std::string &fileName, bool &clean, std::unordered_map<std::string, HistoryProduct> &products) {
+	std::ifstream input;
+	input.open(fileName.c_str());
+	if(!input.is_open())
+		return -1;
+
+	int count = 0, result, memberID;
+	time_t date;
+	uint64_t checkout;
+	PurchaseHistory ph;
+	do {
+		if(input.peek() == 'S') {
+			// The watermark line is not a record
+			if((result = readWatermark(input, checkout)) == 1 && checkout > lastCheckout)
+				lastCheckout = checkout;
+			continue;
+		}
+		if(input.peek() == 'X') {
+			if((result = readTombstone(input, memberID, date, checkout)) == 1)
+				removeHistory(memberID, date, checkout);
+		}
+		else if((result = readHistory(input, ph, checkout, products)) == 1) {
+			insertHistory(ph, checkout);
+			if(checkout > lastCheckout)
+				lastCheckout = checkout;
+		}
+		if(result == 1)
+			count++;
+	} while(result == 1);
+	if(result == -1)
+		clean = false;
 	input.close();
+	return count;
 }
 
-/** Class destructor.
- * @return None.
+/** Builds the PurchaseHistory objects for a range of histories.
+ * @param range Histories to copy.
+ * @return A vector of the purchase histories, in date order.
+ */
+std::vector<PurchaseHistory> PurchaseHistoryCollection::collect(const HistoryRange &range) {
+	std::vector<PurchaseHistory> histList;
+	histList.reserve(range.size());
+	for(HistoryRange::iterator i = range.begin(); i != range.end(); ++i)
+		histList.push_back((*i).materialize());
+	
+	return histList;
+}
+
+/** Views a single purchase history for a particular member without copying it.
+ * @param memberID Unique member ID of the member.
+ * @param date Timestamp of the purchase history
+ * @return A view of the purchase history, null if there is none.
+ */
+HistoryView PurchaseHistoryCollection::viewPurchaseHistory(int memberID, time_t date) {
+	segments.loadBucket(store, date);
+	int record = store.find(memberID, date);
+	if(record != -1)
+		return HistoryView(&store, record);
+	
+	return HistoryView();
+}
+
+/** Views every purchase history in the collection without copying them.
+ * @return A range over all purchase histories, in date order.
+ */
+HistoryRange PurchaseHistoryCollection::viewAllHistories() {
+	segments.loadRange(store, EARLIEST, LATEST);
+	const std::vector<uint32_t> &records = store.byDate();
+	return HistoryRange(&store, records.begin(), records.end());
+}
+
+/** Views the purchase histories of a member without copying them.
+ * @param memberID The unique member ID of the member.
+ * @return A range over the member's purchase histories, in date order.
+ */
+HistoryRange PurchaseHistoryCollection::viewHistoriesByID(int memberID) {
+	segments.loadMember(store, memberID, EARLIEST, LATEST);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	return HistoryRange(&store, records.begin(), records.end());
+}
+
+/** Views the purchase histories of a member from before a date without copying them.
+ * @param memberID Unique member ID of member to search through purchase histories.
+ * @param date Reference date to check purchase histories before.
+ * @return A range over the member's purchase histories before the date.
+ */
+HistoryRange PurchaseHistoryCollection::viewMemberHistoriesBefore(int memberID, time_t date) {
+	segments.loadMember(store, memberID, EARLIEST, date);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	return HistoryRange(&store, records.begin(), store.lowerBound(records, date));
+}
+
+/** Views the purchase histories of a member from after a date without copying them.
+ * @param memberID Unique member ID of member to search through purchase histories.
+ * @param date Reference date to check purchase histories after.
+ * @return A range over the member's purchase histories after the date.
+ */
+HistoryRange PurchaseHistoryCollection::viewMemberHistoriesAfter(int memberID, time_t date) {
+	segments.loadMember(store, memberID, date, LATEST);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	return HistoryRange(&store, store.upperBound(records, date), records.end());
+}
+
+/** Views the purchase histories of a member within 24 hours either side of a date without copying them.
+ * @param memberID Unique member ID of member to search through purchase histories.
+ * @param date Reference date.
+ * @return A range over the member's purchase histories within 86,400 seconds of the date.
+ */
+HistoryRange PurchaseHistoryCollection::viewMemberHistoriesWithinDay(int memberID, time_t date) {
+	segments.loadMember(store, memberID, date - 86400, date + 86400);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	return HistoryRange(&store, store.lowerBound(records, date - 86400), store.upperBound(records, date + 86400));
+}
+
+/** Views the purchase histories of every member from before a date without copying them.
+ * @param date Reference date to check purchase histories before.
+ * @return A range over the purchase histories before the date.
  */
-PurchaseHistoryCollection::~PurchaseHistoryCollection() {}
+HistoryRange PurchaseHistoryCollection::viewAllHistoriesBefore(time_t date) {
+	segments.loadRange(store, EARLIEST, date);
+	const std::vector<uint32_t> &records = store.byDate();
+	return HistoryRange(&store, records.begin(), store.lowerBound(records, date));
+}
+
+/** Views the purchase histories of every member from after a date without copying them.
+ * @param date Reference date to check purchase histories after.
+ * @return A range over the purchase histories after the date.
+ */
+HistoryRange PurchaseHistoryCollection::viewAllHistoriesAfter(time_t date) {
+	segments.loadRange(store, date, LATEST);
+	const std::vector<uint32_t> &records = store.byDate();
+	return HistoryRange(&store, store.upperBound(records, date), records.end());
+}
+
+/** Views the purchase histories of every member within 24 hours either side of a date without copying them.
+ * @param date Reference date.
+ * @return A range over the purchase histories within 86,400 seconds of the date.
+ */
+HistoryRange PurchaseHistoryCollection::viewAllHistoriesWithinDay(time_t date) {
+	segments.loadRange(store, date - 86400, date + 86400);
+	const std::vector<uint32_t> &records = store.byDate();
+	return HistoryRange(&store, store.lowerBound(records, date - 86400), store.upperBound(records, date + 86400));
+}
+
+/** Views the purchase histories that include a product without copying them. Only segments whose bloom filter
+ * may hold the product are loaded.
+ * @param productID Unique ID of the product.
+ * @return Views of the purchase histories, in date order.
+ */
+std::vector<HistoryView> PurchaseHistoryCollection::viewProductHistories(const std::string &productID) {
+	segments.loadProduct(store, productID);
+	std::vector<HistoryView> views;
+
+	const std::vector<uint32_t> &records = store.byDate();
+	const std::vector<uint32_t> &products = store.productColumn();
+	for(std::vector<uint32_t>::const_iterator r = records.begin(); r != records.end(); r++) {
+		if(store.isDeleted(*r))
+			continue;
+		for(uint32_t l = store.firstLine(*r); l < store.endLine(*r); l++) {
+			if(store.getProduct(products[l]).id == productID) {
+				views.push_back(HistoryView(&store, *r));
+				break;
+			}
+		}
+	}
+	return views;
+}
 
 /** Gets a single PurchaseHistory for a particular member.
  * @param memberID Unique member ID of the member.
@@ -97,14 +751,9 @@ PurchaseHistoryCollection::~PurchaseHistoryCollection() {}
  * @return A PurchaseHistory for the specified member.
  */
 PurchaseHistory PurchaseHistoryCollection::getPurchaseHistory(int memberID, time_t date) {
-	if(historyCollection.find(memberID) != historyCollection.end()) {
-		std::vector<PurchaseHistory> histories = historyCollection.at(memberID);
-		
-		for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-			if(i->getRawTime() == date)
-				return *i;
-		}	
-	}
+	HistoryView view = viewPurchaseHistory(memberID, date);
+	if(!view.isNull())
+		return view.materialize();
 	
 	return PurchaseHistory();
 }
@@ -115,10 +764,7 @@ PurchaseHistory PurchaseHistoryCollection::getPurchaseHistory(int memberID, time
  * @return A vector of purchase histories associated with the member.
  */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getHistoriesByID(int memberID) {
-	if(historyCollection.find(memberID) != historyCollection.end())
-		return historyCollection.at(memberID);
-	
-	return std::vector<PurchaseHistory>();
+	return collect(viewHistoriesByID(memberID));
 }
 
 /** @brief Gets purchase history before a particuular date.
@@ -129,18 +775,7 @@ std::vector<PurchaseHistory> PurchaseHistoryCollection::getHistoriesByID(int mem
  * @return A vector of purchase histories associated with the member before the specified date.
  */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getMemberHistoriesBefore(int memberID, time_t date) {
-	if(historyCollection.find(memberID) == historyCollection.end())
-		return std::vector<PurchaseHistory>();
-		
-	std::vector<PurchaseHistory> histories = historyCollection.at(memberID);
-	std::vector<PurchaseHistory> histList;
-	
-	for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-		if(difftime(i->getRawTime(), date) < 0)
-			histList.push_back(*i);	
-	}
-	
-	return histList;
+	return collect(viewMemberHistoriesBefore(memberID, date));
 }
 
 /** @brief Gets purchase history after a particular date.
@@ -151,40 +786,17 @@ std::vector<PurchaseHistory> PurchaseHistoryCollection::getMemberHistoriesBefore
  * @return A vector of purchase histories associated with the member after the specified date.
  */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getMemberHistoriesAfter(int memberID, time_t date) {
-	if(historyCollection.find(memberID) == historyCollection.end())
-		return std::vector<PurchaseHistory>();
-		
-	std::vector<PurchaseHistory> histories = historyCollection.at(memberID);
-	std::vector<PurchaseHistory> histList;
-	
-	for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-		if(difftime(i->getRawTime(), date) > 0)
-			histList.push_back(*i);	
-	}
-	
-	return histList;
+	return collect(viewMemberHistoriesAfter(memberID, date));
 }
 
 /** @brief Gets purchase history within a 24-hour span.
- * @details Given a unique member ID and a date, get the purchase history of this particular member over the past 24 hours.
+ * @details Given a unique member ID and a date, get the purchase history of this particular member within 24 hours either side of the date.
  * @param memberID Unique member ID of member to search through purchase histories.
- * @param date Reference date to check purchase histories before.
- * @return A vector of purchase histories associated with the member within the past 24 hours.
+ * @param date Reference date.
+ * @return A vector of purchase histories associated with the member within 24 hours of the date.
  */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getMemberHistoriesWithinDay(int memberID, time_t date) {
-	if(historyCollection.find(memberID) == historyCollection.end())
-		return std::vector<PurchaseHistory>();
-		
-	std::vector<PurchaseHistory> histories = historyCollection.at(memberID);
-	std::vector<PurchaseHistory> histList;
-	
-	for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-		// Check the difference in seconds, push anything within 86,400 seconds (24 hours)
-		if(std::abs(difftime(i->getRawTime(), date)) <= 86400)
-			histList.push_back(*i);	
-	}
-	
-	return histList;
+	return collect(viewMemberHistoriesWithinDay(memberID, date));
 }
 
 /** @brief Gets all purchase histories before a particular date.
@@ -193,18 +805,7 @@ std::vector<PurchaseHistory> PurchaseHistoryCollection::getMemberHistoriesWithin
  * @return A vector of purchase histories from the database created before given date.
  */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getAllHistoriesBefore(time_t date) {
-	std::vector<PurchaseHistory> histList;
-	for(std::unordered_map<int, std::vector<PurchaseHistory>>::iterator it = historyCollection.begin(); it != historyCollection.end(); it++) {
-	
-		std::vector<PurchaseHistory> histories = it->second;
-	
-		for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-			if(difftime(i->getRawTime(), date) < 0)
-				histList.push_back(*i);
-		}	
-	}
-	
-	return histList;
+	return collect(viewAllHistoriesBefore(date));
 }
 
 /**
@@ -213,18 +814,7 @@ std::vector<PurchaseHistory> PurchaseHistoryCollection::getAllHistoriesBefore(ti
 * @return vector<PurchaseHistory> All PurchaseHistory objects that occur after date.
 */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getAllHistoriesAfter(time_t date) {
-	std::vector<PurchaseHistory> histList;
-	for(std::unordered_map<int, std::vector<PurchaseHistory>>::iterator it = historyCollection.begin(); it != historyCollection.end(); it++) {
-	
-		std::vector<PurchaseHistory> histories = it->second;
-	
-		for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-			if(difftime(i->getRawTime(), date) > 0)
-				histList.push_back(*i);
-		}	
-	}
-	
-	return histList;
+	return collect(viewAllHistoriesAfter(date));
 }
 
 /**
@@ -233,139 +823,397 @@ std::vector<PurchaseHistory> PurchaseHistoryCollection::getAllHistoriesAfter(tim
 * @return vector<PurchaseHistory> All PurchaseHistory objects that occur within 24 hours of date.
 */
 std::vector<PurchaseHistory> PurchaseHistoryCollection::getAllHistoriesWithinDay(time_t date) {
-	std::vector<PurchaseHistory> histList;
-	for(std::unordered_map<int, std::vector<PurchaseHistory>>::iterator it = historyCollection.begin(); it != historyCollection.end(); it++) {
-	
-		std::vector<PurchaseHistory> histories = it->second;
-	
-		for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-			// Check the difference in seconds, push anything within 86,400 seconds (24 hours)
-			if(std::abs(difftime(i->getRawTime(), date)) <= 86400)
-				histList.push_back(*i);
-		}
-	}
-	
-	return histList;
+	return collect(viewAllHistoriesWithinDay(date));
+}
+
+/**
+* Gets the columnar store the loaded histories are held in, for scans over every order line. Use viewAllHistories()
+* first to scan every segment rather than just the recent ones.
+* @return Reference to the store.
+*/
+const HistoryStore &PurchaseHistoryCollection::getStore() const {
+	return store;
 }
 
 /**
-* Adds a PurchaseHistory object to the collection.
+* Adds a PurchaseHistory object to the collection without logging it, loading the segment it belongs in first so a
+* history seen twice (e.g. in a segment and the sealed log) is recognised by its checkout number and skipped. An
+* added history is counted towards the sales counters and co-purchase matrix.
 * @param history PurchaseHistory object to be added.
+* @param checkout Sequence number of the checkout that made the history, 0 if it has none.
+* @return True if the history was added, false if it was already in the collection.
+*/
+bool PurchaseHistoryCollection::insertHistory(PurchaseHistory &history, uint64_t checkout) {
+	segments.loadBucket(store, history.getRawTime());
+	if(!store.add(history, checkout))
+		return false;
+
+	segments.markDirty(history.getRawTime());
+	// The store adds new records at the end
+	countAdded(store.records() - 1);
+	return true;
+}
+
+/**
+* Adds a PurchaseHistory object to the collection and appends it to the history log. Once the log holds as many
+* records as the segments last written, the log is compacted into the segments in the background. A history already
+* in the collection is skipped, and one from before the retention horizon is only added to the rollups.
+* @param history PurchaseHistory object to be added.
+* @param checkout Sequence number of the checkout that made the history.
 * @return None.
 */
-void PurchaseHistoryCollection::addPurchaseHistory(PurchaseHistory history) {
-	int memberID = history.getMemberID();
-	
-	// If empty, initialize new vector and place inside collection
-	if(historyCollection.find(memberID) == historyCollection.end()) {
-		std::vector<PurchaseHistory> histList (1, history);
-		//historyCollection.insert(std::make_pair<int, std::vector<PurchaseHistory>>(memberID, histList));
-		historyCollection.emplace(memberID, histList);
+void PurchaseHistoryCollection::addPurchaseHistory(PurchaseHistory history, uint64_t checkout) {
+	if(checkout > lastCheckout)
+		lastCheckout = checkout;
+
+	// A history from before the horizon only adds to the rollups, and only its checkout number goes in the log
+	if(history.getRawTime() < rollups.getHorizon()) {
+		for(std::list<Order>::iterator i = history.begin(); i != history.end(); i++)
+			rollups.add(history.getRawTime(), history.getMemberID(), i->getProduct().getID(), i->getQuantity(), i->getTotalCost());
+		if(saveRollups())
+			appendToLog(watermark());
+		return;
 	}
-	else {
-		// Just add history to existing list
-		historyCollection.at(memberID).push_back(history);
+
+	if(!insertHistory(history, checkout))
+		return;
+
+	std::ostringstream record;
+	std::unordered_map<std::string, HistoryProduct> described;
+	writeHistory(record, history, checkout, logProducts, described);
+	if(appendToLog(record.str())) {
+		// Later records can leave out the products this one described
+		for(std::unordered_map<std::string, HistoryProduct>::iterator i = described.begin(); i != described.end(); i++)
+			logProducts[i->first] = i->second;
 	}
+	logged(1);
 }
 
 /**
-* Removes a single PurchaseHistory object from the collection. 
+* Marks a PurchaseHistory as deleted without logging it, loading the segment it is in first.
+* @param memberID int ID that specifies the member the PurchaseHistory belongs to.
+* @param date time_t raw time in seconds that specifies when PurchaseHistory occured.
+* @param checkout Sequence number of the checkout that made the history, 0 to take the member's history at the date.
+* @return Record number of the history, -1 if it could not be found.
+*/
+int PurchaseHistoryCollection::removeHistory(int memberID, time_t date, uint64_t checkout) {
+	segments.loadBucket(store, date);
+	int record = checkout != 0 ? store.findCheckout(checkout) : store.find(memberID, date);
+	if(record == -1 || store.isDeleted(record))
+		return -1;
+
+	countRemoved(record);
+	store.markDeleted(record);
+	segments.markDirty(date);
+	return record;
+}
+
+/**
+* Removes a single PurchaseHistory object from the collection. The history is only marked as deleted and a
+* tombstone appended to the history log; its space is reclaimed when the log is next compacted.
 * @param memberID int ID that specifies the member the PurchaseHistory belongs to.
 * @param date time_t raw time in seconds that specifies when PurchaseHistory occured.
 * @return 0 if deletion was succesful, -1 if PurchaseHistory could not be found.
 */
 int PurchaseHistoryCollection::deletePurchaseHistory(int memberID, time_t date) {
-	if(historyCollection.find(memberID) != historyCollection.end()) {
-		std::vector<PurchaseHistory> histories = historyCollection.at(memberID);
-		
-		for(std::vector<PurchaseHistory>::iterator i = histories.begin(); i != histories.end(); i++) {
-			if(i->getRawTime() == date) {
-				histories.erase(i, i);
-				return 0;
-			}
-		}
-	}
+	int record = removeHistory(memberID, date, 0);
+	if(record == -1)
+		return -1;
 	
-	return -1;
+	std::ostringstream tombstone;
+	writeTombstone(tombstone, memberID, date, store.getCheckout(record));
+	appendToLog(tombstone.str());
+	logged(1);
+	return 0;
 }
 
 /**
-* Removes all PurchaseHistory objects associaed with a Member from the collection. 
+* Removes all PurchaseHistory objects associaed with a Member from the collection, along with the member's rollups.
+* The histories are marked as deleted and their tombstones appended to the history log in a single write.
 * @param memberID int ID that specifies the member the PurchaseHistory objects belong to.
 * @return 0 if deletion was succesful, -1 if no PurchaseHistory could not be found.
 */
 int PurchaseHistoryCollection::deleteAllHistoriesByMember(int memberID) {
-	if(historyCollection.find(memberID) != historyCollection.end()) {
-		historyCollection.erase(memberID);
-		return 0;
-	}	
+	// Rolled up histories only count as the member's if their daily totals are there
+	bool rolled = rollups.eraseMember(memberID);
+	if(rolled)
+		saveRollups();
+
+	segments.loadMember(store, memberID, EARLIEST, LATEST);
+	const std::vector<uint32_t> &records = store.recordsOf(memberID);
+	std::ostringstream tombstones;
+	int count = 0;
+	for(std::vector<uint32_t>::const_iterator i = records.begin(); i != records.end(); i++) {
+		if(store.isDeleted(*i))
+			continue;
+		countRemoved(*i);
+		store.markDeleted(*i);
+		segments.markDirty(store.getDate(*i));
+		writeTombstone(tombstones, memberID, store.getDate(*i), store.getCheckout(*i));
+		count++;
+	}
+	if(count == 0)
+		return rolled ? 0 : -1;
 	
-	return -1;
+	appendToLog(tombstones.str());
+	logged(count);
+	return 0;
 }
 
 /**
-* Saves all PurchaseHistory objects in the collection to file in .csv format.
+* Writes a tombstone: an X line with the member, date and checkout number of a deleted history.
+* @param out Stream to write to.
+* @param memberID Unique ID of the member.
+* @param date Date of the history.
+* @param checkout Sequence number of the checkout that made the history, 0 if it has none.
 * @return None.
 */
-void PurchaseHistoryCollection::saveToDatabase() {
-	// Clears csv file
-	std::ofstream ofs;
-	ofs.open("history.csv", std::ofstream::out | std::ofstream::trunc);
-	ofs.close();
-	
-	// Begin writing to csv
-	std::ofstream file;
-	file.open("history.csv");
-	// Column line
-	file << "History,mID,rawtime,length\n";
-	file << "Order,quantity,totalcost,dateofpurchase\n";
-	file << "Product,pID,name,category,price,quantity,Discount\n";
-	
-	// Start the looping - First iterate through the map - get every pair<int memberID, vector<PurchaseHistory>>
-	for(auto colIt = historyCollection.begin(); colIt != historyCollection.end(); colIt++) {
-		
-		// Iterate through the vector<PurchaseHistory> for each PurchaseHistory
-		for(auto vectIt = colIt->second.begin(); vectIt != colIt->second.end(); vectIt++) {
-			file << "H," << colIt->first << "," << vectIt->getRawTime() << "," << vectIt->length() << "\n";
-			
-			// Iterate through the PurchaseHistory for each Order
-			for(auto phIt = vectIt->begin(); phIt != vectIt->end(); phIt++) {
-				// Order line
-				file << "O," << phIt->getQuantity() << "," << phIt->getTotalCost() << ",0\n";
-				// Product line
-				Product temP = phIt->getProduct();
-				float dAmt = 0.0;
-				if(temP.getDiscount() != NULL)
-					dAmt = temP.getDiscount()->getAmount();
-				file << "P," << temP.getID() << "," << temP.getName() << "," << temP.getCategory() << "," << temP.getPrice() << "," << temP.getQuantity() << "," << dAmt << "\n";
-			}
-		}
-	}
-	
-	file.close();
+void PurchaseHistoryCollection::writeTombstone(std::ostream &out, int memberID, time_t date, uint64_t checkout) {
+	out << "X," << memberID << "," << date << "," << checkout << "\n";
 }
 
+/**
+* Reads a tombstone written by writeTombstone(). Tombstones written by older versions have no checkout number.
+* @param input Stream positioned at the start of an X line.
+* @param memberID Set to the member of the deleted history.
+* @param date Set to the date of the deleted history.
+* @param checkout Set to the checkout number of the deleted history, 0 if the tombstone has none.
+* @return 1 if a tombstone was read, 0 at the end of the stream, -1 if the line is malformed or cut short.
+*/
+int PurchaseHistoryCollection::readTombstone(std::istream &input, int &memberID, time_t &date, uint64_t &checkout) {
+	std::string line, key;
+	if(!getline(input, line))
+		return 0;
+	if(line.compare(0, 2, "X,") != 0 || input.eof())
+		return -1;
 
+	try {
+		std::istringstream iss(line);
+		getline(iss, key, ',');
+		getline(iss, key, ',');
+		memberID = std::stoi(key);
+		getline(iss, key, ',');
+		date = (time_t)std::stoll(key);
+		checkout = getline(iss, key, ',') ? std::stoull(key) : 0;
+		return 1;
+	}
+	catch(const std::exception &) {
+		return -1;
+	}
+}
 
+/**
+* Gets the watermark line every fresh log starts with: an S line with the highest checkout number added so far.
+* @return The S line.
+*/
+std::string PurchaseHistoryCollection::watermark() const {
+	return "S," + std::to_string(lastCheckout) + "\n";
+}
 
+/**
+* Reads a watermark line written by watermark().
+* @param input Stream positioned at the start of an S line.
+* @param checkout Set to the checkout number on the line.
+* @return 1 if the line was read, 0 at the end of the stream, -1 if the line is malformed or cut short.
+*/
+int PurchaseHistoryCollection::readWatermark(std::istream &input, uint64_t &checkout) {
+	std::string line;
+	if(!getline(input, line))
+		return 0;
+	if(line.compare(0, 2, "S,") != 0 || input.eof())
+		return -1;
 
+	try {
+		checkout = std::stoull(line.substr(2));
+		return 1;
+	}
+	catch(const std::exception &) {
+		return -1;
+	}
+}
 
+/**
+* Gets the highest checkout number added to the collection, whether the history is still held, deleted or rolled up.
+* @return Sequence number of the checkout, 0 if there has been none.
+*/
+uint64_t PurchaseHistoryCollection::getLastCheckout() const {
+	return lastCheckout;
+}
 
+/**
+* Writes one history record: an H line, then an L line for each order with the product ID, quantity, unit price,
+* discount rate and total cost. A product's name and category go in a D line in front of its first L line, and
+* again only if they change.
+* @param out Stream to write to.
+* @param history PurchaseHistory to write.
+* @param checkout Sequence number of the checkout that made the history.
+* @param known Products already described earlier in the stream.
+* @param described Products described by this record, filled in as D lines are written.
+* @return None.
+*/
+void PurchaseHistoryCollection::writeHistory(std::ostream &out, PurchaseHistory &history, uint64_t checkout, const std::unordered_map<std::string, HistoryProduct> &known, std::unordered_map<std::string, HistoryProduct> &described) {
+	out << "H," << history.getMemberID() << "," << history.getRawTime() << "," << history.length() << "," << checkout << "\n";
+	
+	// Iterate through the PurchaseHistory for each Order
+	for(auto phIt = history.begin(); phIt != history.end(); phIt++) {
+		const Product &temP = phIt->getProduct();
+		const HistoryProduct *details = NULL;
+		std::unordered_map<std::string, HistoryProduct>::const_iterator found = described.find(temP.getID());
+		if(found != described.end() || (found = known.find(temP.getID())) != known.end())
+			details = &found->second;
+		if(details == NULL || details->name != temP.getName() || details->category != temP.getCategory()) {
+			// Product line
+			HistoryProduct product = {temP.getID(), temP.getName(), temP.getCategory()};
+			described[product.id] = product;
+			out << "D," << product.id << "," << product.name << "," << product.category << "\n";
+		}
+		// Order line
+		out << "L," << temP.getID() << "," << phIt->getQuantity() << "," << temP.getPrice() << "," << temP.getDiscountRate() << "," << phIt->getTotalCost() << "\n";
+	}
+}
 
+/**
+* Appends records to the log with a single write and waits for them to reach the disk.
+* @param data Records to append.
+* @return True if the records were written.
+*/
+bool PurchaseHistoryCollection::appendToLog(const std::string &data) {
+	if(logFd == -1)
+		return false;
 
+	size_t written = 0;
+	while(written < data.size()) {
+		ssize_t n = write(logFd, data.data() + written, data.size() - written);
+		if(n <= 0) {
+			std::cerr << "Could not append to purchase history log\n";
+			return false;
+		}
+		written += n;
+	}
+	fsync(logFd);
+	return true;
+}
 
+/**
+* Counts records appended to the log. Once the log holds as many records as the segments last written, it is
+* compacted into the segments in the background.
+* @param records Number of records appended.
+* @return None.
+*/
+void PurchaseHistoryCollection::logged(int records) {
+	logRecords += records;
+	if(logRecords >= COMPACT_MIN_RECORDS && logRecords >= snapshotRecords)
+		compact();
+}
 
+/**
+* Writes every changed segment on the calling thread and replaces the log with one holding only the watermark,
+* dropping any sealed log left by an interrupted compaction. If a segment cannot be written, or a changed segment
+* could not be read and so was not rewritten, the log is kept as is.
+* @return True if the segments were written.
+*/
+bool PurchaseHistoryCollection::checkpoint() {
+	int records;
+	if(!HistorySegments::writeFiles(segments.flush(store, records))) {
+		std::cerr << "Could not write purchase history segments, purchase history stays in the log\n";
+		return false;
+	}
+	segments.synced();
+	// A matrix built from now on reads every history from the segments
+	if(!pairBuilder.joinable())
+		unwrittenBaskets.clear();
+	if(!segments.allFlushed()) {
+		snapshotRecords = logRecords * 2;
+		return false;
+	}
 
+	unlink(SEALED_LOG);
+	// The new log replaces the old one in a single rename, so the last checkout number is never lost
+	SegmentFile fresh;
+	fresh.name = ACTIVE_LOG;
+	fresh.contents = watermark();
+	if(HistorySegments::writeFiles(std::vector<SegmentFile>(1, fresh))) {
+		if(logFd != -1)
+			close(logFd);
+		logFd = open(ACTIVE_LOG, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	}
+	else
+		std::cerr << "Could not empty the purchase history log\n";
+	logRecords = 0;
+	logProducts.clear();
+	snapshotRecords = records;
+	return true;
+}
 
+/**
+* Folds the history log into the segments, first rolling up histories that have passed the retention period. The
+* active log is sealed and a fresh one started, then a background thread writes the changed segments and deletes
+* the sealed log. Until it finishes, the sealed log still holds the records, and a history found in both places is
+* only loaded once. Deleted histories are left out of the new segments, and are purged from memory once they make
+* up an eighth of the loaded histories. If a changed segment could not be read, the other segments are written in
+* the foreground and the log is kept, to be compacted again once it has doubled, as checkpoint() does.
+* @return None.
+*/
+void PurchaseHistoryCollection::compact() {
+	waitForCompaction();
+	applyRetention();
 
+	// A sealed log still here means the last background write failed, so write the segments in the foreground
+	if(access(SEALED_LOG, F_OK) == 0) {
+		checkpoint();
+		return;
+	}
 
+	int records;
+	std::vector<SegmentFile> files = segments.flush(store, records);
+	if(!segments.allFlushed()) {
+		if(HistorySegments::writeFiles(files)) {
+			segments.synced();
+			if(!pairBuilder.joinable())
+				unwrittenBaskets.clear();
+		}
+		snapshotRecords = logRecords * 2;
+		return;
+	}
+	if(!pairBuilder.joinable())
+		unwrittenBaskets.clear();
+	// The new segments leave deleted histories out, so they can go from memory too
+	if(store.deleted() * PURGE_SHARE > store.records())
+		store.purge();
+	if(logFd != -1)
+		close(logFd);
+	rename(ACTIVE_LOG, SEALED_LOG);
+	logFd = open(ACTIVE_LOG, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	appendToLog(watermark());
+	logRecords = 0;
+	logProducts.clear();
+	snapshotRecords = records;
 
+	compactor = std::thread([files]() {
+		if(HistorySegments::writeFiles(files))
+			unlink(SEALED_LOG);
+	});
+}
 
+/**
+* Waits for a background compaction to finish, if one is running.
+* @return None.
+*/
+void PurchaseHistoryCollection::waitForCompaction() {
+	if(!compactor.joinable())
+		return;
 
+	compactor.join();
+	// The sealed log is only deleted once every segment is on disk
+	if(access(SEALED_LOG, F_OK) != 0)
+		segments.synced();
+}
 
-
-
-
-
-
-
+/**
+* Saves all changed PurchaseHistory segments and empties the history log.
+* @return None.
+*/
+void PurchaseHistoryCollection::saveToDatabase() {
+	waitForCompaction();
+	checkpoint();
+}
@@ -2,14 +2,77 @@
 #define PURCHASE_HISTORY_COLLECTION_H
 
 #include <vector>
-#include <unordered_map>
 #include <ctime>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <unordered_map>
 #include "PurchaseHistory.h"
+#include "HistoryStore.h"
+#include "HistoryView.h"
+#include "HistorySegments.h"
+#include "HistoryRollups.h"
+#include "SalesCounters.h"
+#include "CoPurchaseMatrix.h"
 
 class PurchaseHistoryCollection
 {
 	private: 
-		std::unordered_map<int, std::vector<PurchaseHistory>> historyCollection;
+		HistoryStore store;
+		HistorySegments segments;
+		HistoryRollups rollups;
+		// Filled from the recent histories when first read, then kept up to date by every add and delete
+		SalesCounters sales;
+		bool salesCounted;
+		// Built from the segment files on a background thread when first read, then kept up to date like the sales counters
+		CoPurchaseMatrix coPurchases;
+		bool coPurchasesBuilt;
+		// Set by the first request for the matrix, from when histories changed are kept aside for it
+		bool coPurchasesRequested;
+		CoPurchaseMatrix builtPairs;
+		std::thread pairBuilder;
+		std::atomic<bool> pairsReady;
+		// Histories added (true) or deleted (false) since the segment files a matrix is built from were written, kept
+		// from the first request for the matrix until the count is taken over
+		std::vector<std::pair<bool, std::vector<std::string>>> unwrittenBaskets;
+		// Highest checkout number added, kept in the log so a journal replay skips checkouts already here
+		uint64_t lastCheckout;
+		int logFd;
+		int logRecords;
+		int snapshotRecords;
+		// Products described by D lines in the active log
+		std::unordered_map<std::string, HistoryProduct> logProducts;
+		std::thread compactor;
+
+		bool insertHistory(PurchaseHistory &history, uint64_t checkout);
+		bool readLegacy();
+		void readRollups();
+		bool saveRollups();
+		bool applyRetention();
+		static int readHistory(std::istream &input, PurchaseHistory &history, uint64_t &checkout, std::unordered_map<std::string, HistoryProduct> &products);
+		int readLog(const std::string &fileName, bool &clean, std::unordered_map<std::string, HistoryProduct> &products);
+		int removeHistory(int memberID, time_t date, uint64_t checkout);
+		void countSales(uint32_t record, int sign);
+		std::vector<std::string> basketOf(uint32_t record) const;
+		void buildCoPurchases();
+		void adoptCoPurchases();
+		void countAdded(uint32_t record);
+		void countRemoved(uint32_t record);
+		bool appendToLog(const std::string &data);
+		void logged(int records);
+		bool checkpoint();
+		std::string watermark() const;
+		static std::vector<PurchaseHistory> collect(const HistoryRange &range);
+		static void writeTombstone(std::ostream &out, int memberID, time_t date, uint64_t checkout);
+		static int readTombstone(std::istream &input, int &memberID, time_t &date, uint64_t &checkout);
+		static int readWatermark(std::istream &input, uint64_t &checkout);
+		static void writeHistory(std::ostream &out, PurchaseHistory &history, uint64_t checkout, const std::unordered_map<std::string, HistoryProduct> &known, std::unordered_map<std::string, HistoryProduct> &described);
+
+		PurchaseHistoryCollection(const PurchaseHistoryCollection &other);
+		PurchaseHistoryCollection &operator=(const PurchaseHistoryCollection &other);
 		
 	public:
 		PurchaseHistoryCollection();
@@ -24,10 +87,30 @@ class PurchaseHistoryCollection
 		std::vector<PurchaseHistory> getAllHistoriesAfter(time_t date);
 		std::vector<PurchaseHistory> getAllHistoriesWithinDay(time_t date);
 		
-		void addPurchaseHistory(PurchaseHistory history);
+		HistoryView viewPurchaseHistory(int memberID, time_t date);
+		HistoryRange viewAllHistories();
+		HistoryRange viewHistoriesByID(int memberID);
+		HistoryRange viewMemberHistoriesBefore(int memberID, time_t date);
+		HistoryRange viewMemberHistoriesAfter(int memberID, time_t date);
+		HistoryRange viewMemberHistoriesWithinDay(int memberID, time_t date);
+		HistoryRange viewAllHistoriesBefore(time_t date);
+		HistoryRange viewAllHistoriesAfter(time_t date);
+		HistoryRange viewAllHistoriesWithinDay(time_t date);
+		std::vector<HistoryView> viewProductHistories(const std::string &productID);
+		const HistoryStore &getStore() const;
+		const HistoryRollups &getRollups() const;
+		SalesTotals getProductSales(const std::string &productID, time_t from, time_t to);
+		SalesTotals getMemberSpending(int memberID, time_t from, time_t to);
+		const SalesCounters &getSalesCounters();
+		const CoPurchaseMatrix &getCoPurchases();
+		uint64_t getLastCheckout() const;
+
+		void addPurchaseHistory(PurchaseHistory history, uint64_t checkout);
 		int deletePurchaseHistory(int memberID, time_t date);
 		int deleteAllHistoriesByMember(int memberID);
 		
+		void compact();
+		void waitForCompaction();
 		void saveToDatabase();
 };
 
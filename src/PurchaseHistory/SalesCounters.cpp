@@ -0,0 +1,257 @@
+/** \file SalesCounters.h
+ * \brief Running sales counters per product and per category for reports.
+ * \details Each product and category has an hourly series covering the last two days and a daily series covering
+ * the last 90 days, counting units sold, revenue taken and discount given, which is the list price of the units less
+ * what was paid. A series is a ring of buckets, each tagged with its period: adding to a period whose slot still
+ * holds an older period resets the slot first, and a slot holding some other period counts as empty when read. So
+ * the counters never grow, and a total over a range of periods reads one bucket per period whatever the number of
+ * histories. Days are counted from midnight UTC, as in HistoryRollups.
+ */
+
+#include "SalesCounters.h"
+#include "HistoryRollups.h"
+#include <sstream>
+#include <iomanip>
+
+constexpr size_t HOURS_KEPT = 48;
+constexpr size_t DAYS_KEPT = 90;
+constexpr time_t HOUR_SECONDS = 3600;
+
+/** Class constructor.
+ * @param periods Number of periods kept.
+ * @return None.
+ */
+SalesSeries::SalesSeries(size_t periods) {
+	SalesBucket empty = {-1, 0, 0, 0};
+	ring.assign(periods, empty);
+}
+
+/** Adds sales to a period. Sales in a period older than the series covers, or before the epoch, are ignored.
+ * @param period Period number, e.g. an hour or day since the epoch.
+ * @param units Units sold, negative to take back sales that were deleted.
+ * @param revenue Money taken.
+ * @param discount Discount given.
+ * @return None.
+ */
+void SalesSeries::add(int64_t period, int64_t units, double revenue, double discount) {
+	if(period < 0)
+		return;
+	SalesBucket &bucket = ring[period % (int64_t)ring.size()];
+	if(bucket.period > period)
+		return;
+	if(bucket.period < period) {
+		SalesBucket empty = {period, 0, 0, 0};
+		bucket = empty;
+	}
+	bucket.units += units;
+	bucket.revenue += revenue;
+	bucket.discount += discount;
+}
+
+/** Adds up the sales over a range of periods. Periods older than the series covers count as empty.
+ * @param first First period counted.
+ * @param last Last period counted.
+ * @return Sum of the sales, with the last period as its period.
+ */
+SalesBucket SalesSeries::total(int64_t first, int64_t last) const {
+	SalesBucket sum = {last, 0, 0, 0};
+	if(last - first >= (int64_t)ring.size())
+		first = last - ring.size() + 1;
+	for(int64_t period = first < 0 ? 0 : first; period <= last; period++) {
+		const SalesBucket &bucket = ring[period % (int64_t)ring.size()];
+		if(bucket.period != period)
+			continue;
+		sum.units += bucket.units;
+		sum.revenue += bucket.revenue;
+		sum.discount += bucket.discount;
+	}
+	return sum;
+}
+
+/** Default constructor. Starts with empty hourly and daily series.
+ * @return None.
+ */
+SalesTimeline::SalesTimeline() : hours(HOURS_KEPT), days(DAYS_KEPT) {
+}
+
+/** Gets the hour a date falls in.
+ * @param date Date to look up.
+ * @return Number of hours since the epoch, rounded down.
+ */
+int64_t SalesCounters::hourOf(time_t date) {
+	int64_t hour = date / HOUR_SECONDS;
+	if(date < 0 && date % HOUR_SECONDS != 0)
+		hour--;
+	return hour;
+}
+
+/** Gets the earliest date the daily series still cover.
+ * @param now Current date.
+ * @return Start of the oldest day kept.
+ */
+time_t SalesCounters::earliest(time_t now) {
+	return HistoryRollups::dayStart(HistoryRollups::dayOf(now) - DAYS_KEPT + 1);
+}
+
+/** Counts the sales of one order line against its product and category.
+ * @param date Date of the purchase.
+ * @param product Product bought.
+ * @param units Units sold, negative to take back sales that were deleted.
+ * @param revenue Money taken.
+ * @param discount Discount given.
+ * @return None.
+ */
+void SalesCounters::add(time_t date, const HistoryProduct &product, int64_t units, double revenue, double discount) {
+	int64_t hour = hourOf(date);
+	int64_t day = HistoryRollups::dayOf(date);
+	SalesTimeline &byProduct = products[product.id];
+	byProduct.hours.add(hour, units, revenue, discount);
+	byProduct.days.add(day, units, revenue, discount);
+	SalesTimeline &byCategory = categories[product.category];
+	byCategory.hours.add(hour, units, revenue, discount);
+	byCategory.days.add(day, units, revenue, discount);
+	productNames[product.id] = product.name;
+}
+
+/** Adds up a timeline's hourly sales between two dates.
+ * @param timeline Timeline to read.
+ * @param from Earliest date counted, rounded down to the hour.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::hourTotals(const SalesTimeline &timeline, time_t from, time_t to) {
+	return timeline.hours.total(hourOf(from), hourOf(to));
+}
+
+/** Adds up a timeline's daily sales between two dates.
+ * @param timeline Timeline to read.
+ * @param from Earliest date counted, rounded down to the day.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::dayTotals(const SalesTimeline &timeline, time_t from, time_t to) {
+	return timeline.days.total(HistoryRollups::dayOf(from), HistoryRollups::dayOf(to));
+}
+
+/** Finds the timeline of a product or category.
+ * @param timelines Timelines to search.
+ * @param key Product ID or category.
+ * @return Pointer to the timeline, or NULL if nothing has been sold under the key.
+ */
+const SalesTimeline *SalesCounters::lookUp(const std::map<std::string, SalesTimeline> &timelines, const std::string &key) {
+	std::map<std::string, SalesTimeline>::const_iterator found = timelines.find(key);
+	return found == timelines.end() ? NULL : &found->second;
+}
+
+/** Adds up the sales of a product hour by hour. Only the last two days are kept.
+ * @param productID Unique ID of the product.
+ * @param from Earliest date counted, rounded down to the hour.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::productHours(const std::string &productID, time_t from, time_t to) const {
+	const SalesTimeline *timeline = lookUp(products, productID);
+	SalesBucket none = {hourOf(to), 0, 0, 0};
+	return timeline ? hourTotals(*timeline, from, to) : none;
+}
+
+/** Adds up the sales of a product day by day. Only the last 90 days are kept.
+ * @param productID Unique ID of the product.
+ * @param from Earliest date counted, rounded down to the day.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::productDays(const std::string &productID, time_t from, time_t to) const {
+	const SalesTimeline *timeline = lookUp(products, productID);
+	SalesBucket none = {HistoryRollups::dayOf(to), 0, 0, 0};
+	return timeline ? dayTotals(*timeline, from, to) : none;
+}
+
+/** Adds up the sales of a category hour by hour. Only the last two days are kept.
+ * @param category Product category.
+ * @param from Earliest date counted, rounded down to the hour.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::categoryHours(const std::string &category, time_t from, time_t to) const {
+	const SalesTimeline *timeline = lookUp(categories, category);
+	SalesBucket none = {hourOf(to), 0, 0, 0};
+	return timeline ? hourTotals(*timeline, from, to) : none;
+}
+
+/** Adds up the sales of a category day by day. Only the last 90 days are kept.
+ * @param category Product category.
+ * @param from Earliest date counted, rounded down to the day.
+ * @param to Latest date counted.
+ * @return Sum of the sales.
+ */
+SalesBucket SalesCounters::categoryDays(const std::string &category, time_t from, time_t to) const {
+	const SalesTimeline *timeline = lookUp(categories, category);
+	SalesBucket none = {HistoryRollups::dayOf(to), 0, 0, 0};
+	return timeline ? dayTotals(*timeline, from, to) : none;
+}
+
+/** Writes one row of the sales report.
+ * @param report Stream to write to.
+ * @param name Name shown in the first column.
+ * @param timeline Timeline of the product or category.
+ * @param now Current date.
+ * @return None.
+ */
+static void reportRow(std::ostringstream &report, const std::string &name, const SalesTimeline &timeline, time_t now) {
+	int64_t today = HistoryRollups::dayOf(now);
+	SalesBucket lastDay = timeline.hours.total(SalesCounters::hourOf(now) - 23, SalesCounters::hourOf(now));
+	SalesBucket lastWeek = timeline.days.total(today - 6, today);
+	SalesBucket lastMonth = timeline.days.total(today - 29, today);
+	if(lastMonth.units == 0 && lastDay.units == 0)
+		return;
+
+	report << std::left << std::setw(24) << name.substr(0, 23) << std::right
+		   << std::setw(7) << lastDay.units << std::setw(11) << lastDay.revenue
+		   << std::setw(7) << lastWeek.units << std::setw(11) << lastWeek.revenue
+		   << std::setw(7) << lastMonth.units << std::setw(11) << lastMonth.revenue
+		   << std::setw(11) << lastMonth.discount << "\n";
+}
+
+/** Writes the column headings of the sales report.
+ * @param report Stream to write to.
+ * @param title Heading of the first column.
+ * @return None.
+ */
+static void reportHeader(std::ostringstream &report, const std::string &title) {
+	report << std::left << std::setw(24) << title << std::right
+		   << std::setw(18) << "Last 24 hours" << std::setw(18) << "Last 7 days" << std::setw(18) << "Last 30 days" << "\n"
+		   << std::setw(24) << "";
+	for(int i = 0; i < 3; i++)
+		report << std::setw(7) << "Units" << std::setw(11) << "Revenue";
+	report << std::setw(11) << "Discount" << "\n";
+}
+
+/** Builds a report of sales per category and per product over the last 24 hours, 7 days and 30 days. Products and
+ * categories with no sales in the last 30 days are left out.
+ * @param now Current date.
+ * @return A string with a table of units, revenue and discount for each category, then each product.
+ */
+std::string SalesCounters::report(time_t now) const {
+	std::ostringstream report;
+	report << std::fixed << std::setprecision(2);
+
+	reportHeader(report, "Category");
+	for(std::map<std::string, SalesTimeline>::const_iterator i = categories.begin(); i != categories.end(); i++)
+		reportRow(report, i->first.empty() ? "(none)" : i->first, i->second, now);
+
+	report << "\n";
+	reportHeader(report, "Product");
+	for(std::map<std::string, SalesTimeline>::const_iterator i = products.begin(); i != products.end(); i++)
+		reportRow(report, i->first + " " + productNames.find(i->first)->second, i->second, now);
+	return report.str();
+}
+
+/** Removes every counter.
+ * @return None.
+ */
+void SalesCounters::clear() {
+	products.clear();
+	categories.clear();
+	productNames.clear();
+}
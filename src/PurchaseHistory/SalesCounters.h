@@ -0,0 +1,63 @@
+#ifndef SALES_COUNTERS_H
+#define SALES_COUNTERS_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <ctime>
+#include <cstdint>
+#include "HistoryStore.h"
+
+/** Units sold, money taken and discount given in one period, or added up over several. */
+struct SalesBucket {
+	int64_t period;
+	int64_t units;
+	double revenue;
+	double discount;
+};
+
+/** Sales over a fixed number of consecutive periods, kept in a ring so a new period overwrites the oldest. */
+class SalesSeries {
+	private:
+		std::vector<SalesBucket> ring;
+
+	public:
+		SalesSeries(size_t periods);
+
+		void add(int64_t period, int64_t units, double revenue, double discount);
+		SalesBucket total(int64_t first, int64_t last) const;
+};
+
+/** Hourly and daily sales of one product or category. */
+struct SalesTimeline {
+	SalesSeries hours;
+	SalesSeries days;
+
+	SalesTimeline();
+};
+
+class SalesCounters {
+	private:
+		// Ordered by ID and name so reports list them in a stable order
+		std::map<std::string, SalesTimeline> products;
+		std::map<std::string, SalesTimeline> categories;
+		std::map<std::string, std::string> productNames;
+
+		static SalesBucket hourTotals(const SalesTimeline &timeline, time_t from, time_t to);
+		static SalesBucket dayTotals(const SalesTimeline &timeline, time_t from, time_t to);
+		static const SalesTimeline *lookUp(const std::map<std::string, SalesTimeline> &timelines, const std::string &key);
+
+	public:
+		static int64_t hourOf(time_t date);
+		static time_t earliest(time_t now);
+
+		void add(time_t date, const HistoryProduct &product, int64_t units, double revenue, double discount);
+		SalesBucket productHours(const std::string &productID, time_t from, time_t to) const;
+		SalesBucket productDays(const std::string &productID, time_t from, time_t to) const;
+		SalesBucket categoryHours(const std::string &category, time_t from, time_t to) const;
+		SalesBucket categoryDays(const std::string &category, time_t from, time_t to) const;
+		std::string report(time_t now) const;
+		void clear();
+};
+
+#endif
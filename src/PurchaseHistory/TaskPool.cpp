@@ -0,0 +1,44 @@
+/** \file TaskPool.h
+ * \brief Parallel batches for loading purchase histories.
+ * \details Workers take the next task number from a shared counter until none are left, so a slow task does not
+ * hold up the others. Each task writes only to its own output, and the caller merges the outputs in task order
+ * once run() returns. A batch of one task runs on the calling thread.
+ */
+
+#include "TaskPool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/** Gets the number of worker threads a batch is spread over.
+ * @return Number of cores, at least one.
+ */
+unsigned TaskPool::workers() {
+	unsigned cores = std::thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+/** Runs tasks in parallel and waits for all of them to finish.
+ * @param tasks Number of tasks.
+ * @param task Function called once with each task number from 0 to tasks - 1.
+ * @return None.
+ */
+void TaskPool::run(size_t tasks, const std::function<void(size_t)> &task) {
+	size_t threadCount = workers() < tasks ? workers() : tasks;
+	if(threadCount <= 1) {
+		for(size_t t = 0; t < tasks; t++)
+			task(t);
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < threadCount; i++) {
+		threads.push_back(std::thread([&]() {
+			for(size_t t = next++; t < tasks; t = next++)
+				task(t);
+		}));
+	}
+	for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); i++)
+		i->join();
+}
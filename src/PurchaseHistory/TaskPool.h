@@ -0,0 +1,14 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <cstddef>
+#include <functional>
+
+/** Runs a batch of independent tasks on one worker thread per core. */
+class TaskPool {
+	public:
+		static unsigned workers();
+		static void run(size_t tasks, const std::function<void(size_t)> &task);
+};
+
+#endif
@@ -0,0 +1,220 @@
+/** \file CheckoutJournal.h
+ *  \brief Write-ahead log of completed checkouts.
+ *  \details Every successful checkout is written as one line holding its sequence number, the member's balance
+ *  change, the coupons it redeemed and, for each order, the product, quantity and cost paid. That one line is the
+ *  stock change, the coupon redemptions and the purchase history entry. It is appended and flushed to disk with a single write and fsync before the checkout
+ *  takes effect in memory. On startup the journal is replayed on top of the product, member and history databases,
+ *  which are only rewritten (and the journal emptied) when the program exits, and the coupon database, which leaves
+ *  journaled redemptions out until then. Each of those databases is saved along with the highest checkout number it
+ *  holds, as is the history log, and a checkout at or below a database's number is not applied to it again. A crash
+ *  after some databases are saved at exit but before the journal is emptied replays each checkout only where it is
+ *  missing, and a history deleted since is not added back. Sequence numbers carry on from the highest of them after
+ *  the journal is emptied.
+ *
+ *  Record layout: C,sequence,memberID,date,balanceDelta,couponCount,{couponCode}...,orderCount,{productID,name,category,price,discount,quantity,totalCost}...,E
+ *  A record without its closing E was torn by a crash and is dropped, along with anything after it.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "CheckoutJournal.h"
+
+/** Constructor. Opens (or creates) the journal file for appending.
+ * @param fileName Path of the journal file.
+ * @return None.
+ */
+CheckoutJournal::CheckoutJournal(std::string fileName)
+{
+	this->fileName = fileName;
+	this->sequence = 0;
+	this->fd = open(fileName.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fd == -1)
+	{
+		std::cerr << "Could not open checkout journal " << fileName << "\n";
+	}
+}
+
+/** Destructor. Closes the journal file.
+ * @return None.
+ */
+CheckoutJournal::~CheckoutJournal()
+{
+	if (fd != -1)
+	{
+		close(fd);
+	}
+}
+
+/** Appends one checkout record under the next sequence number and waits for it to reach the disk.
+ * @param memberID Unique ID of the member who checked out.
+ * @param date Time of the checkout, also the purchase history's date.
+ * @param balanceDelta Change in the member's balance (negative for a purchase).
+ * @param couponCodes Codes of the coupons the checkout redeemed.
+ * @param orders Orders bought, priced as they were charged.
+ * @return Sequence number of the checkout once the record is durable, 0 if it could not be written.
+ */
+uint64_t CheckoutJournal::append(int memberID, time_t date, float balanceDelta, const std::vector<std::string> &couponCodes, const std::list<Order> &orders)
+{
+	std::ostringstream record;
+	record << std::setprecision(9);
+	record << "C," << sequence + 1 << "," << memberID << "," << (long long)date << "," << balanceDelta << "," << couponCodes.size();
+	for (unsigned c = 0; c < couponCodes.size(); c++)
+	{
+		record << "," << couponCodes[c];
+	}
+	record << "," << orders.size();
+	for (std::list<Order>::const_iterator i = orders.begin(); i != orders.end(); ++i)
+	{
+		const Product &product = i->getProduct();
+		float discount = product.getDiscountRate();
+		record << "," << product.getID() << "," << product.getName() << "," << product.getCategory() << "," << product.getPrice()
+			   << "," << discount << "," << i->getQuantity() << "," << i->getTotalCost();
+	}
+	record << ",E\n";
+
+	std::string line = record.str();
+	if (fd == -1 || write(fd, line.data(), line.size()) != (ssize_t)line.size() || fsync(fd) != 0)
+	{
+		std::cerr << "Could not write checkout journal " << fileName << "\n";
+		return 0;
+	}
+	return ++sequence;
+}
+
+/** Re-applies every complete record to the freshly loaded databases, then cuts off any torn record at the end.
+ *  Each part of a checkout is only applied to a database that has not saved its sequence number yet. Must be
+ *  called before the first append, as it also picks the sequence number new checkouts carry on from.
+ * @param productC ProductCollection to reduce stock in.
+ * @param login Login system holding the members whose balances changed.
+ * @param coupons CouponCollection to redeem the checkouts' coupons in.
+ * @param histC PurchaseHistoryCollection to add the purchase histories to.
+ * @return Integer number of checkouts replayed.
+ */
+int CheckoutJournal::replay(ProductCollection &productC, Login &login, CouponCollection &coupons, PurchaseHistoryCollection &histC)
+{
+	std::ifstream input(fileName.c_str());
+	std::string line, key;
+	long validEnd = 0;
+	int replayed = 0;
+	uint64_t stockApplied = productC.getLastCheckout();
+	uint64_t balanceApplied = login.getLastCheckout();
+	uint64_t couponsApplied = coupons.getLastCheckout();
+	uint64_t historyApplied = histC.getLastCheckout();
+	sequence = std::max(std::max(stockApplied, balanceApplied), std::max(couponsApplied, historyApplied));
+
+	while (getline(input, line))
+	{
+		std::vector<std::string> fields;
+		std::istringstream iss(line);
+		while (getline(iss, key, ','))
+		{
+			fields.push_back(key);
+		}
+		if (input.eof() || fields.size() < 8 || fields[0] != "C" || fields.back() != "E")
+		{
+			break;
+		}
+
+		uint64_t checkout;
+		int memberID;
+		time_t date;
+		float balanceDelta;
+		std::vector<std::string> couponCodes;
+		std::list<Order> orders;
+		try
+		{
+			unsigned couponCount = std::stoul(fields[5]);
+			if (fields.size() < 8 + couponCount)
+			{
+				break;
+			}
+			couponCodes.assign(fields.begin() + 6, fields.begin() + 6 + couponCount);
+			unsigned first = 7 + couponCount;
+			unsigned count = std::stoul(fields[first - 1]);
+			if (fields.size() != first + 1 + 7 * count)
+			{
+				break;
+			}
+			checkout = std::stoull(fields[1]);
+			memberID = std::stoi(fields[2]);
+			date = std::stoll(fields[3]);
+			balanceDelta = std::stof(fields[4]);
+
+			for (unsigned c = 0; c < count; c++)
+			{
+				const std::string *f = &fields[first + 7 * c];
+				Product product = Product(f[1], f[2], f[0], std::stof(f[3]), 0);
+				// History keeps only the rate the product sold at, which is carried as its promotion
+				product.setPromotion(std::stof(f[4]));
+				Order order = Order(product, 0, std::stoi(f[5]));
+				order.changeTotalCost(std::stof(f[6]));
+				orders.push_back(order);
+			}
+		}
+		catch (const std::exception &)
+		{
+			break;
+		}
+
+		if (checkout > stockApplied)
+		{
+			for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); ++i)
+			{
+				productC.applyJournaledStock(i->getProduct().getID(), -i->getQuantity());
+			}
+		}
+		Member *member = login.findMemberByID(memberID);
+		if (member != NULL && checkout > balanceApplied)
+		{
+			member->modifyBalance(balanceDelta);
+		}
+		if (checkout > couponsApplied)
+		{
+			coupons.applyJournaledRedemptions(couponCodes);
+		}
+		if (checkout > historyApplied)
+		{
+			histC.addPurchaseHistory(PurchaseHistory(orders, memberID, date), checkout);
+		}
+		if (checkout > sequence)
+		{
+			sequence = checkout;
+		}
+
+		validEnd = input.tellg();
+		replayed++;
+	}
+	input.close();
+
+	// Drop a torn record so new records are not appended onto it
+	if (fd != -1 && ftruncate(fd, validEnd) != 0)
+	{
+		std::cerr << "Could not repair checkout journal " << fileName << "\n";
+	}
+	return replayed;
+}
+
+/** Gets the sequence number of the last checkout written or replayed, which the databases record when saved at exit.
+ * @return Sequence number of the checkout, 0 if none.
+ */
+uint64_t CheckoutJournal::getLastCheckout() const
+{
+	return sequence;
+}
+
+/** Empties the journal. Called once the product, member and history databases have been saved with every journaled checkout.
+ * @return None.
+ */
+void CheckoutJournal::truncate()
+{
+	if (fd != -1 && (ftruncate(fd, 0) != 0 || fsync(fd) != 0))
+	{
+		std::cerr << "Could not empty checkout journal " << fileName << "\n";
+	}
+}
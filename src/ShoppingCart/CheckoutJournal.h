@@ -0,0 +1,35 @@
+#ifndef CHECKOUTJOURNAL_H
+#define CHECKOUTJOURNAL_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+#include "Order.h"
+#include "CouponCollection.h"
+#include "../Login/Login.h"
+#include "../Product/ProductCollection.h"
+#include "../PurchaseHistory/PurchaseHistoryCollection.h"
+
+class CheckoutJournal {
+	private:
+		std::string fileName;
+		int fd;
+		// Sequence number of the last checkout written or replayed
+		uint64_t sequence;
+
+		CheckoutJournal(const CheckoutJournal &other);
+		CheckoutJournal &operator=(const CheckoutJournal &other);
+
+	public:
+		CheckoutJournal(std::string fileName);
+		~CheckoutJournal();
+
+		uint64_t append(int memberID, time_t date, float balanceDelta, const std::vector<std::string> &couponCodes, const std::list<Order> &orders);
+		int replay(ProductCollection &productC, Login &login, CouponCollection &coupons, PurchaseHistoryCollection &histC);
+		void truncate();
+		uint64_t getLastCheckout() const;
+};
+
+#endif
@@ -0,0 +1,197 @@
+/** \file CheckoutTransaction.h
+ *  \brief Optimistic transaction used to check out a shopping cart.
+ *  \details Reads the live catalog entry and version stamp of every product in the cart, validates
+ *  stock, price and member balance against that read, and commits the stock and balance changes
+ *  only if none of the products were modified in the meantime. A commit is made durable by a single
+ *  CheckoutJournal record before it is applied. Keeps process-wide commit/abort counters.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include "CheckoutTransaction.h"
+
+std::mutex CheckoutTransaction::commitLock;
+std::atomic<unsigned long> CheckoutTransaction::commits(0);
+std::atomic<unsigned long> CheckoutTransaction::conflicts(0);
+std::atomic<unsigned long> CheckoutTransaction::failures(0);
+
+/** Constructor. Creates an empty transaction.
+ * @param taxRate Tax applied on top of the cart subtotal.
+ * @return None.
+ */
+CheckoutTransaction::CheckoutTransaction(float taxRate)
+{
+	this->taxRate = taxRate;
+	this->subtotal = 0;
+	this->grandPrice = 0;
+	this->missingProduct = false;
+	this->checkout = 0;
+}
+
+/** Default destructor.
+ * @return None.
+ */
+CheckoutTransaction::~CheckoutTransaction()
+{
+}
+
+/** Read phase. Looks up the live catalog entry for every order, records its version stamp and stock,
+ *  and reprices the order from the live product so a stale cart snapshot is never charged.
+ * @param productC ProductCollection holding the live catalog.
+ * @param orders Orders in the cart. Their product snapshots are refreshed in place.
+ * @return None.
+ */
+void CheckoutTransaction::read(ProductCollection &productC, std::list<Order> &orders)
+{
+	subtotal = 0;
+	readSet.clear();
+	missingProduct = false;
+
+	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); ++i)
+	{
+		int index = productC.findProduct(i->getProduct().getID());
+		if (index == -1)
+		{
+			missingProduct = true;
+			std::cerr << "Unavailable: " << i->getProduct().getName() << " is no longer sold.\n";
+			continue;
+		}
+
+		Product *live = productC.getProduct(index);
+		if (live->getPrice() != i->getProduct().getPrice())
+		{
+			std::cout << "Price of " << live->getName() << " changed from $" << i->getProduct().getPrice() << " to $" << live->getPrice() << "\n";
+		}
+		*i = Order(*live, i->getDate(), i->getQuantity());
+
+		ReadEntry entry;
+		entry.index = index;
+		entry.productID = live->getID();
+		entry.name = live->getName();
+		entry.version = live->getVersion();
+		entry.stock = live->getQuantity();
+		entry.quantity = i->getQuantity();
+		readSet.push_back(entry);
+
+		subtotal += i->getTotalCost();
+	}
+
+	grandPrice = subtotal + subtotal * taxRate;
+}
+
+/** Takes an amount, such as coupon savings, off the subtotal before tax is applied.
+ * @param amount Dollar amount to deduct from the subtotal read.
+ * @return None.
+ */
+void CheckoutTransaction::applyDeduction(float amount)
+{
+	grandPrice = (subtotal - amount) + (subtotal - amount) * taxRate;
+}
+
+/** Validate phase. Checks the stock and balance recorded by the read phase. Prints every problem found.
+ * @param buyer Member* who is making the purchase.
+ * @return True if the checkout may be committed, false otherwise.
+ */
+bool CheckoutTransaction::validate(Member *buyer)
+{
+	bool verified = !missingProduct;
+
+	for (std::vector<ReadEntry>::iterator i = readSet.begin(); i != readSet.end(); ++i)
+	{
+		if (i->quantity > i->stock)
+		{
+			verified = false;
+			std::cerr << "Low Stock: You attempted to purchase: " << i->name << " x " << i->quantity << ", only have " << i->stock << " in stock.\n";
+		}
+	}
+	if (grandPrice > buyer->getCurrency())
+	{
+		verified = false;
+		std::cerr << "Low user funds: Cart total is $" << grandPrice << ", while User has balance of $" << buyer->getCurrency() << "\n";
+	}
+
+	if (!verified)
+		failures++;
+	return verified;
+}
+
+/** Commit phase. Under the commit lock, checks that every product read still carries the same version
+ *  stamp and, if so, writes the checkout to the journal and then applies all stock reductions and the
+ *  balance change together.
+ * @param productC ProductCollection to apply changes to.
+ * @param buyer Member* who is making the purchase.
+ * @param journal CheckoutJournal the commit record is written to.
+ * @param date Time of the checkout.
+ * @param couponCodes Codes of the coupons redeemed for the checkout, written to its journal record.
+ * @param orders Orders bought, as repriced by the read phase.
+ * @return True if the transaction committed, false if a product changed since it was read or the journal could not be written.
+ */
+bool CheckoutTransaction::commit(ProductCollection &productC, Member *buyer, CheckoutJournal &journal, time_t date, const std::vector<std::string> &couponCodes, const std::list<Order> &orders)
+{
+	std::lock_guard<std::mutex> guard(commitLock);
+
+	for (std::vector<ReadEntry>::iterator i = readSet.begin(); i != readSet.end(); ++i)
+	{
+		if (i->index >= productC.size() || productC.getProduct(i->index)->getID() != i->productID || productC.getProduct(i->index)->getVersion() != i->version)
+		{
+			conflicts++;
+			return false;
+		}
+	}
+
+	checkout = journal.append(buyer->getID(), date, -grandPrice, couponCodes, orders);
+	if (checkout == 0)
+	{
+		failures++;
+		return false;
+	}
+
+	for (std::vector<ReadEntry>::iterator i = readSet.begin(); i != readSet.end(); ++i)
+	{
+		productC.applyJournaledStock(i->productID, -i->quantity);
+	}
+	buyer->modifyBalance(-grandPrice); // Add balance as negative float
+	commits++;
+	return true;
+}
+
+/** Gets the cart total, including tax, computed by the read phase.
+ * @return Float value of the amount charged on commit.
+ */
+float CheckoutTransaction::getGrandPrice()
+{
+	return grandPrice;
+}
+
+/** Gets the sequence number the checkout was journaled under.
+ * @return Sequence number of the checkout, 0 if it has not committed.
+ */
+uint64_t CheckoutTransaction::getCheckout()
+{
+	return checkout;
+}
+
+/** Builds a summary of checkout outcomes since the program started.
+ * @return A string with the number of commits, version conflicts and failed validations, and the commit and abort rates.
+ */
+std::string CheckoutTransaction::metricsReport()
+{
+	unsigned long committed = commits.load();
+	unsigned long aborted = conflicts.load();
+	unsigned long failed = failures.load();
+	unsigned long attempts = committed + aborted + failed;
+	std::ostringstream report;
+
+	report << "Checkout attempts: " << attempts << "\n"
+		   << "Committed: " << committed << "\n"
+		   << "Aborted (version conflict): " << aborted << "\n"
+		   << "Failed validation: " << failed << "\n";
+	if (attempts > 0)
+	{
+		report << std::fixed << std::setprecision(1)
+			   << "Commit rate: " << 100.0 * committed / attempts << "%\n"
+			   << "Abort rate: " << 100.0 * aborted / attempts << "%\n";
+	}
+	return report.str();
+}
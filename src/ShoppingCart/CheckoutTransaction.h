@@ -0,0 +1,53 @@
+#ifndef CHECKOUTTRANSACTION_H
+#define CHECKOUTTRANSACTION_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <ctime>
+#include <cstdint>
+#include "Order.h"
+#include "CheckoutJournal.h"
+#include "../Login/Member.h"
+#include "../Product/ProductCollection.h"
+
+class CheckoutTransaction {
+	private:
+		struct ReadEntry {
+			int index;
+			std::string productID;
+			std::string name;
+			unsigned int version;
+			int stock;
+			int quantity;
+		};
+
+		std::vector<ReadEntry> readSet;
+		float taxRate;
+		float subtotal;
+		float grandPrice;
+		bool missingProduct;
+		uint64_t checkout;
+
+		static std::mutex commitLock;
+		static std::atomic<unsigned long> commits;
+		static std::atomic<unsigned long> conflicts;
+		static std::atomic<unsigned long> failures;
+
+	public:
+		CheckoutTransaction(float taxRate);
+		~CheckoutTransaction();
+
+		void read(ProductCollection &productC, std::list<Order> &orders);
+		void applyDeduction(float amount);
+		bool validate(Member *buyer);
+		bool commit(ProductCollection &productC, Member *buyer, CheckoutJournal &journal, time_t date, const std::vector<std::string> &couponCodes, const std::list<Order> &orders);
+		float getGrandPrice();
+		uint64_t getCheckout();
+
+		static std::string metricsReport();
+};
+
+#endif
@@ -0,0 +1,106 @@
+/** \file Coupon.h
+ *  \brief A coupon code and the rule it applies.
+ *  \details Holds a coupon's code, whether it takes a percentage or a flat amount off, the category it is
+ *  limited to (empty for the whole cart), the minimum cart spend it requires and how many times it may be redeemed.
+ */
+
+#include <cctype>
+#include "Coupon.h"
+
+/** Default constructor. Creates an empty flat coupon worth nothing.
+ * @return None.
+ */
+Coupon::Coupon()
+{
+	this->type = flatOff;
+	this->amount = 0;
+	this->minSpend = 0;
+	this->maxRedemptions = 0;
+}
+
+/** Constructor with arguments.
+ * @param code Code the member enters. Stored in upper case.
+ * @param type Whether amount is a percentage or a flat value.
+ * @param amount Fraction off for percentOff (0.1 for 10%), dollars off for flatOff.
+ * @param category Product category the coupon is limited to, empty for any product.
+ * @param minSpend Smallest cart subtotal the coupon applies to.
+ * @param maxRedemptions Number of times the coupon may be redeemed, 0 for unlimited.
+ * @return None.
+ */
+Coupon::Coupon(std::string code, CouponType type, float amount, std::string category, float minSpend, int maxRedemptions)
+{
+	this->code = normalizeCode(code);
+	this->type = type;
+	this->amount = amount;
+	this->category = category;
+	this->minSpend = minSpend;
+	this->maxRedemptions = maxRedemptions;
+}
+
+/** Default destructor.
+ * @return None.
+ */
+Coupon::~Coupon()
+{
+}
+
+/** Gets the coupon code.
+ * @return Upper case coupon code.
+ */
+const std::string &Coupon::getCode() const
+{
+	return code;
+}
+
+/** Gets how the coupon amount is applied.
+ * @return percentOff or flatOff.
+ */
+CouponType Coupon::getType() const
+{
+	return type;
+}
+
+/** Gets the coupon amount.
+ * @return Fraction off for percentOff, dollars off for flatOff.
+ */
+float Coupon::getAmount() const
+{
+	return amount;
+}
+
+/** Gets the category the coupon is limited to.
+ * @return Category name, empty if the coupon applies to any product.
+ */
+std::string Coupon::getCategory() const
+{
+	return category;
+}
+
+/** Gets the minimum cart subtotal required by the coupon.
+ * @return Float value of the minimum spend.
+ */
+float Coupon::getMinSpend() const
+{
+	return minSpend;
+}
+
+/** Gets how many times the coupon may be redeemed.
+ * @return Integer redemption limit, 0 for unlimited.
+ */
+int Coupon::getMaxRedemptions() const
+{
+	return maxRedemptions;
+}
+
+/** Converts a code to the form it is stored under, so codes are matched case-insensitively.
+ * @param code Code as entered.
+ * @return Code in upper case.
+ */
+std::string Coupon::normalizeCode(std::string code)
+{
+	for (unsigned i = 0; i < code.length(); i++)
+	{
+		code[i] = toupper(code[i]);
+	}
+	return code;
+}
@@ -0,0 +1,40 @@
+#ifndef COUPON_H
+#define COUPON_H
+
+#include <string>
+
+/** \enum CouponType
+ * How a coupon's amount is applied.
+ */
+enum CouponType
+{
+	percentOff, /*!< Amount is a fraction of the eligible spend */
+	flatOff /*!< Amount is a fixed dollar value */
+};
+
+class Coupon
+{
+	private:
+		std::string code;
+		CouponType type;
+		float amount;
+		std::string category;
+		float minSpend;
+		int maxRedemptions;
+
+	public:
+		Coupon();
+		Coupon(std::string code, CouponType type, float amount, std::string category, float minSpend, int maxRedemptions);
+		~Coupon();
+
+		const std::string &getCode() const;
+		CouponType getType() const;
+		float getAmount() const;
+		std::string getCategory() const;
+		float getMinSpend() const;
+		int getMaxRedemptions() const;
+
+		static std::string normalizeCode(std::string code);
+};
+
+#endif
@@ -0,0 +1,414 @@
+/** \file CouponCollection.h
+ *  \brief Functionality for maintaining the coupon database.
+ *  \details Stores coupons in a hash table keyed by code. When a coupon is added it is compiled into a small
+ *  fixed-size rule (category ID, minimum spend and value in integer units), so pricing a coupon against a cart
+ *  is a constant-time check. Redemption counts are atomics, so redeeming coupons never takes a lock.
+ *  The coupons a checkout redeems are written to its checkout journal record, and are left out of the counts in
+ *  the database file until the journal is emptied, so replaying the journal after a crash restores them exactly.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "CouponCollection.h"
+
+using namespace std;
+
+// Last column of the heading line, followed by the last journaled checkout the file holds
+constexpr auto CHECKOUT_HEADING = "Checkout=";
+
+/**
+* Constructor reads coupons and their redemption counts from the coupon database file. Rows that cannot be parsed
+* are skipped and their line numbers kept, so they are reported rather than stopping the program.
+* @return None.
+*/
+CouponCollection::CouponCollection()
+{
+	ifstream input;
+	input.open("coupons.csv");
+
+	string line, key;
+	getline(input, line); // First line of CSV file holds the headings
+	size_t heading = line.find(CHECKOUT_HEADING);
+	lastCheckout = heading == string::npos ? 0 : strtoull(line.c_str() + heading + strlen(CHECKOUT_HEADING), NULL, 10);
+
+	int lineNumber = 1;
+	while (getline(input, line))
+	{ // Read lines of CSV file into a 'Coupon' object
+		lineNumber++;
+		if (line.empty())
+		{
+			continue;
+		}
+
+		vector<string> fields;
+		istringstream iss(line);
+		while (getline(iss, key, ','))
+		{
+			fields.push_back(key);
+		}
+		if (fields.size() < 7)
+		{
+			malformedLines.push_back(lineNumber);
+			continue;
+		}
+
+		CouponType type = fields[1] == "percent" ? percentOff : flatOff;
+		Coupon coupon;
+		unsigned long redeemed;
+		try
+		{
+			coupon = Coupon(fields[0], type, stof(fields[2]), fields[3], stof(fields[4]), stoi(fields[5]));
+			redeemed = stoul(fields[6]);
+		}
+		catch (const std::exception &)
+		{
+			malformedLines.push_back(lineNumber);
+			continue;
+		}
+		compile(coupon, redeemed);
+	}
+	input.close();
+
+	if (!malformedLines.empty())
+	{
+		cout << "Warning: " << malformedLines.size() << " row(s) of coupons.csv could not be read and will be dropped when coupons are saved, on line(s):";
+		for (unsigned i = 0; i < malformedLines.size(); i++)
+			cout << " " << malformedLines[i];
+		cout << endl;
+	}
+}
+
+/**
+* Destructor for coupon collection.
+* @return None.
+*/
+CouponCollection::~CouponCollection()
+{
+}
+
+/**
+* Compiles a coupon into its rule form and stores it under its code.
+* @param coupon Coupon to store.
+* @param redeemed Number of times the coupon has already been redeemed.
+* @return Integer handle of the stored coupon.
+*/
+int CouponCollection::compile(const Coupon &coupon, unsigned int redeemed)
+{
+	CompiledRule rule;
+	rule.categoryID = -1;
+	if (!coupon.getCategory().empty())
+	{
+		unordered_map<string, int>::iterator found = categoryIndex.find(coupon.getCategory());
+		if (found == categoryIndex.end())
+		{
+			found = categoryIndex.emplace(coupon.getCategory(), (int)categoryIndex.size()).first;
+		}
+		rule.categoryID = found->second;
+	}
+	rule.minSpendCents = lroundf(coupon.getMinSpend() * 100);
+	rule.percent = coupon.getType() == percentOff;
+	rule.value = rule.percent ? lroundf(coupon.getAmount() * 10000) : lroundf(coupon.getAmount() * 100); // basis points or cents
+	rule.maxRedemptions = coupon.getMaxRedemptions();
+	rule.active = true;
+
+	int handle = rules.size();
+	coupons.push_back(coupon);
+	rules.push_back(rule);
+	redemptions.emplace_back(redeemed);
+	journaledRedemptions.emplace_back(0);
+	codeIndex[coupon.getCode()] = handle;
+	return handle;
+}
+
+/**
+* Adds a coupon to the collection.
+* @param coupon Coupon to add.
+* @return 0 on success, -1 if the code is already in use, -2 if the coupon's amount is invalid.
+*/
+int CouponCollection::addCoupon(Coupon coupon)
+{
+	if (coupon.getCode().empty() || codeIndex.find(coupon.getCode()) != codeIndex.end())
+	{
+		return -1;
+	}
+	if (coupon.getAmount() <= 0 || (coupon.getType() == percentOff && coupon.getAmount() > 1))
+	{
+		return -2;
+	}
+
+	compile(coupon, 0);
+	saveToDatabase();
+	return 0;
+}
+
+/**
+* Removes a coupon. Carts already holding the coupon stop receiving its discount.
+* @param code Code of the coupon to remove.
+* @return 0 on success, -1 if no coupon has the code.
+*/
+int CouponCollection::removeCoupon(string code)
+{
+	unordered_map<string, int>::iterator found = codeIndex.find(Coupon::normalizeCode(code));
+	if (found == codeIndex.end())
+	{
+		return -1;
+	}
+
+	rules[found->second].active = false;
+	codeIndex.erase(found);
+	saveToDatabase();
+	return 0;
+}
+
+/**
+* Finds a coupon by code.
+* @param code Code as entered by the member, in any case.
+* @return Integer handle of the coupon, -1 if no coupon has the code.
+*/
+int CouponCollection::findCoupon(string code)
+{
+	unordered_map<string, int>::iterator found = codeIndex.find(Coupon::normalizeCode(code));
+	if (found == codeIndex.end())
+	{
+		return -1;
+	}
+	return found->second;
+}
+
+/**
+* Gets the definition of a coupon.
+* @param handle Handle returned by findCoupon.
+* @return The coupon stored under the handle.
+*/
+const Coupon &CouponCollection::getCoupon(int handle)
+{
+	return coupons[handle];
+}
+
+/**
+* Gets the number of times a coupon has been redeemed.
+* @param handle Handle returned by findCoupon.
+* @return Unsigned integer redemption count.
+*/
+unsigned int CouponCollection::getRedemptions(int handle)
+{
+	return redemptions[handle].load();
+}
+
+/**
+* Checks if a coupon can still be redeemed.
+* @param handle Handle returned by findCoupon.
+* @return True if the coupon exists and has not reached its redemption limit, false otherwise.
+*/
+bool CouponCollection::isAvailable(int handle)
+{
+	const CompiledRule &rule = rules[handle];
+	return rule.active && (rule.maxRedemptions == 0 || redemptions[handle].load() < (unsigned int)rule.maxRedemptions);
+}
+
+/**
+* Gets the ID carts use to keep a running subtotal for a category.
+* @param category Category name.
+* @return Integer category ID, -1 if no coupon is limited to the category.
+*/
+int CouponCollection::categoryID(const string &category)
+{
+	unordered_map<string, int>::iterator found = categoryIndex.find(category);
+	if (found == categoryIndex.end())
+	{
+		return -1;
+	}
+	return found->second;
+}
+
+/**
+* Evaluates a coupon against a cart's totals.
+* @param handle Handle returned by findCoupon.
+* @param subtotal Cart subtotal.
+* @param categoryTotals Cart subtotal per category, indexed by categoryID.
+* @return Dollar amount the coupon takes off, 0 if the cart does not qualify or the coupon was removed.
+*/
+float CouponCollection::couponDiscount(int handle, float subtotal, const vector<float> &categoryTotals)
+{
+	if (handle < 0 || handle >= (int)rules.size())
+	{
+		return 0;
+	}
+
+	const CompiledRule &rule = rules[handle];
+	long subtotalCents = lroundf(subtotal * 100);
+	if (!rule.active || subtotalCents < rule.minSpendCents)
+	{
+		return 0;
+	}
+	long eligibleCents = subtotalCents;
+	if (rule.categoryID >= 0)
+	{
+		eligibleCents = rule.categoryID < (int)categoryTotals.size() ? lroundf(categoryTotals[rule.categoryID] * 100) : 0;
+	}
+
+	long offCents = rule.percent ? eligibleCents * rule.value / 10000 : min(rule.value, eligibleCents);
+	return offCents / 100.0f;
+}
+
+/**
+* Redeems every coupon on a cart. Either all coupons are redeemed or none are. The redemptions are counted as
+* journaled straight away, since the checkout either writes them to the journal or releases them.
+* @param handles Handles of the coupons on the cart.
+* @return True if every coupon was redeemed, false if one was removed or has reached its redemption limit.
+*/
+bool CouponCollection::redeem(const vector<int> &handles)
+{
+	for (unsigned i = 0; i < handles.size(); i++)
+	{
+		const CompiledRule &rule = rules[handles[i]];
+		unsigned int current = redemptions[handles[i]].load();
+		bool redeemed = rule.active;
+
+		while (redeemed)
+		{
+			if (rule.maxRedemptions > 0 && current >= (unsigned int)rule.maxRedemptions)
+			{
+				redeemed = false;
+			}
+			else if (redemptions[handles[i]].compare_exchange_weak(current, current + 1))
+			{
+				journaledRedemptions[handles[i]]++;
+				break;
+			}
+		}
+
+		if (!redeemed)
+		{
+			release(vector<int>(handles.begin(), handles.begin() + i));
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+* Takes back redemptions made by redeem, for a checkout that did not go through.
+* @param handles Handles of the coupons to release.
+* @return None.
+*/
+void CouponCollection::release(const vector<int> &handles)
+{
+	for (unsigned i = 0; i < handles.size(); i++)
+	{
+		redemptions[handles[i]]--;
+		journaledRedemptions[handles[i]]--;
+	}
+}
+
+/**
+* Redeems coupons again for a checkout replayed from the checkout journal. The redemptions are left out of the
+* database file until checkpointRedemptions is called, and coupons removed since are skipped.
+* @param codes Codes of the coupons the checkout redeemed.
+* @return None.
+*/
+void CouponCollection::applyJournaledRedemptions(const vector<string> &codes)
+{
+	for (unsigned i = 0; i < codes.size(); i++)
+	{
+		int handle = findCoupon(codes[i]);
+		if (handle == -1)
+			continue;
+		redemptions[handle]++;
+		journaledRedemptions[handle]++;
+	}
+}
+
+/**
+* Folds every journaled redemption into the coupon database file, which then records the last checkout it holds so
+* a journal replay does not redeem those coupons again. Called just before the checkout journal is emptied.
+* @param checkout Sequence number of the last journaled checkout.
+* @return None.
+*/
+void CouponCollection::checkpointRedemptions(uint64_t checkout)
+{
+	for (unsigned i = 0; i < journaledRedemptions.size(); i++)
+	{
+		journaledRedemptions[i] = 0;
+	}
+	lastCheckout = checkout;
+	saveToDatabase();
+}
+
+/**
+* Gets the last journaled checkout whose redemptions are in the coupon database file.
+* @return Sequence number of the checkout, 0 if none.
+*/
+uint64_t CouponCollection::getLastCheckout() const
+{
+	return lastCheckout;
+}
+
+/**
+* Gets the lines of the coupon database file that could not be read when the collection was loaded.
+* @return Line numbers, counting the headings as line 1.
+*/
+const vector<int> &CouponCollection::getMalformedLines() const
+{
+	return malformedLines;
+}
+
+/**
+* Displays every coupon with its rule and redemption count.
+* @return None.
+*/
+void CouponCollection::printCoupons()
+{
+	cout << "------------------------- Coupons -------------------------" << endl;
+	if (codeIndex.empty())
+	{
+		cout << "No coupons" << endl;
+	}
+	for (unsigned i = 0; i < rules.size(); i++)
+	{
+		if (!rules[i].active)
+			continue;
+
+		const Coupon &coupon = coupons[i];
+		cout << left << setw(15) << coupon.getCode();
+		if (coupon.getType() == percentOff)
+			cout << setw(10) << to_string((int)lroundf(coupon.getAmount() * 100)) + "%";
+		else
+			cout << "$" << setw(9) << coupon.getAmount();
+		cout << "Category: " << setw(15) << (coupon.getCategory().empty() ? "Any" : coupon.getCategory())
+			 << "Min Spend: $" << setw(10) << coupon.getMinSpend()
+			 << "Used: " << redemptions[i].load();
+		if (coupon.getMaxRedemptions() > 0)
+			cout << "/" << coupon.getMaxRedemptions();
+		cout << endl;
+	}
+}
+
+/**
+* Saves coupons and their redemption counts to the coupon database file. Redemptions still held in the checkout
+* journal are left out.
+* @return None.
+*/
+void CouponCollection::saveToDatabase()
+{
+	ofstream file;
+	file.open("coupons.csv", ofstream::out | ofstream::trunc);
+	file << "Code,Type,Amount,Category,MinSpend,MaxUses,Redeemed," << CHECKOUT_HEADING << lastCheckout << "\n"; // create the column titles
+
+	for (unsigned i = 0; i < rules.size(); i++)
+	{
+		if (!rules[i].active)
+			continue;
+
+		const Coupon &coupon = coupons[i];
+		file << coupon.getCode() << "," << (coupon.getType() == percentOff ? "percent" : "flat") << "," << coupon.getAmount() << ","
+			 << coupon.getCategory() << "," << coupon.getMinSpend() << "," << coupon.getMaxRedemptions() << "," << redemptions[i].load() - journaledRedemptions[i].load() << "\n";
+	}
+
+	file.close();
+}
@@ -0,0 +1,63 @@
+#ifndef COUPON_COLLECTION_H
+#define COUPON_COLLECTION_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <unordered_map>
+#include "Coupon.h"
+
+class CouponCollection
+{
+	private:
+		struct CompiledRule
+		{
+			int categoryID;
+			long minSpendCents;
+			long value;
+			int maxRedemptions;
+			bool percent;
+			bool active;
+		};
+
+		std::vector<Coupon> coupons;
+		std::vector<CompiledRule> rules;
+		std::deque<std::atomic<unsigned int>> redemptions;
+		// Redemptions held in the checkout journal rather than the coupon database file
+		std::deque<std::atomic<unsigned int>> journaledRedemptions;
+		// Last journaled checkout whose redemptions are in the coupon database file
+		uint64_t lastCheckout;
+		// Lines of the coupon database file that could not be read, dropped on the next save
+		std::vector<int> malformedLines;
+		std::unordered_map<std::string, int> codeIndex;
+		std::unordered_map<std::string, int> categoryIndex;
+
+		int compile(const Coupon &coupon, unsigned int redeemed);
+
+	public:
+		CouponCollection();
+		~CouponCollection();
+
+		int addCoupon(Coupon coupon);
+		int removeCoupon(std::string code);
+		int findCoupon(std::string code);
+		const Coupon &getCoupon(int handle);
+		unsigned int getRedemptions(int handle);
+		bool isAvailable(int handle);
+
+		int categoryID(const std::string &category);
+		float couponDiscount(int handle, float subtotal, const std::vector<float> &categoryTotals);
+		bool redeem(const std::vector<int> &handles);
+		void release(const std::vector<int> &handles);
+		void applyJournaledRedemptions(const std::vector<std::string> &codes);
+		void checkpointRedemptions(uint64_t checkout);
+		uint64_t getLastCheckout() const;
+		const std::vector<int> &getMalformedLines() const;
+
+		void printCoupons();
+		void saveToDatabase();
+};
+
+#endif
@@ -43,7 +43,7 @@ Order::Order(Product prod, int pDate, int quant)
 /** Overrides == to compare product, quantity, and date
  * @return true iff product bought, quantity bought and date of purchase match, false if not.
  */
-bool Order::operator==(const Order &other)
+bool Order::operator==(const Order &other) const
 {
 	return (product == (other.getProduct()) && this->quantity == other.getQuantity() && this->dateOfPurchase == other.getDate());
 }
@@ -52,25 +52,18 @@ bool Order::operator==(const Order &other)
  * @param other Other order to compare to.
  * @return true iff product bought, quantity bought and date of purchase do not match, false if not.
  */
-bool Order::operator!=(const Order &other)
+bool Order::operator!=(const Order &other) const
 {
 	return (!(product == (other.getProduct())) || !(this->quantity == other.getQuantity()) || !(this->dateOfPurchase == other.getDate()));
 }
 
-/** Overrides == to compare product, quantity, and date
- * @return true iff ANY of the above does not match with the other
+/** Recalculates the total cost of this order from the product's effective (discounted) price and the bulk tier for this order's quantity.
+ *  The discount and bulk reduction are applied one after the other.
+ * @return None.
  */
 void Order::updateCost()
 {
-	float cost = this->product.getPrice();
-	// If there is any discount stuff, calculate it here
-	if (product.getDiscount() != NULL)
-	{
-		//std::cout << product->getDiscount()->getAmount() << "% Discount applied!" << std::endl;
-		this->totalCost = cost * (1 - product.getDiscount()->getAmount()) * this->quantity;
-	}
-	else
-		this->totalCost = cost * this->quantity;
+	this->totalCost = product.getEffectivePrice() * (1 - product.getBulkModifier(this->quantity)) * this->quantity;
 }
 
 /** Gets date of purchase of this order.
@@ -92,7 +85,7 @@ int Order::getQuantity() const
 /** Gets this order's purchased product.
  *  @return Product from this order.
  */
-Product Order::getProduct() const
+const Product &Order::getProduct() const
 {
 	return product;
 }
@@ -100,7 +93,7 @@ Product Order::getProduct() const
 /** Gets total cost of this order.
  *  @return Float value of this order's cost.
  */
-float Order::getTotalCost()
+float Order::getTotalCost() const
 {
 	return this->totalCost;
 }
@@ -15,13 +15,13 @@ class Order {
 		~Order();
 		Order(Product prod, int pDate, int quant);
 		
-		bool operator == (const Order& other);
-		bool operator != (const Order& other);
+		bool operator == (const Order& other) const;
+		bool operator != (const Order& other) const;
 		
 		int getDate() const;
 		int getQuantity() const;
-		Product getProduct() const;
-		float getTotalCost();
+		const Product &getProduct() const;
+		float getTotalCost() const;
 		
 		void updateCost();
 		void setDate(int newDate);
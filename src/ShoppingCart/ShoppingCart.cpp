@@ -9,13 +9,100 @@
 #include <sstream>
 #include <math.h>
 #include "ShoppingCart.h"
+#include <thread>
+#include <chrono>
+#include "CheckoutTransaction.h"
 #include "../PurchaseHistory/PurchaseHistory.h"
 
+constexpr float TAX_RATE = 0.15f;	// Hardcoded tax
+constexpr size_t INVOICE_RESERVE = 4096;
+
+/** Appends an integer to a string without going through a stream.
+ * @param out String to append to.
+ * @param value Integer to write.
+ * @return None.
+ */
+static void appendInt(std::string &out, long value)
+{
+	char digits[24];
+	int count = 0;
+	unsigned long magnitude = value < 0 ? -(unsigned long)value : value;
+
+	do
+	{
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0)
+		out += '-';
+	while (count > 0)
+		out += digits[--count];
+}
+
+/** Appends a dollar amount rounded to the cent, always with two decimals.
+ * @param out String to append to.
+ * @param amount Amount to write.
+ * @return None.
+ */
+static void appendMoney(std::string &out, float amount)
+{
+	long cents = lroundf(amount * 100);
+	if (cents < 0)
+	{
+		out += '-';
+		cents = -cents;
+	}
+	appendInt(out, cents / 100);
+	out += '.';
+	out += char('0' + (cents / 10) % 10);
+	out += char('0' + cents % 10);
+}
+
+/** Appends a fraction as a percentage, dropping trailing zero decimals.
+ * @param out String to append to.
+ * @param rate Fraction to write, e.g. 0.25 for 25%.
+ * @return None.
+ */
+static void appendPercent(std::string &out, float rate)
+{
+	long hundredths = lroundf(rate * 10000);
+	appendInt(out, hundredths / 100);
+	if (hundredths % 100 != 0)
+	{
+		out += '.';
+		out += char('0' + (hundredths / 10) % 10);
+		if (hundredths % 10 != 0)
+			out += char('0' + hundredths % 10);
+	}
+	out += '%';
+}
+
 /** Blank constructor. Creates a ShoppingCart instance.
  * @return None.
  */
 ShoppingCart::ShoppingCart()
 {
+	couponCodes = NULL;
+	subtotal = 0;
+	discountTotal = 0;
+	couponTotal = 0;
+	tax = 0;
+	invoiceBuffer.reserve(INVOICE_RESERVE);
+}
+
+/** Constructor with arguments. Creates a ShoppingCart that accepts coupon codes.
+ * @param codeBase CouponCollection that coupon codes are looked up in.
+ * @return None.
+ */
+ShoppingCart::ShoppingCart(CouponCollection *codeBase)
+{
+	couponCodes = codeBase;
+	subtotal = 0;
+	discountTotal = 0;
+	couponTotal = 0;
+	tax = 0;
+	invoiceBuffer.reserve(INVOICE_RESERVE);
 }
 
 /** Default destructor.
@@ -41,7 +128,59 @@ int ShoppingCart::getSize()
 	return orders.size();
 }
 
+/** Adds or subtracts one order's contribution to the running subtotal, discount and, if a coupon
+ *  targets the order's category, that category's subtotal. Callers follow up with applyCoupons.
+ * @param order Order whose cost is applied.
+ * @param sign 1 to add the order, -1 to take it back out.
+ * @return None.
+ */
+void ShoppingCart::addToTotals(const Order &order, int sign)
+{
+	float listCost = order.getProduct().getPrice() * order.getQuantity();
+	subtotal += sign * order.getTotalCost();
+	discountTotal += sign * (listCost - order.getTotalCost());
+
+	int category = couponCodes != NULL ? couponCodes->categoryID(order.getProduct().getCategory()) : -1;
+	if (category >= 0)
+	{
+		if (category >= (int)categoryTotals.size())
+			categoryTotals.resize(category + 1, 0);
+		categoryTotals[category] += sign * order.getTotalCost();
+	}
+}
+
+/** Re-evaluates the coupons on the cart against the running totals and updates the tax. Costs one rule check per coupon.
+ * @return None.
+ */
+void ShoppingCart::applyCoupons()
+{
+	couponTotal = 0;
+	for (unsigned i = 0; i < appliedCoupons.size(); i++)
+	{
+		couponTotal += couponCodes->couponDiscount(appliedCoupons[i], subtotal, categoryTotals);
+	}
+	if (couponTotal > subtotal)
+		couponTotal = subtotal;
+	tax = (subtotal - couponTotal) * TAX_RATE;
+}
+
+/** Rebuilds the running totals from scratch. Used after every order has been repriced.
+ * @return None.
+ */
+void ShoppingCart::recomputeTotals()
+{
+	subtotal = 0;
+	discountTotal = 0;
+	categoryTotals.assign(categoryTotals.size(), 0);
+	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); ++i)
+	{
+		addToTotals(*i, 1);
+	}
+	applyCoupons();
+}
+
 /** If the Order's product is already in the collection, merge orders. Otherwise adds order to collection.
+* Keeps the running totals up to date.
 * @param add Order to be added to shopping cart.
 * @return None.
 */
@@ -52,26 +191,89 @@ void ShoppingCart::addOrder(Order add)
 	{
 		if (add.getProduct() == i->getProduct())
 		{
+			addToTotals(*i, -1);
 			i->setQuantity(i->getQuantity() + add.getQuantity());
-			i->changeTotalCost(i->getTotalCost() + add.getTotalCost());
+			i->updateCost();
+			addToTotals(*i, 1);
+			applyCoupons();
 			return;
 		}
 	}
 	orders.push_back(add);
+	addToTotals(add, 1);
+	applyCoupons();
 }
 
-/** Removes an order from the shopping cart.
+/** Removes an order from the shopping cart. Keeps the running totals up to date.
  * @param rem Order to be removed.
  * @return None.
 */
 void ShoppingCart::removeOrder(Order rem)
 {
-	orders.remove(rem);
+	for (std::list<Order>::iterator i = orders.begin(); i != orders.end();)
+	{
+		if (*i == rem)
+		{
+			addToTotals(*i, -1);
+			i = orders.erase(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	applyCoupons();
+}
+
+/** Adds a coupon code to the cart. The coupon's discount is kept up to date as the cart changes.
+ * @param code Coupon code as entered by the member.
+ * @return 1 if the coupon was added, 0 if the code is unknown, used up or already on the cart.
+ */
+int ShoppingCart::addCouponCode(std::string code)
+{
+	int handle = couponCodes != NULL ? couponCodes->findCoupon(code) : -1;
+	if (handle == -1)
+	{
+		std::cout << "Coupon code not recognized" << std::endl;
+		return 0;
+	}
+	if (!couponCodes->isAvailable(handle))
+	{
+		std::cout << "This coupon has been fully redeemed" << std::endl;
+		return 0;
+	}
+	for (unsigned i = 0; i < appliedCoupons.size(); i++)
+	{
+		if (appliedCoupons[i] == handle)
+		{
+			std::cout << "This coupon is already applied to your cart" << std::endl;
+			return 0;
+		}
+	}
+
+	appliedCoupons.push_back(handle);
+	// The coupon may target a category the cart was not tracking yet
+	recomputeTotals();
+
+	float saved = couponCodes->couponDiscount(handle, subtotal, categoryTotals);
+	if (saved > 0)
+		std::cout << "Coupon applied, you save $" << roundf(saved * 100) / 100 << std::endl;
+	else
+		std::cout << "Coupon added. Your cart does not qualify for it yet" << std::endl;
+	return 1;
 }
 
-//void ShoppingCart::addCouponCode(std::string code) {
-// Nothing for now until coupons are implemented
-//}
+/** Changes the CouponCollection coupon codes are looked up in. Removes any coupons already on the cart.
+ * @param newCodes CouponCollection to use.
+ * @return None.
+ */
+void ShoppingCart::updateCouponCollection(CouponCollection *newCodes)
+{
+	couponCodes = newCodes;
+	appliedCoupons.clear();
+	categoryTotals.clear();
+	recomputeTotals();
+}
 
 /** Calls Order::updateCost on every Order in the collection. Uses the new cost in the associated Product.
  * @return None.
@@ -82,25 +284,28 @@ void ShoppingCart::updateCosts()
 	{
 		(*i).updateCost();
 	}
+	recomputeTotals();
 }
 
 /**
 * Processes cart for issues, (not enough funds, not enough stock). If no issues are found, 
 * 				checkouts items in cart by removing their quantity from stock and subtracts the total price from 
-*			   the provided member's balance. 
+*			   the provided member's balance. Runs as an optimistic CheckoutTransaction against the live catalog,
+*			   retrying with backoff if a product changes between the read and the commit.
+*			   The stock, balance and history changes are recorded together as one journal record.
 * @param buyer Member* who is making the purchase.
 * @param productC ProductCollection to apply changes to.
 * @param histC PurchaseHistoryCollection that records cart upon succesful purchase.
+* @param journal CheckoutJournal the checkout is committed to.
 * @return 0 on failure, 1 or higher on success.
 */
-int ShoppingCart::processCart(Member *buyer, ProductCollection &productC, PurchaseHistoryCollection &histC)
+int ShoppingCart::processCart(Member *buyer, ProductCollection &productC, PurchaseHistoryCollection &histC, CheckoutJournal &journal)
 {
-	float grandPrice = 0.0;
-	const float tax = 0.15;
-	bool verified = true;
 	std::ostringstream purchased;
 	std::cout << std::endl;
 
+	updateCosts();
+
 	std::cout << this->printCart() << std::endl
 			  << std::endl
 			  << "Please review your cart above. Enter 'Y' if you would like to process your cart, Enter 'N' to cancel." << std::endl;
@@ -130,113 +335,207 @@ int ShoppingCart::processCart(Member *buyer, ProductCollection &productC, Purcha
 		break;
 	}
 
-	// Scan list for any issues - ex: low funds, low stock, etc
-	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); i++)
+	// Optimistic checkout: read the live catalog, validate, and commit only if nothing changed since the read.
+	// A conflicting change makes the attempt retry after a short, growing backoff.
+	const int maxAttempts = 5;
+	bool committed = false;
+	uint64_t checkout = 0;
+	time_t date = time(NULL);
+
+	for (int attempt = 0; attempt < maxAttempts && !committed; attempt++)
 	{
-		grandPrice += i->getTotalCost();
-		if (i->getQuantity() > i->getProduct().getQuantity())
+		if (attempt > 0)
 		{
-			verified = false;
-			std::cerr << "Low Stock: You attempted to purchase: " << i->getProduct().getName() << " x " << i->getQuantity() << ", only have " << i->getProduct().getQuantity() << " in stock.\n";
+			std::this_thread::sleep_for(std::chrono::milliseconds(1 << attempt));
+		}
+
+		CheckoutTransaction transaction(TAX_RATE);
+		transaction.read(productC, orders);
+		recomputeTotals();
+		transaction.applyDeduction(couponTotal);
+
+		if (!transaction.validate(buyer))
+		{
+			std::cout << "Checkout failed. \n";
+			std::cout << "Press Enter to Continue" << std::endl;
+			std::cin.ignore();
+			return 0;
+		}
+
+		// Only coupons that take something off this cart use up a redemption
+		std::vector<int> usedCoupons;
+		std::vector<std::string> usedCodes;
+		for (unsigned c = 0; c < appliedCoupons.size(); c++)
+		{
+			if (couponCodes->couponDiscount(appliedCoupons[c], subtotal, categoryTotals) > 0)
+			{
+				usedCoupons.push_back(appliedCoupons[c]);
+				usedCodes.push_back(couponCodes->getCoupon(appliedCoupons[c]).getCode());
+			}
+		}
+
+		if (!usedCoupons.empty() && !couponCodes->redeem(usedCoupons))
+		{
+			std::cout << "Checkout failed: a coupon on your cart is no longer available. \n";
+			std::cout << "Press Enter to Continue" << std::endl;
+			std::cin.ignore();
+			return 0;
+		}
+
+		committed = transaction.commit(productC, buyer, journal, date, usedCodes, orders);
+		checkout = transaction.getCheckout();
+		if (!committed && !usedCoupons.empty())
+		{
+			couponCodes->release(usedCoupons);
 		}
 	}
-	grandPrice += grandPrice * tax;
-	if (grandPrice > buyer->getCurrency())
-	{
-		verified = false;
-		std::cerr << "Low user funds: Cart total is $" << grandPrice << ", while User has balance of $" << buyer->getCurrency() << "\n";
-	}
+	recomputeTotals();
 
-	// Continue with checkout ONLY if verified (no issues)
-	if (!verified)
+	if (!committed)
 	{
-		std::cout << "Checkout failed. \n";
+		std::cout << "Checkout failed: the catalog changed while your order was being processed. \n";
 		std::cout << "Press Enter to Continue" << std::endl;
 		std::cin.ignore();
 		return 0;
 	}
-	purchased << "Purchased items: ";
 
-	std::string orderID;
-	int reduced;
-
-	Product test;
+	purchased << "Purchased items: ";
 	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); ++i)
 	{
-
-		orderID = i->getProduct().getID();
-
-		for (unsigned x = 0; x < productC.getProductList().size(); x++)
-		{
-
-			if (orderID == productC.getProductList().at(x).getID())
-			{
-				reduced = ((productC.getProductList().at(x).getQuantity()) - (i->getQuantity()));
-				productC.changeInventory(productC.getProductList().at(x), reduced);
-			}
-		}
-
 		purchased << i->getProduct().getName() << " x " << i->getQuantity() << ", ";
 	}
 
-	buyer->modifyBalance(-grandPrice); // Add balance as negative float
 	std::string purchasedItems = purchased.str();
 	std::cout << "Checkout success!\n"
 			  << purchasedItems.substr(0, purchasedItems.length() - 2) << "\n";
 			  
-	// Send a copy of the order list to the history collection
-	PurchaseHistory hist = PurchaseHistory(orders, buyer->getID());
-	histC.addPurchaseHistory(hist);
+	// Send a copy of the order list to the history collection, stamped with the journaled date and checkout number
+	PurchaseHistory hist = PurchaseHistory(orders, buyer->getID(), date);
+	histC.addPurchaseHistory(hist, checkout);
 
 	return 1;
 }
 
-/** Prints contents of cart and price
-* @return A string containing name, amount, totalCost of all Orders and grand total of Orders at end.
-*/
-std::string ShoppingCart::printCart()
+/** Gets the running subtotal of the cart, after per-product discounts and before tax.
+ * @return Float value of the subtotal.
+ */
+float ShoppingCart::getSubtotal()
 {
-	std::ostringstream invoice;
-	float grandCost = 0;
-	float tax;
+	return subtotal;
+}
 
+/** Gets the running amount saved by discounts on the cart.
+ * @return Float value of the discount total.
+ */
+float ShoppingCart::getDiscountTotal()
+{
+	return discountTotal;
+}
+
+/** Gets the running amount taken off the cart by coupons.
+ * @return Float value of the coupon total.
+ */
+float ShoppingCart::getCouponTotal()
+{
+	return couponTotal;
+}
+
+/** Gets the running tax owed on the cart.
+ * @return Float value of the tax.
+ */
+float ShoppingCart::getTax()
+{
+	return tax;
+}
+
+/** Appends one line per order to the invoice buffer.
+ * @param showDiscounts True to break out the pre-discount total and discount rate of discounted lines.
+ * @return None.
+ */
+void ShoppingCart::renderLines(bool showDiscounts)
+{
 	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); i++)
 	{
-		i->updateCost();
-		if (i->getProduct().getDiscount() != NULL)
+		const Product &product = i->getProduct();
+		invoiceBuffer += "Product: ";
+		invoiceBuffer += product.getName();
+		invoiceBuffer += ", Amount: ";
+		appendInt(invoiceBuffer, i->getQuantity());
+		float bulk = product.getBulkModifier(i->getQuantity());
+		float discount = product.getDiscountRate();
+		if (showDiscounts && (discount > 0 || bulk > 0))
 		{
-			invoice << "Product: " << i->getProduct().getName() << ", Amount: " << (i->getQuantity()) << ", Total: $" << i->getQuantity() * i->getProduct().getPrice() << "\nDiscount: " << i->getProduct().getDiscount()->getAmount() * 100 << "%, Total Cost: $" << (i->getTotalCost()) << "\n";
-		}
-		else
-		{
-			invoice << "Product: " << i->getProduct().getName() << ", Amount: " << (i->getQuantity()) << ", Total Cost: $" << (i->getTotalCost()) << "\n";
+			invoiceBuffer += ", Total: $";
+			appendMoney(invoiceBuffer, i->getQuantity() * product.getPrice());
+			invoiceBuffer += "\n";
+			if (discount > 0)
+			{
+				invoiceBuffer += "Discount: ";
+				appendPercent(invoiceBuffer, discount);
+				invoiceBuffer += bulk > 0 ? ", " : "";
+			}
+			if (bulk > 0)
+			{
+				invoiceBuffer += "Bulk: ";
+				appendPercent(invoiceBuffer, bulk);
+			}
 		}
-		grandCost += i->getTotalCost();
+		invoiceBuffer += ", Total Cost: $";
+		appendMoney(invoiceBuffer, i->getTotalCost());
+		invoiceBuffer += '\n';
 	}
-
-	tax = grandCost * 0.15; // Hardcoded tax
-	invoice << "\nSubtotal: $" << grandCost << "\nTax: $" << roundf(tax * 100) / 100 << "\nTotal: $" << roundf((grandCost + tax) * 100) / 100 << "\n";
-	return "----------------- Shopping Cart -----------------:\n" + invoice.str();
 }
-/** Creates an invoice of the contained Orders.
- * @return A string invoice, containing name, amount, totalCost of all Orders and grand total of Orders at end.
+
+/** Appends the subtotal, discount, tax and total lines to the invoice buffer.
+ * @return None.
  */
-std::string ShoppingCart::createInvoice()
+void ShoppingCart::renderTotals()
 {
-	std::ostringstream invoice;
-	float grandCost = 0;
-	float tax;
-
-	for (std::list<Order>::iterator i = orders.begin(); i != orders.end(); i++)
+	invoiceBuffer += "\nSubtotal: $";
+	appendMoney(invoiceBuffer, subtotal);
+	if (discountTotal > 0.005f)
 	{
-		i->updateCost();
-		invoice << "Product: " << i->getProduct().getName() << ", Amount: " << (i->getQuantity()) << ", Total Cost: $" << (i->getTotalCost()) << "\n";
-		grandCost += i->getTotalCost();
+		invoiceBuffer += "\nYou Saved: $";
+		appendMoney(invoiceBuffer, discountTotal);
+	}
+	for (unsigned i = 0; i < appliedCoupons.size(); i++)
+	{
+		invoiceBuffer += "\nCoupon ";
+		invoiceBuffer += couponCodes->getCoupon(appliedCoupons[i]).getCode();
+		invoiceBuffer += ": -$";
+		appendMoney(invoiceBuffer, couponCodes->couponDiscount(appliedCoupons[i], subtotal, categoryTotals));
 	}
+	invoiceBuffer += "\nTax: $";
+	appendMoney(invoiceBuffer, tax);
+	invoiceBuffer += "\nTotal: $";
+	appendMoney(invoiceBuffer, subtotal - couponTotal + tax);
+	invoiceBuffer += '\n';
+}
 
-	tax = grandCost * 0.15; // Hardcoded tax
-	invoice << "\nSubtotal: $" << grandCost << "\nTax: $" << roundf(tax * 100) / 100 << "\nTotal: $" << roundf((grandCost + tax) * 100) / 100 << "\nPaid: $" << roundf((grandCost + tax) * 100) / 100 << "\nOwed: $0\n";
-	return "Invoice:\n" + invoice.str();
+/** Prints contents of cart and price. Renders into a reused buffer from the running totals, without repricing.
+* @return A string containing name, amount, totalCost of all Orders and grand total of Orders at end. Valid until the cart is next rendered.
+*/
+const std::string &ShoppingCart::printCart()
+{
+	invoiceBuffer.clear();
+	invoiceBuffer += "----------------- Shopping Cart -----------------:\n";
+	renderLines(true);
+	renderTotals();
+	return invoiceBuffer;
+}
+/** Creates an invoice of the contained Orders. Renders into a reused buffer from the running totals, without repricing.
+ * @return A string invoice, containing name, amount, totalCost of all Orders and grand total of Orders at end. Valid until the cart is next rendered.
+ */
+const std::string &ShoppingCart::createInvoice()
+{
+	invoiceBuffer.clear();
+	invoiceBuffer += "Invoice:\n";
+	renderLines(false);
+	renderTotals();
+	invoiceBuffer += "Paid: $";
+	appendMoney(invoiceBuffer, subtotal - couponTotal + tax);
+	invoiceBuffer += "\nOwed: $0\n";
+	return invoiceBuffer;
 }
 
 /** Clears the list of orders in shopping cart.
@@ -245,6 +544,12 @@ std::string ShoppingCart::createInvoice()
 void ShoppingCart::clearOrders()
 {
 	orders.clear();
+	appliedCoupons.clear();
+	categoryTotals.clear();
+	subtotal = 0;
+	discountTotal = 0;
+	couponTotal = 0;
+	tax = 0;
 }
 
 /** Command line interface for removing an order.
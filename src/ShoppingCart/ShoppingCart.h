@@ -5,18 +5,32 @@
 #include <list>
 #include "Order.h"
 #include "../Login/Member.h"
-//#include "CouponCollection"
+#include "CouponCollection.h"
+#include "CheckoutJournal.h"
 #include "../Product/ProductCollection.h"
 #include "../PurchaseHistory/PurchaseHistoryCollection.h"
 #include <vector>
 class ShoppingCart {
 	private:
 		std::list<Order> orders;
-		//CouponCollection couponCodes;
+		CouponCollection *couponCodes;
+		std::vector<int> appliedCoupons;
+		std::vector<float> categoryTotals;
+		float subtotal;
+		float discountTotal;
+		float couponTotal;
+		float tax;
+		std::string invoiceBuffer;
+
+		void addToTotals(const Order &order, int sign);
+		void recomputeTotals();
+		void applyCoupons();
+		void renderLines(bool showDiscounts);
+		void renderTotals();
 		
 	public:
 		ShoppingCart();
-		//ShoppingCart(CouponCollection codeBase);
+		ShoppingCart(CouponCollection *codeBase);
 		~ShoppingCart();
 		void clearOrders();
 		void removeOrder(Order rem);
@@ -25,11 +39,15 @@ class ShoppingCart {
 		int getSize();
 		
 		void updateCosts();
-		void addCouponCode(std::string code);
-		//void updateCouponCollection(CouponCollection newCodes);
-		std::string createInvoice();
-		int processCart(Member* buyer, ProductCollection &productC, PurchaseHistoryCollection &histC);
-		std::string printCart();
+		int addCouponCode(std::string code);
+		void updateCouponCollection(CouponCollection *newCodes);
+		float getSubtotal();
+		float getDiscountTotal();
+		float getCouponTotal();
+		float getTax();
+		const std::string &createInvoice();
+		int processCart(Member* buyer, ProductCollection &productC, PurchaseHistoryCollection &histC, CheckoutJournal &journal);
+		const std::string &printCart();
 		int removeOrderInterface();
 };
 
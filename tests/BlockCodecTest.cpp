@@ -0,0 +1,109 @@
+/** \file BlockCodecTest.cpp
+ * \brief Round trips data through BlockCodec and the block streams built on it.
+ * \details Covers input with nothing to match, long runs whose match lengths need extra length bytes, overlapping
+ * matches, and streams that span several blocks. Damaged input must be refused rather than read past.
+ */
+
+#include <string>
+#include <vector>
+#include <limits>
+#include "Check.h"
+#include "PurchaseHistory/BlockCodec.h"
+
+/** Compresses data and checks that it decompresses to the same bytes.
+ * @param raw Data to compress.
+ * @return Size of the compressed data.
+ */
+static size_t roundTrip(const std::string &raw) {
+	std::string packed;
+	BlockCodec::compress(raw.data(), raw.size(), packed);
+	std::string unpacked(raw.size(), '\0');
+	CHECK(BlockCodec::decompress(packed.data(), packed.size(), &unpacked[0], unpacked.size()));
+	CHECK(unpacked == raw);
+	return packed.size();
+}
+
+/** Builds bytes from a fixed pseudo-random sequence, which leave nothing to match.
+ * @param size Number of bytes.
+ * @return The bytes.
+ */
+static std::string noise(size_t size) {
+	std::string bytes(size, '\0');
+	uint32_t state = 7;
+	for(size_t i = 0; i < size; i++) {
+		state = state * 1103515245 + 12345;
+		bytes[i] = (char)(state >> 16);
+	}
+	return bytes;
+}
+
+int main() {
+	// Single blocks
+	roundTrip("");
+	roundTrip("abc");
+	roundTrip(noise(5000));
+	CHECK(roundTrip(std::string(60000, 'x')) < 1000);
+	CHECK(roundTrip(std::string(300, 'a') + noise(40) + std::string(300, 'a')) < 200);
+	std::string lines;
+	for(int i = 0; i < 2000; i++)
+		lines += "L,p" + std::to_string(i % 37) + ",2,1.25,0,2.5\n";
+	CHECK(roundTrip(lines) < lines.size() / 4);
+
+	// A block refuses a wrong size and a cut-off copy
+	{
+		std::string raw = lines.substr(0, 4000);
+		std::string packed;
+		BlockCodec::compress(raw.data(), raw.size(), packed);
+		std::string unpacked(raw.size() + 1, '\0');
+		CHECK(!BlockCodec::decompress(packed.data(), packed.size(), &unpacked[0], raw.size() + 1));
+		CHECK(!BlockCodec::decompress(packed.data(), packed.size() / 2, &unpacked[0], raw.size()));
+	}
+
+	// Streams of several blocks
+	{
+		const std::string big = noise(150000) + std::string(100000, 'z');
+		std::string stream;
+		BlockWriter writer(stream);
+		writer.writeVarint(0);
+		writer.writeVarint(127);
+		writer.writeVarint(128);
+		writer.writeVarint(std::numeric_limits<uint64_t>::max());
+		writer.writeSigned(-1);
+		writer.writeSigned(std::numeric_limits<int64_t>::min());
+		writer.writeSigned(std::numeric_limits<int64_t>::max());
+		writer.writeString("");
+		writer.writeString(big);
+		uint32_t tail = 0xdeadbeef;
+		writer.write(&tail, sizeof(tail));
+		writer.finish();
+
+		BlockReader reader(stream.data(), stream.size());
+		uint64_t u;
+		int64_t s;
+		std::string text;
+		CHECK(reader.readVarint(u) && u == 0);
+		CHECK(reader.readVarint(u) && u == 127);
+		CHECK(reader.readVarint(u) && u == 128);
+		CHECK(reader.readVarint(u) && u == std::numeric_limits<uint64_t>::max());
+		CHECK(reader.readSigned(s) && s == -1);
+		CHECK(reader.readSigned(s) && s == std::numeric_limits<int64_t>::min());
+		CHECK(reader.readSigned(s) && s == std::numeric_limits<int64_t>::max());
+		CHECK(reader.readString(text) && text.empty());
+		CHECK(reader.readString(text) && text == big);
+		uint32_t readTail = 0;
+		CHECK(reader.read(&readTail, sizeof(readTail)) && readTail == tail);
+		// The end of the stream
+		CHECK(!reader.readVarint(u));
+
+		// A stream cut short ends early instead of reading past its end
+		BlockReader cut(stream.data(), stream.size() / 2);
+		for(int i = 0; i < 4; i++)
+			CHECK(cut.readVarint(u));
+		for(int i = 0; i < 3; i++)
+			CHECK(cut.readSigned(s));
+		CHECK(cut.readString(text) && text.empty());
+		CHECK(!cut.readString(text));
+	}
+
+	return checkResult("BlockCodecTest");
+}
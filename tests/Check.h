@@ -0,0 +1,31 @@
+/** \file Check.h
+ * \brief Minimal assertions for the test programs.
+ * \details Each test program is built against every object file but Main.o and run by "make test" in an empty
+ * directory of its own, so the databases it writes start out empty. A failed check prints where it is and the
+ * program carries on, exiting with the number of checks that failed.
+ */
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if(!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+			checkFailures++; \
+		} \
+	} while(0)
+
+/** Reports the outcome of a test program.
+ * @param name Name of the test program.
+ * @return Exit status, 0 if every check passed.
+ */
+static int checkResult(const char *name) {
+	std::cout << name << ": " << (checkFailures == 0 ? "passed" : "FAILED") << "\n";
+	return checkFailures;
+}
+
+#endif
@@ -0,0 +1,174 @@
+/** \file CheckoutJournalTest.cpp
+ * \brief Replays the checkout journal after a simulated crash.
+ * \details A crash is simulated by dropping the collections without saving them or emptying the journal, which
+ * leaves the files as a killed process would, since every journal record and history log record is on disk as
+ * soon as it is written. A crash at exit, after some databases are saved and before the journal is emptied, must
+ * leave every checkout applied exactly once to each database.
+ */
+
+#include <fstream>
+#include <unistd.h>
+#include "Check.h"
+#include "ShoppingCart/CheckoutJournal.h"
+#include "Login/UserDBConversion.h"
+
+constexpr auto JOURNAL = "checkout.log";
+constexpr auto CRASH_USER = "crashtest";
+constexpr auto CRASH_PASSWORD = "Crash#Test1";
+
+/** Builds the orders of a checkout of one product.
+ * @param id Unique ID of the product.
+ * @param quantity Units bought.
+ * @return The orders.
+ */
+static std::list<Order> basket(const std::string &id, int quantity) {
+	Product product("Product " + id, "Test", id, 2.5, 0);
+	Order order(product, 0, quantity);
+	order.changeTotalCost(2.5 * quantity);
+	return std::list<Order>(1, order);
+}
+
+/** Counts the histories of a member that are not deleted.
+ * @param histC Collection to look in.
+ * @param memberID Unique ID of the member.
+ * @return Number of histories.
+ */
+static size_t historiesOf(PurchaseHistoryCollection &histC, int memberID) {
+	return histC.getHistoriesByID(memberID).size();
+}
+
+/** Starts up as Main does and checks that the one checkout of the crash test member is applied exactly once to
+ * every database, then saves them all as a clean exit does but crashes before the journal is emptied.
+ * @return None.
+ */
+static void restartAfterExitCrash() {
+	UserDBConversion converter;
+	std::unordered_map<std::string, std::pair<std::string, Member>> map = converter.FileToLoginCollection();
+	LoginCollection members;
+	members.setCollection(map, converter.getHighestID());
+	members.setLastCheckout(converter.getLastCheckout());
+	Login login(members);
+	ProductCollection stock;
+	CouponCollection coupons;
+	PurchaseHistoryCollection histC;
+	CheckoutJournal journal(JOURNAL);
+	journal.replay(stock, login, coupons, histC);
+
+	Member *member = login.checkLogin(CRASH_USER, CRASH_PASSWORD);
+	CHECK(member != NULL);
+	if(member == NULL)
+		return;
+	CHECK(member->getCurrency() == 15);
+	CHECK(stock.at(stock.findProduct("x")).getQuantity() == 8);
+	CHECK(coupons.getRedemptions(coupons.findCoupon("CRASH")) == 1);
+	CHECK(historiesOf(histC, member->getID()) == 1);
+
+	uint64_t checkout = journal.getLastCheckout();
+	map = login.getLoginCollection().getMap();
+	converter.LoginCollectionToFile(map, checkout);
+	stock.checkpointStock(checkout);
+	coupons.checkpointRedemptions(checkout);
+}
+
+int main() {
+	const time_t now = time(NULL);
+	ProductCollection products;
+	Login login;
+	CouponCollection coupons;
+	const std::vector<std::string> noCoupons;
+
+	// Two checkouts by one member in the same second, and the history of the second never logged
+	{
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 0);
+
+		uint64_t first = journal.append(7, now, -5, noCoupons, basket("a", 2));
+		uint64_t second = journal.append(7, now, -2.5, noCoupons, basket("b", 1));
+		CHECK(first == 1);
+		CHECK(second == 2);
+		histC.addPurchaseHistory(PurchaseHistory(basket("a", 2), 7, now), first);
+		CHECK(historiesOf(histC, 7) == 1);
+	}
+
+	// The first checkout is already in the history log, the second is only in the journal
+	{
+		PurchaseHistoryCollection histC;
+		CHECK(histC.getLastCheckout() == 1);
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 2);
+		CHECK(historiesOf(histC, 7) == 2);
+		CHECK(histC.getLastCheckout() == 2);
+
+		// Numbering carries on from the journal
+		CHECK(journal.append(8, now, -2.5, noCoupons, basket("c", 1)) == 3);
+	}
+
+	// A record torn by the crash is cut off, the complete ones before it are kept
+	{
+		std::ofstream journalFile(JOURNAL, std::ios::app);
+		journalFile << "C,4,8," << now << ",-2.5,0,1,c,Product c,Test,2.5";
+	}
+	{
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 3);
+		CHECK(historiesOf(histC, 7) == 2);
+		CHECK(historiesOf(histC, 8) == 1);
+		CHECK(journal.append(8, now + 1, -2.5, noCoupons, basket("c", 1)) == 4);
+		histC.addPurchaseHistory(PurchaseHistory(basket("c", 1), 8, now + 1), 4);
+
+		// A clean exit saves the history and empties the journal
+		histC.saveToDatabase();
+		journal.truncate();
+	}
+
+	// Numbering carries on from the history log once the journal is empty
+	{
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 0);
+		CHECK(histC.getLastCheckout() == 4);
+		CHECK(journal.append(9, now, -2.5, noCoupons, basket("d", 1)) == 5);
+		CHECK(historiesOf(histC, 8) == 2);
+	}
+
+	// A checkout by a member with a balance, of a stocked product, with a coupon
+	{
+		LoginCollection members;
+		CHECK(members.addMember(CRASH_USER, CRASH_PASSWORD, "Crash", "Test", false, "Regular") == 0);
+		members.findMember(CRASH_USER, CRASH_PASSWORD)->modifyBalance(20);
+		UserDBConversion converter;
+		std::unordered_map<std::string, std::pair<std::string, Member>> map = members.getMap();
+		converter.LoginCollectionToFile(map, 0);
+		Login crashLogin(members);
+		ProductCollection stock;
+		stock.addProduct(Product("Product x", "Test", "x", 2.5, 10));
+		stock.saveToDatabase();
+		CouponCollection crashCoupons;
+		CHECK(crashCoupons.addCoupon(Coupon("CRASH", flatOff, 1, "", 0, 0)) == 0);
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		journal.replay(stock, crashLogin, crashCoupons, histC);
+
+		Member *member = crashLogin.checkLogin(CRASH_USER, CRASH_PASSWORD);
+		uint64_t checkout = journal.append(member->getID(), now + 2, -5, std::vector<std::string>(1, "CRASH"), basket("x", 2));
+		CHECK(checkout != 0);
+		stock.applyJournaledStock("x", -2);
+		member->modifyBalance(-5);
+		CHECK(crashCoupons.redeem(std::vector<int>(1, crashCoupons.findCoupon("CRASH"))));
+		histC.addPurchaseHistory(PurchaseHistory(basket("x", 2), member->getID(), now + 2), checkout);
+
+		// Exit saves the members and products, then crashes before the coupons are saved
+		map = crashLogin.getLoginCollection().getMap();
+		converter.LoginCollectionToFile(map, journal.getLastCheckout());
+		stock.checkpointStock(journal.getLastCheckout());
+	}
+
+	// The checkout is only replayed into the coupons, then exit saves everything and crashes before emptying the journal
+	restartAfterExitCrash();
+	// Every database already holds the checkout
+	restartAfterExitCrash();
+
+	return checkResult("CheckoutJournalTest");
+}
@@ -0,0 +1,146 @@
+/** \file CoPurchaseMatrixTest.cpp
+ * \brief Checks the co-purchase counts kept up to date history by history against counts rebuilt from scratch.
+ * \details Ties between equal counts may be kept in a different order, so only the counts of the kept partners are
+ * compared, and each kept partner's count is checked against a count made by going through every history.
+ */
+
+#include <unistd.h>
+#include "Check.h"
+#include "PurchaseHistory/PurchaseHistoryCollection.h"
+
+constexpr int PRODUCTS = 12;
+constexpr int HISTORIES = 300;
+
+/** Gets the next number of a fixed pseudo-random sequence, so every run buys the same baskets.
+ * @param state Current state of the sequence.
+ * @return The next number.
+ */
+static uint32_t nextRandom(uint32_t &state) {
+	state = state * 1103515245 + 12345;
+	return (state >> 16) & 0x7fff;
+}
+
+/** Builds the orders of a history of a few products, some of them bought twice over.
+ * @param state Current state of the pseudo-random sequence.
+ * @return The orders.
+ */
+static std::list<Order> randomBasket(uint32_t &state) {
+	std::list<Order> orders;
+	int lines = 1 + nextRandom(state) % 5;
+	for(int i = 0; i < lines; i++) {
+		// Low product numbers are bought more often, so counts differ and some rows hold more than TOP_KEPT
+		int number = nextRandom(state) % PRODUCTS;
+		number = number * (int)(nextRandom(state) % PRODUCTS) / PRODUCTS;
+		std::string id = "p" + std::to_string(number);
+		Product product("Product " + id, "Test", id, 1, 0);
+		Order order(product, 0, 1);
+		order.changeTotalCost(1);
+		orders.push_back(order);
+	}
+	return orders;
+}
+
+/** Counts the histories that hold both of two products by going through every history.
+ * @param store Store holding the histories. Deleted histories are left out.
+ * @param first Unique ID of one product.
+ * @param second Unique ID of the other product.
+ * @return Number of histories holding both.
+ */
+static uint32_t sharedHistories(const HistoryStore &store, const std::string &first, const std::string &second) {
+	uint32_t shared = 0;
+	for(uint32_t r = 0; r < store.records(); r++) {
+		if(store.isDeleted(r))
+			continue;
+		bool hasFirst = false, hasSecond = false;
+		for(uint32_t l = store.firstLine(r); l < store.endLine(r); l++) {
+			const std::string &id = store.getProduct(store.productColumn()[l]).id;
+			hasFirst = hasFirst || id == first;
+			hasSecond = hasSecond || id == second;
+		}
+		if(hasFirst && hasSecond)
+			shared++;
+	}
+	return shared;
+}
+
+/** Compares the kept partners of every product in two matrices and against the histories themselves.
+ * @param kept Matrix kept up to date history by history.
+ * @param store Store holding every history the matrices count.
+ * @return None.
+ */
+static void checkMatches(const CoPurchaseMatrix &kept, const HistoryStore &store) {
+	CoPurchaseMatrix rebuilt;
+	rebuilt.rebuild(store);
+	for(int p = 0; p < PRODUCTS; p++) {
+		std::string id = "p" + std::to_string(p);
+		std::vector<CoPurchase> actual = kept.topPartners(id, CoPurchaseMatrix::TOP_KEPT);
+		std::vector<CoPurchase> expected = rebuilt.topPartners(id, CoPurchaseMatrix::TOP_KEPT);
+		CHECK(actual.size() == expected.size());
+		for(size_t i = 0; i < actual.size() && i < expected.size(); i++) {
+			CHECK(actual[i].baskets == expected[i].baskets);
+			CHECK(actual[i].baskets == sharedHistories(store, id, actual[i].productID));
+		}
+	}
+}
+
+int main() {
+	const time_t start = time(NULL) - 3 * 24 * 60 * 60;
+	uint32_t state = 1;
+
+	// Counts raised and lowered one history at a time, on a store of their own
+	{
+		HistoryStore store;
+		CoPurchaseMatrix kept;
+		for(int i = 0; i < HISTORIES; i++) {
+			PurchaseHistory history(randomBasket(state), i % 7, start + i * 60);
+			CHECK(store.add(history, i + 1));
+			kept.addBasket(store, store.records() - 1);
+		}
+		checkMatches(kept, store);
+
+		// Lowering a kept count makes the row be ranked again
+		for(uint32_t r = 0; r < store.records(); r += 3) {
+			kept.removeBasket(store, r);
+			store.markDeleted(r);
+		}
+		checkMatches(kept, store);
+	}
+
+	// Counts built from the segment files in the background, with histories added and deleted meanwhile
+	{
+		PurchaseHistoryCollection histC;
+		uint64_t checkout = 0;
+		for(int i = 0; i < HISTORIES; i++)
+			histC.addPurchaseHistory(PurchaseHistory(randomBasket(state), i % 7, start + i * 60), ++checkout);
+		histC.compact();
+		histC.waitForCompaction();
+
+		// Histories the segment files do not hold yet
+		for(int i = HISTORIES; i < HISTORIES + 40; i++)
+			histC.addPurchaseHistory(PurchaseHistory(randomBasket(state), i % 7, start + i * 60), ++checkout);
+		for(int i = 0; i < HISTORIES + 40; i += 11)
+			histC.deletePurchaseHistory(i % 7, start + i * 60);
+
+		// The first call writes every history to the segment files and returns no counts
+		CHECK(histC.getCoPurchases().topPartners("p0", CoPurchaseMatrix::TOP_KEPT).empty());
+		for(int i = HISTORIES + 40; i < HISTORIES + 60; i++)
+			histC.addPurchaseHistory(PurchaseHistory(randomBasket(state), i % 7, start + i * 60), ++checkout);
+		histC.deletePurchaseHistory(1, start + 1 * 60);
+
+		int waits = 0;
+		while(histC.getCoPurchases().topPartners("p0", CoPurchaseMatrix::TOP_KEPT).empty() && waits++ < 500)
+			usleep(10000);
+		CHECK(waits < 500);
+
+		// Once built, the counts are kept up to date directly
+		for(int i = HISTORIES + 60; i < HISTORIES + 80; i++)
+			histC.addPurchaseHistory(PurchaseHistory(randomBasket(state), i % 7, start + i * 60), ++checkout);
+		histC.deletePurchaseHistory(2, start + 2 * 60);
+
+		// Loading every history lets them be counted from scratch
+		histC.viewAllHistories();
+		checkMatches(histC.getCoPurchases(), histC.getStore());
+	}
+
+	return checkResult("CoPurchaseMatrixTest");
+}
@@ -0,0 +1,95 @@
+/** \file CouponRedemptionTest.cpp
+ * \brief Restores coupon redemptions from the checkout journal after a simulated crash.
+ * \details A crash is simulated by dropping the collections without saving them or emptying the journal. Rows of
+ * the coupon file that cannot be read are skipped rather than stopping the load.
+ */
+
+#include <fstream>
+#include "Check.h"
+#include "ShoppingCart/CheckoutJournal.h"
+
+constexpr auto JOURNAL = "checkout.log";
+
+/** Reads the redemption count of a coupon from the coupon database file.
+ * @param code Code of the coupon.
+ * @return Redemption count saved for the coupon, -1 if the file has no such coupon.
+ */
+static int savedRedemptions(const std::string &code) {
+	CouponCollection coupons;
+	int handle = coupons.findCoupon(code);
+	return handle == -1 ? -1 : (int)coupons.getRedemptions(handle);
+}
+
+int main() {
+	const time_t now = time(NULL);
+	ProductCollection products;
+	Login login;
+	Product product("Snack", "Food", "snk", 4, 0);
+	Order order(product, 0, 1);
+	order.changeTotalCost(4);
+	const std::list<Order> orders(1, order);
+
+	// A single-use coupon is redeemed and journaled, then the coupon file is saved for another reason
+	{
+		CouponCollection coupons;
+		CHECK(coupons.addCoupon(Coupon("ONCE", flatOff, 1, "", 0, 1)) == 0);
+		int handle = coupons.findCoupon("ONCE");
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 0);
+
+		CHECK(coupons.redeem(std::vector<int>(1, handle)));
+		CHECK(journal.append(1, now, -3, std::vector<std::string>(1, "ONCE"), orders) == 1);
+		CHECK(!coupons.isAvailable(handle));
+		coupons.saveToDatabase();
+		CHECK(savedRedemptions("ONCE") == 0);
+	}
+
+	// After the crash the journal redeems the coupon again, so it stays used up
+	{
+		CouponCollection coupons;
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 1);
+		int handle = coupons.findCoupon("ONCE");
+		CHECK(coupons.getRedemptions(handle) == 1);
+		CHECK(!coupons.isAvailable(handle));
+		CHECK(!coupons.redeem(std::vector<int>(1, handle)));
+
+		// A clean exit folds the redemption into the file and empties the journal
+		coupons.checkpointRedemptions(journal.getLastCheckout());
+		journal.truncate();
+		CHECK(savedRedemptions("ONCE") == 1);
+	}
+
+	// Nothing left to replay, the count comes from the file alone
+	{
+		CouponCollection coupons;
+		PurchaseHistoryCollection histC;
+		CheckoutJournal journal(JOURNAL);
+		CHECK(journal.replay(products, login, coupons, histC) == 0);
+		CHECK(coupons.getRedemptions(coupons.findCoupon("ONCE")) == 1);
+	}
+
+	// Rows that cannot be read are skipped and counted, the others still load
+	{
+		std::ofstream couponFile("coupons.csv", std::ios::app);
+		couponFile << "BADAMOUNT,flat,abc,,0,0,0\n";
+		couponFile << "SHORT,flat,1\n";
+		couponFile << "BADCOUNT,flat,1,,0,0,99999999999999999999\n";
+	}
+	{
+		CouponCollection coupons;
+		CHECK(coupons.getMalformedLines() == std::vector<int>({3, 4, 5}));
+		CHECK(coupons.getRedemptions(coupons.findCoupon("ONCE")) == 1);
+		CHECK(coupons.findCoupon("BADAMOUNT") == -1);
+		CHECK(coupons.findCoupon("BADCOUNT") == -1);
+
+		// Saving drops them
+		coupons.saveToDatabase();
+		CHECK(CouponCollection().getMalformedLines().empty());
+		CHECK(savedRedemptions("ONCE") == 1);
+	}
+
+	return checkResult("CouponRedemptionTest");
+}
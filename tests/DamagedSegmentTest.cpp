@@ -0,0 +1,108 @@
+/** \file DamagedSegmentTest.cpp
+ * \brief Checks that a segment file which cannot be read is never rewritten from memory.
+ * \details Only the histories added or deleted since are in memory for such a window, so writing it out would lose
+ * every history in the file. The file must stay as it is and the changes stay in the history log, so nothing is lost
+ * once the file is repaired.
+ */
+
+#include <fstream>
+#include <sstream>
+#include "Check.h"
+#include "PurchaseHistory/PurchaseHistoryCollection.h"
+
+constexpr int HISTORIES = 20;
+
+/** Builds the orders of a checkout of one product.
+ * @param id Unique ID of the product.
+ * @return The orders.
+ */
+static std::list<Order> basket(const std::string &id) {
+	Product product("Product " + id, "Test", id, 2, 0);
+	Order order(product, 0, 1);
+	order.changeTotalCost(2);
+	return std::list<Order>(1, order);
+}
+
+/** Reads a whole file.
+ * @param name Path of the file.
+ * @return Contents of the file, empty if it cannot be read.
+ */
+static std::string readFile(const std::string &name) {
+	std::ifstream file(name.c_str(), std::ios::binary);
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+/** Replaces a whole file.
+ * @param name Path of the file.
+ * @param contents New contents.
+ * @return None.
+ */
+static void writeFile(const std::string &name, const std::string &contents) {
+	std::ofstream file(name.c_str(), std::ios::binary | std::ios::trunc);
+	file << contents;
+}
+
+/** Checks whether a member has a history at a date.
+ * @param histC Collection to look in.
+ * @param memberID Unique ID of the member.
+ * @param date Date of the history.
+ * @return True if the history is there and not deleted.
+ */
+static bool hasHistory(PurchaseHistoryCollection &histC, int memberID, time_t date) {
+	return !histC.viewPurchaseHistory(memberID, date).isNull();
+}
+
+int main() {
+	// Every history falls in one window, two days back or more
+	const int64_t window = HistorySegments::bucketOf(time(NULL) - 2 * 24 * 60 * 60);
+	const time_t start = HistorySegments::bucketStart(window) + 60;
+	const std::string segment = HistorySegments::fileName(window);
+
+	{
+		PurchaseHistoryCollection histC;
+		for(int i = 0; i < HISTORIES; i++)
+			histC.addPurchaseHistory(PurchaseHistory(basket("p" + std::to_string(i)), i % 3, start + i * 60), i + 1);
+		histC.saveToDatabase();
+	}
+	const std::string original = readFile(segment);
+	CHECK(original.size() > 24);
+
+	// Damage the records in front of the footer, which is still read when the segments are opened
+	std::string damaged = original;
+	for(size_t i = 4; i < 20; i++)
+		damaged[i] = (char)0xff;
+	writeFile(segment, damaged);
+
+	// A history added and one deleted in the damaged window leave the file as it is
+	{
+		PurchaseHistoryCollection histC;
+		CHECK(!hasHistory(histC, 0, start));
+		histC.addPurchaseHistory(PurchaseHistory(basket("new"), 5, start + 3600), HISTORIES + 1);
+		CHECK(histC.deletePurchaseHistory(1, start + 60) == -1);
+		histC.compact();
+		histC.waitForCompaction();
+		histC.saveToDatabase();
+		CHECK(hasHistory(histC, 5, start + 3600));
+	}
+	CHECK(readFile(segment) == damaged);
+
+	// Once the file is repaired, its histories and the one kept in the log are all there
+	writeFile(segment, original);
+	{
+		PurchaseHistoryCollection histC;
+		CHECK(hasHistory(histC, 0, start));
+		CHECK(hasHistory(histC, 5, start + 3600));
+		CHECK(histC.getLastCheckout() == HISTORIES + 1);
+		histC.saveToDatabase();
+	}
+	{
+		PurchaseHistoryCollection histC;
+		for(int i = 0; i < HISTORIES; i++)
+			CHECK(hasHistory(histC, i % 3, start + i * 60));
+		CHECK(hasHistory(histC, 5, start + 3600));
+	}
+
+	return checkResult("DamagedSegmentTest");
+}
@@ -0,0 +1,144 @@
+/** \file HistoryStoreCodecTest.cpp
+ * \brief Round trips purchase histories through HistoryStore::encode and HistoryStore::decode.
+ * \details The histories are added out of date order and with checkout numbers that do not follow the dates, so
+ * the date and checkout deltas go both ways, and products change price between histories so the XORed float
+ * columns are not all zero. Every column of every record must come back as it was, floats bit for bit.
+ */
+
+#include <cstring>
+#include "Check.h"
+#include "PurchaseHistory/HistoryStore.h"
+#include "PurchaseHistory/BlockCodec.h"
+
+constexpr int HISTORIES = 500;
+
+/** Checks that two floats have the same bits.
+ * @param a First float.
+ * @param b Second float.
+ * @return True if the bits match.
+ */
+static bool sameBits(float a, float b) {
+	return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/** Builds the orders of a history from its number.
+ * @param i Number of the history.
+ * @return The orders.
+ */
+static std::list<Order> ordersOf(int i) {
+	std::list<Order> orders;
+	for(int o = 0; o <= i % 4; o++) {
+		int number = (i * 7 + o * 3) % 23;
+		std::string id = "p" + std::to_string(number);
+		// The price changes every 50 histories and some lines sell at a discount
+		Product product("Product " + id, "Category " + std::to_string(number % 5), id, 1.5f + number + (i / 50) * 0.1f, 0);
+		product.setPromotion((i + o) % 3 == 0 ? 0.15f : 0);
+		Order order(product, 0, 1 + (i + o) % 6);
+		order.changeTotalCost(order.getTotalCost() - 0.01f * (i % 3));
+		orders.push_back(order);
+	}
+	return orders;
+}
+
+/** Encodes records of a store and decodes them into an empty store.
+ * @param store Store to encode from.
+ * @param first Position of the first record in one of the store's indexes.
+ * @param last Position just past the last record.
+ * @param decoded Empty store the records are decoded into.
+ * @return True if decoding succeeded.
+ */
+static bool roundTrip(const HistoryStore &store, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last, HistoryStore &decoded) {
+	std::string stream;
+	BlockWriter writer(stream);
+	store.encode(writer, first, last);
+	writer.finish();
+	BlockReader reader(stream.data(), stream.size());
+	return decoded.decode(reader, true);
+}
+
+/** Checks that decoded records match the records they were encoded from, in date order.
+ * @param store Store the records were encoded from.
+ * @param first Position of the first encoded record in the store's date index.
+ * @param last Position just past the last encoded record.
+ * @param decoded Store the records were decoded into.
+ * @return None.
+ */
+static void checkSame(const HistoryStore &store, std::vector<uint32_t>::const_iterator first, std::vector<uint32_t>::const_iterator last, const HistoryStore &decoded) {
+	CHECK(decoded.records() == (size_t)(last - first));
+	if(decoded.records() != (size_t)(last - first))
+		return;
+
+	std::vector<uint32_t>::const_iterator d = decoded.byDate().begin();
+	for(std::vector<uint32_t>::const_iterator r = first; r != last; r++, d++) {
+		CHECK(decoded.getMemberID(*d) == store.getMemberID(*r));
+		CHECK(decoded.getDate(*d) == store.getDate(*r));
+		CHECK(decoded.getCheckout(*d) == store.getCheckout(*r));
+		CHECK(decoded.endLine(*d) - decoded.firstLine(*d) == store.endLine(*r) - store.firstLine(*r));
+		if(decoded.endLine(*d) - decoded.firstLine(*d) != store.endLine(*r) - store.firstLine(*r))
+			continue;
+
+		for(uint32_t dl = decoded.firstLine(*d), l = store.firstLine(*r); l < store.endLine(*r); dl++, l++) {
+			const HistoryProduct &got = decoded.getProduct(decoded.productColumn()[dl]);
+			const HistoryProduct &want = store.getProduct(store.productColumn()[l]);
+			CHECK(got.id == want.id && got.name == want.name && got.category == want.category);
+			CHECK(decoded.quantityColumn()[dl] == store.quantityColumn()[l]);
+			CHECK(sameBits(decoded.priceColumn()[dl], store.priceColumn()[l]));
+			CHECK(sameBits(decoded.discountColumn()[dl], store.discountColumn()[l]));
+			CHECK(sameBits(decoded.costColumn()[dl], store.costColumn()[l]));
+		}
+	}
+}
+
+int main() {
+	const time_t start = 1700000000;
+	HistoryStore store;
+	for(int i = 0; i < HISTORIES; i++) {
+		// Every other history is older than the one before it, and legacy histories have no checkout number
+		int member = i % 3 == 0 ? -(i % 11) : 100000 + i % 17;
+		time_t date = start + (i % 2 == 0 ? i : -i) * 3600;
+		uint64_t checkout = i % 10 == 0 ? 0 : (uint64_t)(HISTORIES - i) * 1000003;
+		PurchaseHistory history(ordersOf(i), member, date);
+		CHECK(store.add(history, checkout));
+	}
+	CHECK(store.records() == HISTORIES);
+
+	// Every record
+	{
+		HistoryStore decoded;
+		CHECK(roundTrip(store, store.byDate().begin(), store.byDate().end(), decoded));
+		checkSame(store, store.byDate().begin(), store.byDate().end(), decoded);
+		for(uint32_t r = 0; r < decoded.records(); r++) {
+			if(decoded.getCheckout(r) != 0)
+				CHECK(decoded.findCheckout(decoded.getCheckout(r)) == (int)r);
+		}
+	}
+
+	// A range of dates, as a segment holds
+	{
+		std::vector<uint32_t>::const_iterator first = store.lowerBound(store.byDate(), start - 100 * 3600);
+		std::vector<uint32_t>::const_iterator last = store.upperBound(store.byDate(), start + 100 * 3600);
+		HistoryStore decoded;
+		CHECK(roundTrip(store, first, last, decoded));
+		checkSame(store, first, last, decoded);
+	}
+
+	// Nothing
+	{
+		HistoryStore decoded;
+		CHECK(roundTrip(store, store.byDate().begin(), store.byDate().begin(), decoded));
+		CHECK(decoded.records() == 0);
+	}
+
+	// A stream cut short is refused
+	{
+		std::string stream;
+		BlockWriter writer(stream);
+		store.encode(writer, store.byDate().begin(), store.byDate().end());
+		writer.finish();
+		BlockReader reader(stream.data(), stream.size() / 2);
+		HistoryStore decoded;
+		CHECK(!decoded.decode(reader, true));
+	}
+
+	return checkResult("HistoryStoreCodecTest");
+}
@@ -0,0 +1,126 @@
+/** \file TombstoneReplayTest.cpp
+ * \brief Checks that a deleted history stays deleted when the checkout journal is replayed after a crash.
+ * \details The checkouts stay in the journal throughout, as they do until a clean exit empties it, so every restart
+ * replays them. A deletion must survive while it is only a tombstone in the log, once compaction has left the
+ * history out of the segments, once enough deletions have been purged from memory, and once the log has been
+ * checkpointed.
+ */
+
+#include <memory>
+#include "Check.h"
+#include "ShoppingCart/CheckoutJournal.h"
+
+constexpr auto JOURNAL = "checkout.log";
+constexpr int CHECKOUTS = 40;
+
+/** Builds the orders of a checkout of one product.
+ * @param id Unique ID of the product.
+ * @return The orders.
+ */
+static std::list<Order> basket(const std::string &id) {
+	Product product("Product " + id, "Test", id, 2, 0);
+	Order order(product, 0, 1);
+	order.changeTotalCost(2);
+	return std::list<Order>(1, order);
+}
+
+/** Restarts the collection and replays the journal, as startup after a crash does.
+ * @param histC Collection to replace.
+ * @param journal Journal to replay, which then numbers checkouts on from the replayed ones.
+ * @return None.
+ */
+static void restart(std::unique_ptr<PurchaseHistoryCollection> &histC, CheckoutJournal &journal) {
+	ProductCollection products;
+	Login login;
+	CouponCollection coupons;
+	histC.reset();
+	histC.reset(new PurchaseHistoryCollection());
+	journal.replay(products, login, coupons, *histC);
+}
+
+/** Restarts the collection and replays the journal, as startup after a crash does.
+ * @param histC Collection to replace.
+ * @return None.
+ */
+static void restart(std::unique_ptr<PurchaseHistoryCollection> &histC) {
+	CheckoutJournal journal(JOURNAL);
+	restart(histC, journal);
+}
+
+/** Checks whether a member has a history at a date.
+ * @param histC Collection to look in.
+ * @param memberID Unique ID of the member.
+ * @param date Date of the history.
+ * @return True if the history is there and not deleted.
+ */
+static bool hasHistory(PurchaseHistoryCollection &histC, int memberID, time_t date) {
+	return !histC.viewPurchaseHistory(memberID, date).isNull();
+}
+
+int main() {
+	const time_t start = time(NULL) - 24 * 60 * 60;
+	const std::vector<std::string> noCoupons;
+	std::unique_ptr<PurchaseHistoryCollection> histC(new PurchaseHistoryCollection());
+
+	// Every checkout is journaled and logged, member i % 4 buying at start + i minutes
+	{
+		CheckoutJournal journal(JOURNAL);
+		for(int i = 0; i < CHECKOUTS; i++) {
+			uint64_t checkout = journal.append(i % 4, start + i * 60, -2, noCoupons, basket("p" + std::to_string(i % 5)));
+			CHECK(checkout == (uint64_t)i + 1);
+			histC->addPurchaseHistory(PurchaseHistory(basket("p" + std::to_string(i % 5)), i % 4, start + i * 60), checkout);
+		}
+	}
+
+	// A deletion that is only a tombstone in the log
+	CHECK(histC->deletePurchaseHistory(0, start) == 0);
+	CHECK(!hasHistory(*histC, 0, start));
+	restart(histC);
+	CHECK(!hasHistory(*histC, 0, start));
+	CHECK(hasHistory(*histC, 1, start + 60));
+
+	// A deletion left out of the segments by compaction, with the tombstone gone from the log
+	CHECK(histC->deletePurchaseHistory(1, start + 60) == 0);
+	histC->compact();
+	histC->waitForCompaction();
+	restart(histC);
+	CHECK(!hasHistory(*histC, 0, start));
+	CHECK(!hasHistory(*histC, 1, start + 60));
+
+	// Enough deletions that compaction purges them from memory
+	for(int i = 2; i < CHECKOUTS; i += 3)
+		CHECK(histC->deletePurchaseHistory(i % 4, start + i * 60) == 0);
+	histC->compact();
+	histC->waitForCompaction();
+	restart(histC);
+	for(int i = 2; i < CHECKOUTS; i += 3)
+		CHECK(!hasHistory(*histC, i % 4, start + i * 60));
+	CHECK(hasHistory(*histC, 3, start + 3 * 60));
+
+	// A deletion followed by a checkpoint of the log
+	CHECK(histC->deletePurchaseHistory(3, start + 3 * 60) == 0);
+	histC->saveToDatabase();
+	restart(histC);
+	CHECK(!hasHistory(*histC, 3, start + 3 * 60));
+
+	// A member who buys again at the date of a deleted history keeps only the new one
+	{
+		CheckoutJournal journal(JOURNAL);
+		restart(histC, journal);
+		uint64_t checkout = journal.append(0, start, -2, noCoupons, basket("again"));
+		CHECK(checkout == CHECKOUTS + 1);
+		histC->addPurchaseHistory(PurchaseHistory(basket("again"), 0, start), checkout);
+	}
+	restart(histC);
+	std::vector<PurchaseHistory> same = histC->getMemberHistoriesWithinDay(0, start);
+	size_t atStart = 0;
+	for(size_t i = 0; i < same.size(); i++) {
+		if(same[i].getRawTime() == start) {
+			atStart++;
+			CHECK(same[i].begin()->getProduct().getID() == "again");
+		}
+	}
+	CHECK(atStart == 1);
+
+	return checkResult("TombstoneReplayTest");
+}